@@ -6,6 +6,7 @@
 
 #include <Geometry/Point.hh>
 #include <Geometry/Ray.hh>
+#include <Geometry/Simd/Ray.hh>
 #include <algorithm>
 #include <stdexcept>
 #include <tuple>
@@ -145,6 +146,29 @@ namespace excyrender {
         }
         return make_tuple (t0, t1);
     }
+
+    // As above, for N rays at once: the lanes that hit, with [t0,t1] of each. Components of
+    // the directions of zero are made tiny instead, so that no lane relies on infinities,
+    // which -ffast-math does not have.
+    template <int N>
+    inline Geometry::Simd::Mask<N> intersect(AABB const &box, Geometry::Simd::Ray<N> const &ray,
+                                             Geometry::Simd::Real<N> &t0,
+                                             Geometry::Simd::Real<N> &t1) noexcept
+    {
+        using namespace Geometry::Simd;
+        Real<N> const *o[3] = {&ray.origin.x, &ray.origin.y, &ray.origin.z},
+                      *d[3] = {&ray.direction.x, &ray.direction.y, &ray.direction.z};
+        t0 = -real_max;
+        t1 = real_max;
+        for (int axis=0; axis!=3; ++axis) {
+            const Real<N> i = real(1) / select(fabs(*d[axis]) < real(1e-20), Real<N>(1e-20), *d[axis]),
+                          a = (box.min()[axis] - *o[axis]) * i,
+                          b = (box.max()[axis] - *o[axis]) * i;
+            t0 = max(t0, min(a, b));
+            t1 = min(t1, max(a, b));
+        }
+        return t0 <= t1;
+    }
 }
 
 #endif // AABB_HH_INCLUDED_20130718
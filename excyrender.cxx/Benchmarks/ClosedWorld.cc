@@ -0,0 +1,116 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Renders the 10,000 spheres of main.cc, on a floor of triangles, in a ShapeStore with
+// IterativePath, once through the virtual interfaces (OpenWorld), and once with the
+// types of shapes, materials and BxDFs known at compile time (ClosedWorld).
+//
+// Usage: excygen-closedworld [samples-per-pixel=4 [size=160]]
+//
+// Prints the time of each, and the largest difference of the two images relative to
+// the brightest pixel. Both take the same samples; differences come from -ffast-math
+// rounding differently in inlined code, and should be tiny.
+
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Triangle.hh"
+#include "Primitives/ShapeStore.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+#include "SurfaceIntegrators/IterativePath.hh"
+#include "SurfaceIntegrators/ClosedWorld.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+
+    // CIE Y per pixel.
+    template <typename Integrator>
+    std::vector<real> render(char const *name, Integrator const &integrate, int size, int spp) {
+        std::vector<real> image(size*size, 0);
+        std::vector<MemoryArena> arenas(omp_get_max_threads());
+        const double start = omp_get_wtime();
+        #pragma omp parallel for schedule(dynamic)
+        for (int p=0; p<size*size; ++p) {
+            const int x = p % size, y = p / size;
+            MemoryArena &arena = arenas[omp_get_thread_num()];
+            for (int s=0; s!=spp; ++s) {
+                Sampling::Sampler sampler(x, y, s, Sampling::Sequence::Independent);
+                const real u = (x + sampler()) / size, v = 1 - (y + sampler()) / size;
+                const Geometry::Ray ray{Geometry::Point{0,1,-5}, Geometry::direction(u-0.5, v-0.7, 0.8)};
+                image[p] += std::get<1>(integrate(ray, sampler, arena).toXYZ()) / spp;
+                arena.reset();
+            }
+        }
+        std::cout << name << "  " << omp_get_wtime() - start << " s" << std::endl;
+        return image;
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        using namespace Primitives;
+        using namespace Photometry;
+        using namespace Photometry::Texture;
+        const int spp  = argc > 1 ? std::atoi(argv[1]) : 4;
+        const int size = argc > 2 ? std::atoi(argv[2]) : 160;
+
+        Scene scene;
+        ShapeStoreBuilder store;
+
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<real> d(0, 1);
+        for (int i=0; i<10000; ++i) {
+            const real x = d(mt)*100 - 50, z = 4 + d(mt)*100 - 10, r = 0.05 + d(mt)*0.3, y = r-1;
+            const Spectrum color = Spectrum::FromRGB(400,800,8, {d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4)});
+            const auto material = scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+                                      shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(color)))));
+            store.add(Shapes::Sphere({x,y,z}, r), store.material(material));
+        }
+        const auto gray = store.material(scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+                              shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(Spectrum::Gray(400,800,8,0.5)))))));
+        for (int z=-10; z<94; z+=8) {
+            for (int x=-50; x<50; x+=8) {
+                const Geometry::Point A(x,-1,z+8), B(x+8,-1,z+8), C(x,-1,z), D(x+8,-1,z);
+                store.add(Shapes::Triangle(A,B,C), gray);
+                store.add(Shapes::Triangle(C,B,D), gray);
+            }
+        }
+        scene.setPrimitive(store.finalize(20));
+        scene.add(std::shared_ptr<LightSource>(new Directional(Geometry::direction(1,0.5,-1),
+                                                               Spectrum::FromRGB(400,800,8,{8,7,7}))));
+        scene.setBackground([](Geometry::Direction const &) {
+                                return Spectrum::FromRGB(400,800,8,{1,2,3});
+                            });
+
+        using namespace SurfaceIntegrators;
+        typedef ClosedWorld<excyrender::detail::Types<Material::Lambertian>,
+                            excyrender::detail::Types<Surface::Lambertian>> World;
+        PathPolicy policy;
+        const auto open   = render("OpenWorld  ", IterativePath(policy, scene), size, spp);
+        const auto closed = render("ClosedWorld", BasicIterativePath<World>(policy, scene), size, spp);
+
+        real largest = 0, brightest = 0;
+        for (std::size_t p=0; p!=open.size(); ++p) {
+            largest = std::max(largest, std::fabs(open[p] - closed[p]));
+            brightest = std::max(brightest, open[p]);
+        }
+        std::cout << "largest difference " << largest / brightest << std::endl;
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
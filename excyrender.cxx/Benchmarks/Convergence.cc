@@ -0,0 +1,205 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Compares how fast the surface integrators and sample sequences converge: error against
+// a reference image over wall-clock time.
+//
+// A reference is rendered first with many samples per pixel. Then, for each integrator
+// with independent random numbers, and for MISPath with each low discrepancy sequence,
+// one sample per pixel is added at a time until the time budget is used up; after 1, 2,
+// 4, ... samples and at the end, a line
+//
+//     <integrator>/<sequence> <seconds> <samples-per-pixel> <rmse>
+//
+// is printed, where rmse is the root mean square error of the CIE XYZ pixel values.
+// Finally, MISPath with Sobol is rendered adaptively within the same budget, printing
+// one such line with the average samples per pixel.
+//
+// Usage: excygen-convergence [seconds-per-integrator=10] [reference-spp=256]
+
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include "Geometry/Ray.hh"
+#include "Geometry/Direction.hh"
+#include "Shapes/Terrain2d.hh"
+#include "Primitives/PrimitiveList.hh"
+#include "Primitives/PrimitiveFromFiniteShape.hh"
+#include "Primitives/BoundingIntervalHierarchy.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+#include "SurfaceIntegrators/Path.hh"
+#include "SurfaceIntegrators/IterativePath.hh"
+#include "SurfaceIntegrators/MISPath.hh"
+#include "Rendering/Adaptive.hh"
+
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+
+    typedef std::function<Photometry::Spectrum(Geometry::Ray const &, Sampling::Sampler &,
+                                               MemoryArena &)> Integrator;
+
+    const int width = 48, height = 48;
+
+    // Running sums of CIE XYZ per pixel.
+    struct Accumulator {
+        std::vector<real> xyz = std::vector<real>(width*height*3, 0);
+        int samples = 0;
+
+        real mean(int i) const {
+            return xyz[i] / samples;
+        }
+    };
+
+    Geometry::Ray camera(real x, real y) {
+        const auto u = x / real(width), v = 1 - y / real(height);
+        return Geometry::Ray{Geometry::Point{0,0.5,0}, Geometry::direction(u-0.5, v-0.5, 0.8)};
+    }
+
+    // Adds one sample per pixel. 'pass' is the sample index.
+    void render_pass(Integrator const &integrate, Sampling::Sequence sequence, std::uint32_t pass,
+                     std::vector<MemoryArena> &arenas, Accumulator &acc)
+    {
+        #pragma omp parallel for schedule(dynamic)
+        for (int p=0; p<width*height; ++p) {
+            const int x = p % width, y = p / width;
+            MemoryArena &arena = arenas[omp_get_thread_num()];
+
+            Sampling::Sampler sampler(x, y, pass, sequence);
+
+            const real sx = x + sampler() - real(0.5),
+                       sy = y + sampler() - real(0.5);
+            const auto xyz = integrate(camera(sx, sy), sampler, arena).toXYZ();
+            arena.reset();
+
+            acc.xyz[p*3+0] += std::get<0>(xyz);
+            acc.xyz[p*3+1] += std::get<1>(xyz);
+            acc.xyz[p*3+2] += std::get<2>(xyz);
+        }
+        ++acc.samples;
+    }
+
+    real rmse(Accumulator const &acc, Accumulator const &reference) {
+        real sum = 0;
+        for (int i=0, s=acc.xyz.size(); i!=s; ++i) {
+            const real d = acc.mean(i) - reference.mean(i);
+            sum += d*d;
+        }
+        return std::sqrt(sum / acc.xyz.size());
+    }
+
+    void converge(std::string const &name, Integrator const &integrate, Sampling::Sequence sequence,
+                  double budget, Accumulator const &reference, std::vector<MemoryArena> &arenas)
+    {
+        Accumulator acc;
+        const double start = omp_get_wtime();
+        int next_report = 1;
+        for (std::uint32_t pass=0; ; ++pass) {
+            render_pass(integrate, sequence, pass, arenas, acc);
+            const double elapsed = omp_get_wtime() - start;
+            const bool done = elapsed >= budget;
+            if (acc.samples == next_report || done) {
+                std::cout << name << ' ' << elapsed << ' ' << acc.samples << ' '
+                          << rmse(acc, reference) << std::endl;
+                next_report *= 2;
+            }
+            if (done)
+                break;
+        }
+    }
+
+    void converge_adaptive(std::string const &name, Integrator const &integrate,
+                           Sampling::Sequence sequence, double budget, Accumulator const &reference)
+    {
+        Rendering::AdaptivePolicy policy;
+        policy.timeBudget = budget;
+        policy.targetError = 0.005;
+        policy.maxSamples = 1 << 20;
+
+        std::vector<Rendering::PixelEstimate> estimates;
+        const auto report = Rendering::render_adaptive(width, height, policy, sequence,
+                                                       camera, integrate, estimates);
+        Accumulator acc;
+        acc.samples = 1;
+        for (int p=0; p!=width*height; ++p) {
+            acc.xyz[p*3+0] = estimates[p].X;
+            acc.xyz[p*3+1] = estimates[p].Y;
+            acc.xyz[p*3+2] = estimates[p].Z;
+        }
+        std::cout << name << ' ' << report.seconds << ' '
+                  << report.samples / real(width*height) << ' '
+                  << rmse(acc, reference) << std::endl;
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        using namespace excyrender;
+        using namespace Primitives;
+        using namespace Photometry;
+        using namespace Photometry::Texture;
+
+        const double budget        = argc > 1 ? std::atof(argv[1]) : 10;
+        const int    reference_spp = argc > 2 ? std::atoi(argv[2]) : 256;
+
+        Scene scene;
+        auto const material = scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+            shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(Spectrum::FromRGB(400,800,8, {0.6,0.5,0.4})))
+        )));
+
+        BoundingIntervalHierarchyBuilder builder;
+        builder.add(std::shared_ptr<FinitePrimitive>(new
+            PrimitiveFromFiniteShape(std::shared_ptr<Shapes::FiniteShape>(new Shapes::Terrain2d(
+                                         Geometry::Rectangle({-100,-100},{100,100}),
+                                         Geometry::Rectangle({0,0},{100,100}),
+                                         256,
+                                         [](real u,real v) { return -4 + 5*std::sin(u) * std::sin(v); })),
+                                     material)));
+        scene.setPrimitive(std::shared_ptr<Primitive>(new PrimitiveList({builder.finalize(20)})));
+        scene.add(std::shared_ptr<LightSource>(new Directional(Geometry::direction(1,0.5,-1),
+                                                               Spectrum::FromRGB(400,800,8,{8,7,7}))));
+        scene.setBackground([](Geometry::Direction const &) {
+                                return Spectrum::FromRGB(400,800,8,{1,2,3});
+                            });
+
+        SurfaceIntegrators::PathPolicy policy;
+        policy.maxDepth = 5;
+        const Integrator path      = SurfaceIntegrators::Path(policy.maxDepth, scene),
+                         iterative = SurfaceIntegrators::IterativePath(policy, scene),
+                         mis       = SurfaceIntegrators::MISPath(policy, scene);
+
+        std::vector<MemoryArena> arenas(omp_get_max_threads());
+
+        std::clog << "rendering reference (" << reference_spp << " spp) ..." << std::endl;
+        Accumulator reference;
+        for (int i=0; i!=reference_spp; ++i) {
+            // Seeds the reference differently from the runs compared against it.
+            render_pass(mis, Sampling::Sequence::Independent, 0x80000000u + std::uint32_t(i),
+                        arenas, reference);
+        }
+
+        using Sampling::Sequence;
+        std::cout << "# integrator/sequence seconds spp rmse" << std::endl;
+        converge("path/independent",      path,      Sequence::Independent, budget, reference, arenas);
+        converge("iterative/independent", iterative, Sequence::Independent, budget, reference, arenas);
+        converge("mis/independent",       mis,       Sequence::Independent, budget, reference, arenas);
+        converge("mis/sobol",             mis,       Sequence::Sobol,       budget, reference, arenas);
+        converge("mis/halton",            mis,       Sequence::Halton,      budget, reference, arenas);
+        converge("mis/bluenoise",         mis,       Sequence::BlueNoise,   budget, reference, arenas);
+        converge_adaptive("mis/sobol/adaptive", mis, Sequence::Sobol, budget, reference);
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
@@ -0,0 +1,71 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Compares two renderings of the same scene, e.g. those of a double and a single
+// precision build:
+//
+//   scons excygen excygen-single excygen-imagediff
+//   ./excygen        -o double.pfm
+//   ./excygen-single -o single.pfm
+//   ./excygen-imagediff double.pfm single.pfm
+//
+// Usage: excygen-imagediff reference image [rmse=0.01 [outliers=0.001]]
+//
+// Images are PFM, P6 or P3. Prints the RMSE over all channels, the largest difference,
+// and the fraction of outliers: pixels where a channel differs by more than 0.1, which is
+// what self-intersection acne and cracks show up as, long before they move the RMSE.
+// Exits with 1 if either exceeds its tolerance, with 2 on errors.
+
+#include "Benchmarks/ImageDiff.hh"
+#include "ImageFormat/PFM.hh"
+#include "ImageFormat/PPM.hh"
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+
+namespace {
+    using namespace excyrender;
+
+    std::vector<Photometry::RGB> load(std::string const &filename, int &width, int &height) {
+        std::ifstream is(filename, std::ios::binary);
+        if (!is)
+            throw std::runtime_error("could not open '" + filename + "'");
+        const char magic[2] = {char(is.get()), char(is.get())};
+        is.seekg(0);
+        if (magic[0] == 'P' && magic[1] == 'F')
+            return ImageFormat::readPfm(is, width, height);
+        return ImageFormat::readPpm(is, width, height);
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        if (argc < 3) {
+            std::cerr << "usage: excygen-imagediff reference image [rmse=0.01 [outliers=0.001]]\n";
+            return 2;
+        }
+        const double maxRmse = argc > 3 ? std::atof(argv[3]) : 0.01,
+                     maxOutliers = argc > 4 ? std::atof(argv[4]) : 0.001;
+
+        int rw, rh, w, h;
+        const auto ref = load(argv[1], rw, rh),
+                   img = load(argv[2], w, h);
+        if (rw != w || rh != h)
+            throw std::runtime_error("images differ in size");
+
+        const auto diff = Benchmarks::compare(ref, img);
+        std::cout << "rmse      " << diff.rmse << '\n'
+                  << "largest   " << diff.largest << '\n'
+                  << "outliers  " << diff.outlierFraction << " (" << diff.outliers << " pixels)" << std::endl;
+        return diff.within(maxRmse, maxOutliers) ? 0 : 1;
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+        return 2;
+    }
+}
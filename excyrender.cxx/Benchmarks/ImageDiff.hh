@@ -0,0 +1,53 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef IMAGEDIFF_HH_INCLUDED_20130911
+#define IMAGEDIFF_HH_INCLUDED_20130911
+
+#include "Photometry/RGB.hh"
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <stdexcept>
+#include <vector>
+
+// The comparison of excygen-imagediff and excygen-reference.
+namespace excyrender { namespace Benchmarks {
+
+    struct ImageDifference {
+        double rmse = 0,             // over all channels
+               largest = 0;          // difference of a channel
+        std::size_t outliers = 0;    // pixels where a channel differs by more than 0.1
+        double outlierFraction = 0;
+
+        bool within(double maxRmse, double maxOutliers) const noexcept {
+            return rmse <= maxRmse && outlierFraction <= maxOutliers;
+        }
+    };
+
+    // Throws std::logic_error if the images differ in size.
+    inline ImageDifference compare(std::vector<Photometry::RGB> const &reference,
+                                   std::vector<Photometry::RGB> const &image)
+    {
+        if (reference.size() != image.size())
+            throw std::logic_error("compare(): images differ in size");
+        ImageDifference ret;
+        if (reference.empty())
+            return ret;
+        double sum = 0;
+        for (std::size_t i=0; i!=reference.size(); ++i) {
+            const double d[3] = {std::fabs(double(reference[i].r) - image[i].r),
+                                 std::fabs(double(reference[i].g) - image[i].g),
+                                 std::fabs(double(reference[i].b) - image[i].b)};
+            const double m = std::max(std::max(d[0], d[1]), d[2]);
+            sum += d[0]*d[0] + d[1]*d[1] + d[2]*d[2];
+            ret.largest = std::max(ret.largest, m);
+            ret.outliers += m > 0.1;
+        }
+        ret.rmse = std::sqrt(sum / (3*reference.size()));
+        ret.outlierFraction = double(ret.outliers) / reference.size();
+        return ret;
+    }
+} }
+
+#endif // IMAGEDIFF_HH_INCLUDED_20130911
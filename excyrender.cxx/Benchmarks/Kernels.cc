@@ -0,0 +1,392 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Measures the core kernels on one thread, for tracking regressions between versions:
+//
+//     aabb                 intersect(AABB, Ray)
+//     aabb-packet          intersect(AABB, Simd::Ray), 32 bytes of lanes at a time
+//     triangle, sphere     Triangle::intersect(), Sphere::intersect()
+//     bih-spheres-*        building and traversing a BIH over the 10,000 spheres of
+//                          main.cc, as PrimitiveFromFiniteShapes
+//     bih-terrain-*        tesselating and building the 512x512 terrain of main.cc, and
+//                          traversing it
+//     spectrum-*           Spectrum multiply-add, and toXYZ()
+//     imagetexture-*       ColorImageTexture lookups, over pixel footprints (EWA) and
+//                          without (bicubic)
+//     path, iterativepath  Path and IterativePath samples, on the terrain
+//
+// Usage: excygen-kernels [repetitions=10 [filter [texture]]]
+//
+// Runs each kernel whose name contains 'filter' once to warm up, then 'repetitions'
+// times. 'texture' is any image SDL_image can load. Output is one line per kernel,
+//
+//     <kernel> <unit> <repetitions> <mean> <stddev> <ci95> <min> <max>
+//
+// where unit is "M/s" (millions of rays, lookups, operations or samples per second) or
+// "s" (seconds per build), and ci95 is the half-width of the 95% confidence interval of
+// the mean (Student's t). Lines starting with '#' are comments. Exits with 2 on errors,
+// among them a packet kernel that disagrees with the scalar one.
+
+#include "AABB.hh"
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Geometry/Ray.hh"
+#include "Geometry/Direction.hh"
+#include "Sampling/Sampler.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Triangle.hh"
+#include "Shapes/Terrain2d.hh"
+#include "Primitives/PrimitiveList.hh"
+#include "Primitives/PrimitiveFromFiniteShape.hh"
+#include "Primitives/BoundingIntervalHierarchy.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+#include "Photometry/Texture/ImageTexture.hh"
+#include "Photometry/Texture/PlanarMapping2d.hh"
+#include "SurfaceIntegrators/Path.hh"
+#include "SurfaceIntegrators/IterativePath.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+    using Geometry::Point;
+    using Geometry::Ray;
+
+    // Results go here, so that the compiler cannot drop the work.
+    volatile std::uint64_t sink;
+
+    // Two-sided 95% quantile of Student's t with 'dof' degrees of freedom.
+    double t95(int dof) {
+        static const double table[] = {12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+                                        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+                                        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042};
+        return dof < 1 ? 0 : dof <= 30 ? table[dof-1] : 1.96;
+    }
+
+    class Suite {
+    public:
+        Suite(int repetitions, std::string filter)
+            : repetitions(repetitions), filter(filter)
+        {
+            std::cout << "# kernel unit repetitions mean stddev ci95 min max" << std::endl;
+        }
+
+        bool wants(std::string const &name) const {
+            return name.find(filter) != std::string::npos;
+        }
+
+        // 'run' processes a batch and returns its size; reported in millions per second.
+        template <typename F>
+        void throughput(std::string const &name, F run) {
+            if (!wants(name))
+                return;
+            run();
+            std::vector<double> values;
+            for (int r=0; r!=repetitions; ++r) {
+                const double start = omp_get_wtime();
+                const double items = run();
+                values.push_back(1e-6 * items / (omp_get_wtime() - start));
+            }
+            report(name, "M/s", values);
+        }
+
+        // Reported in seconds per run.
+        template <typename F>
+        void duration(std::string const &name, F run) {
+            if (!wants(name))
+                return;
+            run();
+            std::vector<double> values;
+            for (int r=0; r!=repetitions; ++r) {
+                const double start = omp_get_wtime();
+                run();
+                values.push_back(omp_get_wtime() - start);
+            }
+            report(name, "s", values);
+        }
+
+    private:
+        void report(std::string const &name, char const *unit, std::vector<double> const &values) {
+            const int n = values.size();
+            double mean = 0, var = 0;
+            for (auto v : values)
+                mean += v / n;
+            for (auto v : values)
+                var += (v-mean)*(v-mean);
+            const double stddev = n > 1 ? std::sqrt(var / (n-1)) : 0;
+            std::cout << name << ' ' << unit << ' ' << n << ' ' << mean << ' ' << stddev << ' '
+                      << t95(n-1) * stddev / std::sqrt(double(n)) << ' '
+                      << *std::min_element(values.begin(), values.end()) << ' '
+                      << *std::max_element(values.begin(), values.end()) << std::endl;
+        }
+
+        int repetitions;
+        std::string filter;
+    };
+
+
+    // Rays from a box around the origin towards random points near it.
+    std::vector<Ray> randomRays(int count, real spread, std::mt19937 &mt) {
+        std::uniform_real_distribution<real> d(-1, 1);
+        std::vector<Ray> ret;
+        ret.reserve(count);
+        for (int i=0; i!=count; ++i) {
+            const Point origin(3*d(mt), 3*d(mt), 3*d(mt)),
+                        target(spread*d(mt), spread*d(mt), spread*d(mt));
+            ret.emplace_back(origin, Geometry::Direction::Normalize(target - origin));
+        }
+        return ret;
+    }
+
+    // As the camera of main.cc, without differentials.
+    Ray camera(real u, real v) {
+        return Ray{Point{0,0.5,0}, Geometry::direction(u-0.5, v-0.5, 0.8)};
+    }
+
+    std::shared_ptr<Shapes::Terrain2d> terrain() {
+        return std::make_shared<Shapes::Terrain2d>(Geometry::Rectangle({-100,-100},{100,100}),
+                                                   Geometry::Rectangle({0,0},{100,100}),
+                                                   512,
+                                                   [](real u,real v) { return -4 + 5*std::sin(u) * std::sin(v); });
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        using namespace Primitives;
+        using namespace Photometry;
+        using namespace Photometry::Texture;
+
+        const int repetitions = argc > 1 ? std::atoi(argv[1]) : 10;
+        const std::string filter = argc > 2 ? argv[2] : "";
+        const std::string texture = argc > 3 ? argv[3] : "loose_gravel_9261459 (mayang.com).JPG";
+        if (repetitions < 1)
+            throw std::runtime_error("repetitions must be 1 or more");
+        Suite suite(repetitions, filter);
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<real> d(0, 1);
+
+        const auto rays = randomRays(1 << 20, 1.5, mt);
+
+        suite.throughput("aabb", [&]() {
+            const AABB box(Point(-1,-1,-1), Point(1,1,1));
+            std::uint64_t hits = 0;
+            for (auto const &ray : rays)
+                hits += !!intersect(box, ray);
+            sink = hits;
+            return rays.size();
+        });
+        if (suite.wants("aabb-packet")) {
+            // As "aabb", a packet of rays at a time, including their transposition into a
+            // packet. Checked against intersect(AABB, Ray) first; it is not measured if
+            // any lane differs.
+            const int lanes = 32 / sizeof(real);
+            typedef Geometry::Simd::Ray<lanes> Packet;
+            const AABB box(Point(-1,-1,-1), Point(1,1,1));
+            for (std::size_t i=0; i!=rays.size(); i+=lanes) {
+                Geometry::Simd::Real<lanes> t0, t1;
+                const auto hit = intersect(box, Packet(&rays[i]), t0, t1);
+                for (int l=0; l!=lanes; ++l) {
+                    const auto expected = intersect(box, rays[i+l]);
+                    auto const near = [](real a, real b) {
+                        return std::fabs(a-b) <= rounding_error * (1 + std::fabs(b));
+                    };
+                    if (!!expected != hit[l]
+                        || (expected && !(near(t0[l], get<0>(*expected)) && near(t1[l], get<1>(*expected)))))
+                        throw std::logic_error("aabb-packet: lane " + std::to_string(l) + " of ray "
+                                               + std::to_string(i+l) + " differs from intersect(AABB, Ray)");
+                }
+            }
+            suite.throughput("aabb-packet", [&]() {
+                std::uint64_t hits = 0;
+                for (std::size_t i=0; i!=rays.size(); i+=lanes) {
+                    Geometry::Simd::Real<lanes> t0, t1;
+                    const auto hit = intersect(box, Packet(&rays[i]), t0, t1);
+                    for (int l=0; l!=lanes; ++l)
+                        hits += hit[l];
+                }
+                sink = hits;
+                return rays.size();
+            });
+        }
+        suite.throughput("triangle", [&]() {
+            const Shapes::Triangle triangle({-1,-1,0}, {1,-1,0}, {0,1,0.5});
+            std::uint64_t hits = 0;
+            for (auto const &ray : rays)
+                hits += !!triangle.intersect(ray);
+            sink = hits;
+            return rays.size();
+        });
+        suite.throughput("sphere", [&]() {
+            const Shapes::Sphere sphere({0,0,0}, 1);
+            std::uint64_t hits = 0;
+            for (auto const &ray : rays)
+                hits += !!sphere.intersect(ray);
+            sink = hits;
+            return rays.size();
+        });
+
+
+        Scene scene;
+        const auto material = scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+            shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(Spectrum::FromRGB(400,800,8, {0.6,0.5,0.4}))))));
+
+        if (suite.wants("bih-spheres")) {
+            std::vector<std::shared_ptr<FinitePrimitive>> spheres;
+            for (int i=0; i<10000; ++i) {
+                const real x = d(mt)*100 - 50, z = 4 + d(mt)*100 - 10, r = 0.05 + d(mt)*0.3, y = r-1;
+                spheres.emplace_back(new PrimitiveFromFiniteShape(
+                    std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere({x,y,z}, r)), material));
+            }
+            auto const build = [&]() {
+                BoundingIntervalHierarchyBuilder builder;
+                for (auto const &s : spheres)
+                    builder.add(s);
+                return builder.finalize(20);
+            };
+            suite.duration("bih-spheres-build", build);
+
+            const auto bih = build();
+            std::vector<Ray> rays;
+            for (int i=0; i!=1<<18; ++i)
+                rays.emplace_back(Point(d(mt)*100 - 50, d(mt)*2, d(mt)*100 - 10),
+                                  Geometry::direction(d(mt)-real(0.5), d(mt)*real(-0.3), d(mt)-real(0.5)));
+            suite.throughput("bih-spheres-traverse", [&]() {
+                std::uint64_t hits = 0;
+                for (auto const &ray : rays)
+                    hits += !!bih->intersect(ray);
+                sink = hits;
+                return rays.size();
+            });
+        }
+
+        if (suite.wants("bih-terrain")) {
+            suite.duration("bih-terrain-build", [&]() { sink = !!terrain(); });
+
+            const auto shape = terrain();
+            std::vector<Ray> rays;
+            for (int i=0; i!=1<<18; ++i)
+                rays.push_back(camera(d(mt), d(mt)));
+            suite.throughput("bih-terrain-traverse", [&]() {
+                std::uint64_t hits = 0;
+                for (auto const &ray : rays)
+                    hits += !!shape->intersect(ray);
+                sink = hits;
+                return rays.size();
+            });
+        }
+
+
+        if (suite.wants("spectrum")) {
+            std::vector<Spectrum> a, b;
+            for (int i=0; i!=1024; ++i) {
+                a.push_back(Spectrum::FromRGB(400,800,8, {d(mt), d(mt), d(mt)}));
+                b.push_back(Spectrum::FromRGB(400,800,8, {d(mt), d(mt), d(mt)}));
+            }
+            suite.throughput("spectrum-muladd", [&]() {
+                Spectrum acc = Spectrum::Gray(400,800,8,1);
+                for (int r=0; r!=256; ++r)
+                    for (std::size_t i=0; i!=a.size(); ++i)
+                        acc = acc * a[i] + b[i];
+                sink = std::uint64_t(std::get<1>(acc.toXYZ()));
+                return 256 * a.size();
+            });
+            suite.throughput("spectrum-toxyz", [&]() {
+                real sum = 0;
+                for (int r=0; r!=256; ++r)
+                    for (auto const &s : a)
+                        sum += std::get<1>(s.toXYZ());
+                sink = std::uint64_t(sum);
+                return 256 * a.size();
+            });
+        }
+
+
+        if (suite.wants("imagetexture")) {
+            try {
+                const ColorImageTexture image(XZPlanarMapping(0.4,0.4,0,0), texture);
+                std::vector<DifferentialGeometry> footprints, points;
+                for (int i=0; i!=1<<16; ++i) {
+                    DifferentialGeometry dg(1, Point(d(mt)*100, 0, d(mt)*100), Geometry::Normal(0,1,0),
+                                            0, 0, Geometry::Vector(1,0,0), Geometry::Vector(0,0,1));
+                    points.push_back(dg);
+                    // From a texel to a few hundred, as over a landscape.
+                    const real size = std::pow(real(2), d(mt)*8) / 512;
+                    dg.dpdx = Geometry::Vector(size, 0, size * (d(mt)-real(0.5)));
+                    dg.dpdy = Geometry::Vector(size * (d(mt)-real(0.5)), 0, size);
+                    footprints.push_back(dg);
+                }
+                suite.throughput("imagetexture-ewa", [&]() {
+                    real sum = 0;
+                    for (auto const &dg : footprints)
+                        sum += image(dg).max();
+                    sink = std::uint64_t(sum);
+                    return footprints.size();
+                });
+                suite.throughput("imagetexture-bicubic", [&]() {
+                    real sum = 0;
+                    for (auto const &dg : points)
+                        sum += image(dg).max();
+                    sink = std::uint64_t(sum);
+                    return points.size();
+                });
+            } catch (std::runtime_error &e) {
+                std::cout << "# imagetexture skipped: " << e.what() << std::endl;
+            }
+        }
+
+
+        if (suite.wants("path")) {
+            scene.setPrimitive(std::shared_ptr<Primitive>(new PrimitiveList({
+                std::shared_ptr<Primitive>(new PrimitiveFromFiniteShape(terrain(), material))})));
+            scene.add(std::shared_ptr<LightSource>(new Directional(Geometry::direction(1,0.5,-1),
+                                                                   Spectrum::FromRGB(400,800,8,{8,7,7}))));
+            scene.setBackground([](Geometry::Direction const &) {
+                                    return Spectrum::FromRGB(400,800,8,{1,2,3});
+                                });
+            SurfaceIntegrators::PathPolicy policy;
+            const SurfaceIntegrators::Path path(policy.maxDepth, scene);
+            const SurfaceIntegrators::IterativePath iterative(policy, scene);
+            MemoryArena arena;
+
+            // One sample through each of 64x64 pixels.
+            typedef std::function<Spectrum(Geometry::RayDifferential const &, Sampling::Sampler &,
+                                           MemoryArena &)> Integrator;
+            std::uint32_t pass = 0;
+            auto const samples = [&](Integrator const &integrate) {
+                const int size = 64;
+                real sum = 0;
+                ++pass;
+                for (int y=0; y!=size; ++y) {
+                    for (int x=0; x!=size; ++x) {
+                        Sampling::Sampler sampler(x, y, pass, Sampling::Sequence::Independent);
+                        const Geometry::RayDifferential ray(camera((x+real(0.5))/size, 1-(y+real(0.5))/size));
+                        sum += std::get<1>(integrate(ray, sampler, arena).toXYZ());
+                        arena.reset();
+                    }
+                }
+                sink = std::uint64_t(sum);
+                return size * size;
+            };
+            suite.throughput("path", [&]() { return samples(path); });
+            suite.throughput("iterativepath", [&]() { return samples(iterative); });
+        }
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+        return 2;
+    }
+}
@@ -0,0 +1,405 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Renders a fixed set of small scenes and compares them with reference images, to tell
+// whether a change altered what the renderer computes, and how fast it is:
+//
+//     terrain-texture  the terrain of main.cc under a tiled image texture (EWA filtered)
+//     spheres          the 10,000 spheres of main.cc on a floor
+//     mixed            a grid of spheres, Lambertian and specular in turn
+//     interior         a closed room lit through a hole in its ceiling, up to 16 bounces
+//
+// Usage: excygen-reference [-update] [directory=Benchmarks/References [rmse [outliers]]]
+//
+// References are '<scene>.pfm' in 'directory'; a missing one fails. -update (re)writes
+// them instead of comparing, after an intended change of the images. The texture of
+// terrain-texture is procedural, written to a temporary file on each run.
+//
+// Builds differ (-march=native, -ffast-math), and once a path takes another turn, its
+// pixel gets other noise. So each scene has its own tolerances, which pass a plain -O2
+// build and the single precision one (excygen-reference-single) against references of
+// the scons build, with a margin; rmse and outliers, if given, replace them for all
+// scenes.
+//
+// Prints one line per scene,
+//
+//     <scene> <seconds> <rays> <Mrays/s> <peak-MiB> <rmse> <outliers> <ok|FAIL|updated>
+//
+// where seconds is the time to image (building and rendering), rays counts camera,
+// bounce and shadow rays, peak-MiB is the high-water mark of the resident set while the
+// scene was built and rendered, and rmse and outliers are as in excygen-imagediff.
+// Exits with 1 if any scene fails, with 2 on errors. No display needed.
+
+#include "Benchmarks/ImageDiff.hh"
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Geometry/Ray.hh"
+#include "Geometry/Direction.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Triangle.hh"
+#include "Shapes/Terrain2d.hh"
+#include "Primitives/PrimitiveList.hh"
+#include "Primitives/PrimitiveFromFiniteShape.hh"
+#include "Primitives/BoundingIntervalHierarchy.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Material/BSDFPassthrough.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+#include "Photometry/Texture/TiledImageTexture.hh"
+#include "Photometry/Texture/PlanarMapping2d.hh"
+#include "Photometry/ColorSpace.hh"
+#include "SurfaceIntegrators/IterativePath.hh"
+#include "Rendering/TileScheduler.hh"
+#include "ImageFormat/PFM.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+#include <unistd.h>
+
+namespace {
+    using namespace excyrender;
+    using namespace excyrender::Primitives;
+    using namespace excyrender::Photometry;
+    using namespace excyrender::Photometry::Texture;
+    using Geometry::Point;
+
+    const int imageWidth = 128, imageHeight = 128;
+
+    // Counts the rays traced through it, per thread.
+    class CountingPrimitive final : public Primitive {
+    public:
+        explicit CountingPrimitive(std::shared_ptr<const Primitive> primitive)
+            : primitive(primitive), counts(omp_get_max_threads())
+        {}
+
+        optional<Intersection> intersect(Geometry::Ray const &ray) const noexcept {
+            count();
+            return primitive->intersect(ray);
+        }
+        bool occludes(Point const &a, Point const &b) const noexcept {
+            count();
+            return primitive->occludes(a, b);
+        }
+        bool occludes(Point const &a, Geometry::Direction const &b) const noexcept {
+            count();
+            return primitive->occludes(a, b);
+        }
+
+        std::uint64_t rays() const noexcept {
+            std::uint64_t ret = 0;
+            for (auto const &c : counts)
+                ret += c.rays;
+            return ret;
+        }
+
+    private:
+        // A cache line each, so that threads do not share one.
+        struct alignas(64) Count {
+            std::uint64_t rays = 0;
+        };
+
+        void count() const noexcept {
+            ++counts[omp_get_thread_num()].rays;
+        }
+
+        std::shared_ptr<const Primitive> primitive;
+        mutable std::vector<Count> counts;
+    };
+
+
+    struct Camera {
+        Point origin;
+        real tilt;   // of the view upwards
+    };
+
+    struct Reference {
+        char const *name;
+        int samplesPerPixel;
+        SurfaceIntegrators::PathPolicy policy;
+        Camera camera;
+        double maxRmse, maxOutliers;
+        // Fills the scene; returns its primitive.
+        std::function<std::shared_ptr<Primitive>(Scene &)> build;
+    };
+
+    std::shared_ptr<const Material::Material> lambertian(Spectrum const &color) {
+        return std::shared_ptr<const Material::Material>(new Material::Lambertian(
+            shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(color))));
+    }
+
+    std::shared_ptr<FinitePrimitive> finite(Shapes::FiniteShape *shape, Material::Material const *material) {
+        return std::shared_ptr<FinitePrimitive>(new PrimitiveFromFiniteShape(
+            std::shared_ptr<Shapes::FiniteShape>(shape), material));
+    }
+
+    // The quadrilateral a,b,c,d, counter-clockwise.
+    void quad(BoundingIntervalHierarchyBuilder &builder, Material::Material const *material,
+              Point const &a, Point const &b, Point const &c, Point const &d)
+    {
+        builder.add(finite(new Shapes::Triangle(a, b, c), material));
+        builder.add(finite(new Shapes::Triangle(a, c, d), material));
+    }
+
+    void sky(Scene &scene) {
+        scene.add(std::shared_ptr<LightSource>(new Directional(Geometry::direction(1,0.5,-1),
+                                                               Spectrum::FromRGB(400,800,8,{8,7,7}))));
+        scene.setBackground([](Geometry::Direction const &) {
+                                return Spectrum::FromRGB(400,800,8,{1,2,3});
+                            });
+    }
+
+
+    // An unused file name in TMPDIR, or /tmp.
+    std::string temporaryFile() {
+        char const *tmp = std::getenv("TMPDIR");
+        std::string path = std::string(tmp && *tmp ? tmp : "/tmp") + "/excygen-reference-XXXXXX";
+        const int fd = ::mkstemp(&path[0]);
+        if (fd < 0)
+            throw std::runtime_error("could not create '" + path + "'");
+        ::close(fd);
+        return path;
+    }
+
+    std::shared_ptr<Primitive> terrainTexture(Scene &scene) {
+        // A procedural texture, so that the image does not depend on an image loader.
+        const int size = 256;
+        std::vector<RGB> texels(size*size);
+        for (int y=0; y!=size; ++y)
+            for (int x=0; x!=size; ++x)
+                texels[y*size + x] = RGB(((x/16 + y/16) % 2) ? 0.7 : 0.3,
+                                         0.4 + 0.3*std::sin(x * real(0.1)),
+                                         0.3 + 0.2*std::cos(y * real(0.07)));
+        // Mapped, the file is no longer needed by name.
+        const std::string filename = temporaryFile();
+        shared_ptr<SpectrumTexture> texture;
+        try {
+            TextureCache::write(filename, size, size, texels, TextureCache::TexelFormat::U8);
+            texture.reset(new ColorTiledImageTexture(XZPlanarMapping(0.4,0.4,0,0), filename));
+        } catch (...) {
+            std::remove(filename.c_str());
+            throw;
+        }
+        std::remove(filename.c_str());
+
+        const auto material = scene.add(std::shared_ptr<const Material::Material>(
+            new Material::Lambertian(texture)));
+        BoundingIntervalHierarchyBuilder builder;
+        builder.add(finite(new Shapes::Terrain2d(Geometry::Rectangle({-100,-100},{100,100}),
+                                                 Geometry::Rectangle({0,0},{100,100}),
+                                                 256,
+                                                 [](real u,real v) { return -4 + 5*std::sin(u) * std::sin(v); }),
+                           material));
+        sky(scene);
+        return builder.finalize(20);
+    }
+
+    std::shared_ptr<Primitive> spheres(Scene &scene) {
+        BoundingIntervalHierarchyBuilder builder;
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<double> d(0, 1);
+        for (int i=0; i<10000; ++i) {
+            const real x = d(mt)*100 - 50, z = 4 + d(mt)*100 - 10, r = 0.05 + d(mt)*0.3, y = r-1;
+            const Spectrum color = Spectrum::FromRGB(400,800,8, {d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4)});
+            builder.add(finite(new Shapes::Sphere({x,y,z}, r), scene.add(lambertian(color))));
+        }
+        quad(builder, scene.add(lambertian(Spectrum::Gray(400,800,8,0.5))),
+             {-60,-1,-20}, {-60,-1,100}, {60,-1,100}, {60,-1,-20});
+        sky(scene);
+        return builder.finalize(20);
+    }
+
+    std::shared_ptr<Primitive> mixed(Scene &scene) {
+        BoundingIntervalHierarchyBuilder builder;
+        const auto matte = scene.add(lambertian(Spectrum::FromRGB(400,800,8, {0.7,0.4,0.3}))),
+                   mirror = scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({
+                                std::shared_ptr<Surface::BxDF>(new Surface::SpecularReflect(
+                                    Spectrum::FromRGB(400,800,8, {0.9,0.9,0.8})))})));
+        for (int z=0; z!=8; ++z)
+            for (int x=0; x!=8; ++x)
+                builder.add(finite(new Shapes::Sphere({real(x-3.5), real(-0.6), real(3 + z)}, 0.4),
+                                   (x+z) % 2 ? mirror : matte));
+        quad(builder, scene.add(lambertian(Spectrum::Gray(400,800,8,0.6))),
+             {-20,-1,-5}, {-20,-1,30}, {20,-1,30}, {20,-1,-5});
+        sky(scene);
+        return builder.finalize(20);
+    }
+
+    std::shared_ptr<Primitive> interior(Scene &scene) {
+        BoundingIntervalHierarchyBuilder builder;
+        const auto wall = scene.add(lambertian(Spectrum::Gray(400,800,8,0.75))),
+                   floor = scene.add(lambertian(Spectrum::FromRGB(400,800,8, {0.6,0.5,0.4})));
+        const real s = 2, h = 3, hole = 0.5;
+        quad(builder, floor, {-s,0,-s}, {s,0,-s}, {s,0,s}, {-s,0,s});
+        quad(builder, wall, {-s,0,-s}, {-s,h,-s}, {s,h,-s}, {s,0,-s});
+        quad(builder, wall, {-s,0,s}, {s,0,s}, {s,h,s}, {-s,h,s});
+        quad(builder, wall, {-s,0,-s}, {-s,0,s}, {-s,h,s}, {-s,h,-s});
+        quad(builder, wall, {s,0,-s}, {s,h,-s}, {s,h,s}, {s,0,s});
+        // The ceiling, around a square hole.
+        quad(builder, wall, {-s,h,-s}, {-s,h,s}, {-hole,h,s}, {-hole,h,-s});
+        quad(builder, wall, {hole,h,-s}, {hole,h,s}, {s,h,s}, {s,h,-s});
+        quad(builder, wall, {-hole,h,-s}, {-hole,h,-hole}, {hole,h,-hole}, {hole,h,-s});
+        quad(builder, wall, {-hole,h,hole}, {-hole,h,s}, {hole,h,s}, {hole,h,hole});
+        // A block for the light to fall on and around.
+        quad(builder, wall, {-0.5,0.8,-0.5}, {-0.5,0.8,0.5}, {0.5,0.8,0.5}, {0.5,0.8,-0.5});
+        quad(builder, wall, {-0.5,0,-0.5}, {-0.5,0.8,-0.5}, {0.5,0.8,-0.5}, {0.5,0,-0.5});
+        quad(builder, wall, {-0.5,0,-0.5}, {-0.5,0,0.5}, {-0.5,0.8,0.5}, {-0.5,0.8,-0.5});
+
+        scene.add(std::shared_ptr<LightSource>(new Directional(Geometry::direction(0.2,1,0.1),
+                                                               Spectrum::FromRGB(400,800,8,{20,18,16}))));
+        scene.setBackground([](Geometry::Direction const &) {
+                                return Spectrum::FromRGB(400,800,8,{2,3,4});
+                            });
+        return builder.finalize(20);
+    }
+
+
+    std::vector<Reference> references() {
+        SurfaceIntegrators::PathPolicy outdoor, deep;
+        deep.maxDepth = 16;
+        deep.rouletteDepth = 8;
+        return {
+            {"terrain-texture", 16, outdoor, {{0,0.5,0}, 0},      0.01,  0.001, terrainTexture},
+            {"spheres",         64, outdoor, {{0,0.5,0}, -0.1},   0.015, 0.001, spheres},
+            {"mixed",           64, outdoor, {{0,1,-2}, -0.15},   0.015, 0.001, mixed},
+            {"interior",        64, deep,    {{0,1.2,-1.9}, 0.1}, 0.05,  0.01,  interior}
+        };
+    }
+
+
+    // Peak resident set since the last resetPeakMemory(), in MiB.
+    double peakMemory() {
+        std::ifstream status("/proc/self/status");
+        std::string line;
+        while (std::getline(status, line))
+            if (line.compare(0, 6, "VmHWM:") == 0)
+                return std::atof(line.c_str() + 6) / 1024;
+        return 0;
+    }
+
+    // Linux 4.0 and newer; elsewhere, the peak stays that of the whole process.
+    void resetPeakMemory() {
+        std::ofstream("/proc/self/clear_refs") << "5";
+    }
+
+
+    std::vector<RGB> render(Reference const &reference, Scene const &scene) {
+        const auto integrator = SurfaceIntegrators::IterativePath(reference.policy, scene);
+        const int spp = reference.samplesPerPixel;
+        const real footprint = std::max(real(0.125), 1 / std::sqrt(real(spp)));
+        auto const through = [&](real x, real y) {
+            const auto u = x / real(imageWidth), v = 1 - y / real(imageHeight);
+            return Geometry::direction(u-0.5, v-0.5 + reference.camera.tilt, 0.8);
+        };
+
+        std::vector<RGB> pixels(imageWidth*imageHeight);
+        Rendering::TilePolicy tiling;
+        tiling.progress = false;
+        Rendering::render_tiles(imageWidth, imageHeight, tiling, Sampling::Sequence::Sobol,
+            [&](Rendering::Tile const &tile, Rendering::ThreadContext &context) {
+                for (auto y=tile.y0; y!=tile.y1; ++y) {
+                    for (auto x=tile.x0; x!=tile.x1; ++x) {
+                        context.sampler.startPixel(x, y);
+                        Spectrum sum = Spectrum::Black(400,800,8);
+                        for (int i=0; i!=spp; ++i) {
+                            context.sampler.startSample(i);
+                            const real sx = x + context.sampler() - real(0.5),
+                                       sy = y + context.sampler() - real(0.5);
+                            Geometry::RayDifferential ray{reference.camera.origin, through(sx, sy)};
+                            ray.hasDifferentials = true;
+                            ray.rxOrigin = ray.ryOrigin = ray.origin;
+                            ray.rxDirection = static_cast<Geometry::Vector>(through(sx+1, sy));
+                            ray.ryDirection = static_cast<Geometry::Vector>(through(sx, sy+1));
+                            ray.scaleDifferentials(footprint);
+                            sum += integrator(ray, context.sampler, context.arena) * (real(1) / spp);
+                            context.arena.reset();
+                        }
+                        const auto rgb = ColorSpace::XYZ_to_sRGB(sum.toXYZ());
+                        pixels[y*imageWidth + x] = RGB(get<0>(rgb), get<1>(rgb), get<2>(rgb));
+                    }
+                }
+            });
+        return pixels;
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        bool update = false;
+        if (argc > 1 && argv[1] == std::string("-update")) {
+            update = true;
+            --argc;
+            ++argv;
+        }
+        for (int i=1; i<argc; ++i) {
+            if (argv[i][0] == '-') {
+                std::cerr << "usage: excygen-reference [-update] [directory=Benchmarks/References [rmse [outliers]]]\n";
+                return 2;
+            }
+        }
+        const std::string directory = argc > 1 ? argv[1] : "Benchmarks/References";
+
+        std::cout << "# scene seconds rays Mrays/s peak-MiB rmse outliers result" << std::endl;
+        bool failed = false;
+        for (auto const &reference : references()) {
+            resetPeakMemory();
+            const double start = omp_get_wtime();
+
+            Scene scene;
+            const auto counting = std::make_shared<CountingPrimitive>(reference.build(scene));
+            scene.setPrimitive(counting);
+            const auto pixels = render(reference, scene);
+
+            const double seconds = omp_get_wtime() - start,
+                         peak = peakMemory();
+            const std::uint64_t rays = counting->rays();
+            std::cout << reference.name << ' ' << seconds << ' ' << rays << ' '
+                      << 1e-6 * rays / seconds << ' ' << peak << ' ';
+
+            const std::string filename = directory + "/" + reference.name + ".pfm";
+            if (update) {
+                std::ofstream os(filename, std::ios::binary);
+                ImageFormat::pfm(os, imageWidth, imageHeight, pixels);
+                os.close();
+                if (!os)
+                    throw std::runtime_error("could not write '" + filename + "'");
+                std::cout << "- - updated" << std::endl;
+                continue;
+            }
+
+            std::ifstream is(filename, std::ios::binary);
+            if (!is) {
+                failed = true;
+                std::cout << "- - FAIL" << std::endl;
+                std::cerr << "no reference '" << filename << "', see -update\n";
+                continue;
+            }
+            int w, h;
+            const auto expected = ImageFormat::readPfm(is, w, h);
+            if (w != imageWidth || h != imageHeight)
+                throw std::runtime_error("'" + filename + "' differs in size");
+            const auto diff = Benchmarks::compare(expected, pixels);
+            const bool ok = diff.within(argc > 2 ? std::atof(argv[2]) : reference.maxRmse,
+                                        argc > 3 ? std::atof(argv[3]) : reference.maxOutliers);
+            failed = failed || !ok;
+            std::cout << diff.rmse << ' ' << diff.outlierFraction << ' ' << (ok ? "ok" : "FAIL") << std::endl;
+        }
+        return failed ? 1 : 0;
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+        return 2;
+    }
+}
@@ -0,0 +1,115 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Measures closest-hit rays per second through the 10,000 spheres of main.cc, plus a
+// floor of triangles, once as a BoundingIntervalHierarchy of PrimitiveFromFiniteShapes
+// and once as a ShapeStore.
+//
+// Usage: excygen-shapestore [rays=500000 [repetitions=3]]
+//
+// Rays start above the floor and go in random directions into the spheres. Prints
+// million rays per second, and the rays for which both disagree on material, or on
+// distance beyond rounding (-ffast-math contracts differently where a sphere is tested
+// through a virtual call), of which there should be none.
+
+#include "Scene.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Triangle.hh"
+#include "Primitives/PrimitiveFromFiniteShape.hh"
+#include "Primitives/BoundingIntervalHierarchy.hh"
+#include "Primitives/ShapeStore.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+    using namespace excyrender::Primitives;
+    using Geometry::Point;
+
+    template <typename F>
+    double measure(char const *name, std::vector<Geometry::Ray> const &rays, int repetitions, F trace) {
+        long hits = 0;
+        const double start = omp_get_wtime();
+        for (int r=0; r!=repetitions; ++r)
+            for (auto const &ray : rays)
+                hits += !!trace(ray);
+        const double elapsed = omp_get_wtime() - start,
+                     mrays = 1e-6 * double(rays.size()) * repetitions / elapsed;
+        std::cout << name << "  " << mrays << " Mrays/s   " << hits / repetitions << " hits" << std::endl;
+        return mrays;
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        using namespace Photometry;
+        using namespace Photometry::Texture;
+        const int count = argc > 1 ? std::atoi(argv[1]) : 500000;
+        const int repetitions = argc > 2 ? std::atoi(argv[2]) : 3;
+
+        Scene scene;
+        BoundingIntervalHierarchyBuilder objects;
+        ShapeStoreBuilder store;
+
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<real> d(0, 1);
+        for (int i=0; i<10000; ++i) {
+            const real x = d(mt)*100 - 50, z = 4 + d(mt)*100 - 10, r = 0.05 + d(mt)*0.3, y = r-1;
+            const Spectrum color = Spectrum::FromRGB(400,800,8, {d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4),
+                                                                 d(mt)*real(0.6)+real(0.4)});
+            const auto material = scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+                                      shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(color)))));
+            const Shapes::Sphere sphere({x,y,z}, r);
+            objects.add(std::shared_ptr<FinitePrimitive>(new PrimitiveFromFiniteShape(
+                            std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere(sphere)), material)));
+            store.add(sphere, store.material(material));
+        }
+        const auto gray = scene.add(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+                              shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(Spectrum::Gray(400,800,8,0.5))))));
+        for (int z=-10; z<94; z+=8) {
+            for (int x=-50; x<50; x+=8) {
+                const Point A(x,-1,z+8), B(x+8,-1,z+8), C(x,-1,z), D(x+8,-1,z);
+                for (auto const &t : {Shapes::Triangle(A,B,C), Shapes::Triangle(C,B,D)}) {
+                    objects.add(std::shared_ptr<FinitePrimitive>(new PrimitiveFromFiniteShape(
+                                    std::shared_ptr<Shapes::FiniteShape>(new Shapes::Triangle(t)), gray)));
+                    store.add(t, store.material(gray));
+                }
+            }
+        }
+        const auto bih = objects.finalize(20);
+        const auto flat = store.finalize(20);
+
+        std::vector<Geometry::Ray> rays;
+        for (int i=0; i!=count; ++i) {
+            const Point origin(d(mt)*100 - 50, d(mt)*2, d(mt)*100 - 10);
+            rays.emplace_back(origin, Geometry::direction(d(mt)-real(0.5), d(mt)*real(-0.3), d(mt)-real(0.5)));
+        }
+
+        std::cout << flat->spheres() << " spheres, " << flat->triangles() << " triangles, "
+                  << count << " rays" << std::endl;
+        const double a = measure("BoundingIntervalHierarchy", rays, repetitions,
+                                 [&](Geometry::Ray const &ray) { return bih->intersect(ray); });
+        const double b = measure("ShapeStore               ", rays, repetitions,
+                                 [&](Geometry::Ray const &ray) { return flat->intersect(ray); });
+        long differ = 0;
+        for (auto const &ray : rays) {
+            const auto i = bih->intersect(ray), j = flat->intersect(ray);
+            differ += !i != !j || (i && (std::fabs(distance(*i) - distance(*j)) > real(1e-4) * distance(*i)
+                                         || i->material != j->material));
+        }
+        std::cout << "speedup " << b / a << ", " << differ << " rays differ" << std::endl;
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
@@ -0,0 +1,130 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Measures filtered lookups from tiled textures under a memory budget.
+//
+// Usage: excygen-texturecache [textures [size [budget-MiB [directory]]]]
+//
+// Writes 'textures' procedural size x size textures (U8) to 'directory', checks that
+// texels read back as written, then looks them up with EWA filtering from all threads:
+// each thread walks over one texture at a time, with footprints from a texel to a few
+// hundred, as pixels of a landscape would. Prints lookups per second, cache misses and
+// evictions, the peak of resident tiles and the growth of the resident set of the
+// process, next to
+// what the same textures would take as detail::Image.
+
+#include "TextureCache/TiledImage.hh"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <string>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+#include <unistd.h>
+
+namespace {
+    using namespace excyrender;
+
+    std::vector<Photometry::RGB> pattern(unsigned int size, int seed) {
+        std::vector<Photometry::RGB> ret(size*size);
+        for (unsigned int y=0; y!=size; ++y) {
+            for (unsigned int x=0; x!=size; ++x) {
+                const real u = real(x) / size, v = real(y) / size;
+                ret[y*size + x] = Photometry::RGB(
+                    0.5 + 0.5*std::sin(40*u + seed),
+                    ((x/16 + y/16 + seed) % 2) ? 0.8 : 0.2,
+                    0.5 + 0.5*std::cos(25*v*u + seed));
+            }
+        }
+        return ret;
+    }
+
+    double residentMiB() {
+        std::ifstream statm("/proc/self/statm");
+        long pages = 0, resident = 0;
+        statm >> pages >> resident;
+        return resident * double(::sysconf(_SC_PAGESIZE)) / (1 << 20);
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        const int count = argc > 1 ? std::atoi(argv[1]) : 8;
+        const unsigned int size = argc > 2 ? std::atoi(argv[2]) : 2048;
+        const std::size_t budget = std::size_t(argc > 3 ? std::atof(argv[3]) : 64) * (1 << 20);
+        const std::string directory = argc > 4 ? argv[4] : "/tmp";
+
+        std::vector<std::string> files;
+        for (int i=0; i!=count; ++i) {
+            files.push_back(directory + "/excygen-texturecache-" + std::to_string(i) + ".tex");
+            const auto rgb = pattern(size, i);
+            TextureCache::write(files.back(), size, size, rgb, TextureCache::TexelFormat::U8);
+
+            if (i == 0) {
+                TextureCache::TiledImage image(files.back());
+                real maxError = 0;
+                for (unsigned int y=0; y<size; y+=7) {
+                    for (unsigned int x=0; x<size; x+=5) {
+                        const auto a = image.texel(0, x, y), b = rgb[y*size + x];
+                        maxError = std::max(maxError, std::max(std::fabs(a.r-b.r),
+                                            std::max(std::fabs(a.g-b.g), std::fabs(a.b-b.b))));
+                    }
+                }
+                std::cout << "max texel error " << maxError << " (U8 quantization is "
+                          << real(0.5)/255 << ")" << std::endl;
+            }
+        }
+
+        TextureCache::TileCache cache(budget);
+        std::vector<std::unique_ptr<TextureCache::TiledImage>> images;
+        for (auto const &f : files)
+            images.emplace_back(new TextureCache::TiledImage(f, detail::ImageWrap::Wrap, cache));
+
+        const double residentBefore = residentMiB();
+        const long lookups = 2000000;
+        real checksum = 0;
+        const double start = omp_get_wtime();
+        #pragma omp parallel reduction(+:checksum)
+        {
+            std::mt19937 mt(omp_get_thread_num());
+            std::uniform_real_distribution<real> d(0, 1);
+            #pragma omp for schedule(static)
+            for (long i=0; i<lookups; i+=256) {
+                // A run of neighbouring pixels on one texture.
+                TextureCache::TiledImage const &image = *images[mt() % images.size()];
+                real s = d(mt), t = d(mt);
+                const real footprint = std::pow(real(2), -std::floor(d(mt)*9)) / size * 256;
+                for (int j=0; j!=256; ++j) {
+                    s += footprint;
+                    const auto c = image.filtered(s, t, footprint, 0, footprint*0.3, footprint);
+                    checksum += c.r + c.g + c.b;
+                }
+            }
+        }
+        const double elapsed = omp_get_wtime() - start;
+
+        const auto stats = cache.stats();
+        const double inMemory = double(count) * size * size * 4/3 * 32 / (1 << 20);
+        std::cout << count << " textures of " << size << "x" << size << ", budget "
+                  << budget / (1 << 20) << " MiB, " << omp_get_max_threads() << " threads\n"
+                  << "lookups/s     " << long(lookups / elapsed) << '\n'
+                  << "misses        " << stats.misses << '\n'
+                  << "evictions     " << stats.evictions << '\n'
+                  << "peak tiles    " << stats.peak / double(1 << 20) << " MiB\n"
+                  << "resident set  +" << residentMiB() - residentBefore << " MiB while looking up\n"
+                  << "as Image      " << inMemory << " MiB\n"
+                  << "(checksum " << checksum << ")" << std::endl;
+
+        images.clear();
+        for (auto const &f : files)
+            std::remove(f.c_str());
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
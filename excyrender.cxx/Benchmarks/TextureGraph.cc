@@ -0,0 +1,174 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Compares a layered terrain texture evaluated as a tree of virtual textures with the
+// same tree compiled to a Texture::Program, per hit and in batches.
+//
+// Usage: excygen-texturegraph [hits=65536 [repetitions=20]]
+//
+// The texture blends grass, dirt, rock and snow by procedural noise, slope and height,
+// with a disabled puddle layer and a few constant factors for the compiler to fold.
+// Prints the size of the program, nanoseconds per hit for each way of evaluating, and
+// the largest difference of a bin from the tree's result.
+
+#include "Photometry/Texture/Texture.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+#include "Photometry/Texture/AddTexture.hh"
+#include "Photometry/Texture/MulTexture.hh"
+#include "Photometry/Texture/LerpTexture.hh"
+#include "Photometry/Texture/CompiledTexture.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+    using namespace excyrender::Photometry;
+    using namespace excyrender::Photometry::Texture;
+
+    // Opaque to the compiler, called as they are.
+    struct Noise final : RealTexture {
+        explicit Noise(real frequency) : frequency(frequency) {}
+        real operator() (DifferentialGeometry const &dg) const noexcept {
+            const real x = dg.poi.x*frequency, z = dg.poi.z*frequency;
+            return 0.5 + 0.25*std::sin(x + 2*std::sin(z)) + 0.25*std::sin(z*1.3 - x*0.7);
+        }
+    private:
+        real frequency;
+    };
+
+    struct Slope final : RealTexture {
+        real operator() (DifferentialGeometry const &dg) const noexcept {
+            return std::min(real(1), std::max(real(0), (real(0.9) - dg.nn.y()) * 4));
+        }
+    };
+
+    struct Height final : RealTexture {
+        real operator() (DifferentialGeometry const &dg) const noexcept {
+            return std::min(real(1), std::max(real(0), (dg.poi.y - 20) / 10));
+        }
+    };
+
+    // An RGB lookup, compiled like an ImageTexture.
+    struct Strata final : SpectrumTexture {
+        Spectrum operator() (DifferentialGeometry const &dg) const noexcept {
+            return Spectrum::FromRGB(400,800,8, rgb(dg));
+        }
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return b.rgb(this, &Strata::lookup, false);
+        }
+    private:
+        static RGB rgb(DifferentialGeometry const &dg) noexcept {
+            const real s = 0.5 + 0.5*std::sin(dg.poi.y * 3);
+            return RGB(0.4 + 0.2*s, 0.38 + 0.15*s, 0.35 + 0.1*s);
+        }
+        static RGB lookup(void const *, DifferentialGeometry const &dg) {
+            return rgb(dg);
+        }
+    };
+
+    template <typename T>
+    shared_ptr<ConstantTexture<T>> constant(T const &v) {
+        return std::make_shared<ConstantTexture<T>>(v);
+    }
+    shared_ptr<ConstantTexture<Spectrum>> color(real r, real g, real b) {
+        return constant(Spectrum::FromRGB(400,800,8, RGB(r,g,b)));
+    }
+    template <typename A, typename B>
+    shared_ptr<AddTexture<A,B>> add(shared_ptr<A> a, shared_ptr<B> b) {
+        return std::make_shared<AddTexture<A,B>>(a, b);
+    }
+    template <typename A, typename B>
+    shared_ptr<MulTexture<A,B>> mul(shared_ptr<A> a, shared_ptr<B> b) {
+        return std::make_shared<MulTexture<A,B>>(a, b);
+    }
+    template <typename A, typename B, typename F>
+    shared_ptr<LerpTexture<A,B,F>> lerp(shared_ptr<A> a, shared_ptr<B> b, shared_ptr<F> f) {
+        return std::make_shared<LerpTexture<A,B,F>>(a, b, f);
+    }
+
+    shared_ptr<SpectrumTexture> terrain() {
+        const auto detail = std::make_shared<Noise>(0.7),
+                   patches = std::make_shared<Noise>(0.05);
+        const auto grass = mul(color(0.2,0.5,0.1), lerp(constant(real(0.7)), constant(real(1)), detail));
+        const auto dirt  = add(color(0.3,0.2,0.1), mul(color(0.05,0.05,0.05), detail));
+        const auto rock  = mul(std::make_shared<Strata>(), mul(constant(real(0.8)), constant(real(0.9))));
+        const auto snow  = add(color(0.9,0.9,0.95), color(0,0,0));
+        const auto ground = lerp(grass, dirt, patches);
+        const auto cliff  = lerp(ground, rock, std::make_shared<Slope>());
+        const auto white  = lerp(cliff, snow, std::make_shared<Height>());
+        return lerp(white, color(0.1,0.1,0.12), constant(real(0)));   // no puddles
+    }
+
+    std::vector<DifferentialGeometry> hits(std::size_t count) {
+        std::mt19937 mt(1);
+        std::uniform_real_distribution<real> d(0, 1);
+        std::vector<DifferentialGeometry> ret;
+        for (std::size_t i=0; i!=count; ++i) {
+            const real nx = d(mt)-0.5, nz = d(mt)-0.5, ny = 0.3 + d(mt);
+            const real len = std::sqrt(nx*nx + ny*ny + nz*nz);
+            ret.push_back(DifferentialGeometry(10, Geometry::Point(d(mt)*200-100, d(mt)*40, d(mt)*200-100),
+                                               Geometry::Normal(nx/len, ny/len, nz/len), 0, 0,
+                                               Geometry::Vector(1,0,0)));
+        }
+        return ret;
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        const std::size_t count = argc > 1 ? std::atol(argv[1]) : 65536;
+        const int repetitions = argc > 2 ? std::atoi(argv[2]) : 20;
+
+        const auto tree = terrain();
+        const CompiledTexture<Spectrum> compiled(tree);
+        const auto dgs = hits(count);
+        std::vector<Program::Bins> bins(count);
+
+        std::cout << "program: " << compiled.code().size() << " instructions, "
+                  << compiled.code().constants() << " constants" << std::endl;
+
+        real maxError = 0;
+        compiled.code()(dgs.data(), count, bins.data());
+        for (std::size_t i=0; i!=count; ++i) {
+            const auto ref = (*tree)(dgs[i]).toDefaultBins();
+            for (std::size_t k=0; k!=ref.size(); ++k)
+                maxError = std::max(maxError, std::fabs(ref[k] - bins[i][k]));
+        }
+
+        real checksum = 0;
+        auto const measure = [&](char const *name, std::function<void()> f) {
+            const double start = omp_get_wtime();
+            for (int r=0; r!=repetitions; ++r)
+                f();
+            const double elapsed = omp_get_wtime() - start;
+            std::cout << name << 1e9 * elapsed / (double(count) * repetitions) << " ns/hit" << std::endl;
+        };
+        measure("tree            ", [&] {
+            for (auto const &dg : dgs)
+                checksum += (*tree)(dg).toY();
+        });
+        measure("compiled        ", [&] {
+            for (auto const &dg : dgs)
+                checksum += compiled(dg).toY();
+        });
+        measure("compiled, batch ", [&] {
+            compiled.code()(dgs.data(), count, bins.data());
+            for (auto const &b : bins)
+                checksum += DefaultSpectralTopology::toY(b.data());
+        });
+
+        std::cout << "max difference  " << maxError << '\n'
+                  << "(checksum " << checksum << ")" << std::endl;
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
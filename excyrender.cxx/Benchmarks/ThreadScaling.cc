@@ -0,0 +1,157 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Measures how intersection throughput scales with the number of OpenMP threads.
+//
+// Each ray is intersected with a terrain and a few thousand spheres that all share a
+// handful of materials, and the BSDF of the hit is built, as the path integrator does.
+// Two variants run on the same scene:
+//
+//  * raw:    hit records carry a plain Material pointer (the current Intersection).
+//  * shared: additionally copies a shared_ptr to the hit material per hit, like the
+//            former shared_ptr-holding Intersection did on its way out of the BIH,
+//            the PrimitiveList and into the integrator.
+//
+// Output is one line per thread count: threads, rays/sec for both variants, and the
+// speedup relative to one thread.
+
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Geometry/Ray.hh"
+#include "Geometry/Direction.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Terrain2d.hh"
+#include "Primitives/PrimitiveList.hh"
+#include "Primitives/PrimitiveFromFiniteShape.hh"
+#include "Primitives/BoundingIntervalHierarchy.hh"
+#include "Photometry/Material/Lambertian.hh"
+#include "Photometry/Texture/ConstantTexture.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+
+    const int ray_count = 400000;
+
+    std::vector<Geometry::Ray> make_rays(int count) {
+        std::mt19937 mt(42);
+        std::uniform_real_distribution<real> d(-1, 1);
+        std::vector<Geometry::Ray> ret;
+        ret.reserve(count);
+        for (int i=0; i!=count; ++i) {
+            ret.push_back(Geometry::Ray({d(mt)*20, 10, -90},
+                                        Geometry::direction(d(mt)*0.5, -0.15 + d(mt)*0.15, 1)));
+        }
+        return ret;
+    }
+
+    // Returns rays/sec. 'shared' non-null enables the shared_ptr variant.
+    double measure(Scene const &scene, std::vector<Geometry::Ray> const &rays, int threads,
+                   std::vector<std::shared_ptr<const Photometry::Material::Material>> const *shared)
+    {
+        omp_set_num_threads(threads);
+        std::vector<MemoryArena> arenas(threads);
+        Primitives::Primitive const &prim = scene.primitive();
+        const int count = static_cast<int>(rays.size());
+
+        real sink = 0;
+        const double start = omp_get_wtime();
+        #pragma omp parallel for schedule(dynamic, 1024) reduction(+:sink)
+        for (int r=0; r<count; ++r) {
+            MemoryArena &arena = arenas[omp_get_thread_num()];
+            if (auto i = prim.intersect(rays[r])) {
+                if (shared) {
+                    for (auto const &m : *shared) {
+                        if (m.get() != i->material)
+                            continue;
+                        std::shared_ptr<const Photometry::Material::Material> a(m), b(a), c(b);
+                        sink += c.use_count() & 1;
+                        break;
+                    }
+                }
+                i->material->bsdf(i->dg, arena);
+                sink += distance(*i);
+                arena.reset();
+            }
+        }
+        const double elapsed = omp_get_wtime() - start;
+        if (sink < 0) // Never true; keeps the loop from being optimised away.
+            std::clog << sink;
+        return count / elapsed;
+    }
+}
+
+int main () {
+    try {
+        using namespace excyrender;
+        using namespace Primitives;
+        using namespace Photometry;
+        using namespace Photometry::Texture;
+
+        Scene scene;
+        std::vector<std::shared_ptr<const Material::Material>> materials;
+        for (int i=0; i!=4; ++i) {
+            materials.push_back(std::shared_ptr<const Material::Material>(new Material::Lambertian(
+                shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(
+                    Spectrum::FromRGB(400,800,8, {real(0.4+0.15*i), 0.5, real(0.9-0.15*i)})))
+            )));
+            scene.add(materials.back());
+        }
+
+        BoundingIntervalHierarchyBuilder builder;
+        builder.add(std::shared_ptr<FinitePrimitive>(new
+            PrimitiveFromFiniteShape(std::shared_ptr<Shapes::FiniteShape>(new Shapes::Terrain2d(
+                                         Geometry::Rectangle({-100,-100},{100,100}),
+                                         Geometry::Rectangle({0,0},{100,100}),
+                                         512,
+                                         [](real u,real v) { return -4 + 5*std::sin(u) * std::sin(v); })),
+                                     materials[0].get())));
+        std::mt19937 mt(7);
+        std::uniform_real_distribution<real> d(0, 1);
+        for (int i=0; i!=5000; ++i) {
+            const real x = d(mt)*100 - 50, z = d(mt)*100 - 10, r = 0.05 + d(mt)*0.3;
+            builder.add(std::shared_ptr<FinitePrimitive>(new
+                PrimitiveFromFiniteShape(std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere({x, 2+r, z}, r)),
+                                         materials[i % materials.size()].get())));
+        }
+        scene.setPrimitive(std::shared_ptr<Primitive>(new PrimitiveList({builder.finalize(20)})));
+
+        const auto rays = make_rays(ray_count);
+        const int max_threads = omp_get_max_threads();
+
+        std::cout << std::left
+                  << std::setw(8)  << "threads"
+                  << std::setw(14) << "raw-rays/s"   << std::setw(10) << "speedup"
+                  << std::setw(14) << "shared-rays/s" << std::setw(10) << "speedup" << '\n';
+
+        double raw1 = 0, shared1 = 0;
+        for (int threads=1; ; threads = threads*2 > max_threads && threads != max_threads
+                                          ? max_threads : threads*2)
+        {
+            const double raw    = measure(scene, rays, threads, nullptr),
+                         shared = measure(scene, rays, threads, &materials);
+            if (threads == 1) {
+                raw1 = raw;
+                shared1 = shared;
+            }
+            std::cout << std::setw(8)  << threads
+                      << std::setw(14) << static_cast<long>(raw)    << std::setw(10) << raw/raw1
+                      << std::setw(14) << static_cast<long>(shared) << std::setw(10) << shared/shared1
+                      << std::endl;
+            if (threads == max_threads)
+                break;
+        }
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
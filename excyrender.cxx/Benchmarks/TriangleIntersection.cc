@@ -0,0 +1,163 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// Measures ray/triangle tests per second of Shapes::Triangle, called directly and
+// through FiniteShape as the BoundingIntervalHierarchy does, against TriangleBlock of
+// 4 and 8 lanes, with precomputed edges and watertight.
+//
+// Usage: excygen-triangles [rays=200000 [repetitions=5]]
+//
+// The triangles are those of a bumpy height field of 64x64 cells. Each ray is shot from
+// above at a random point of a random run of 4 cells, and tested against the 8 triangles
+// of that run, as a leaf of the terrain would be. Then, rays are shot at points on the
+// diagonals of the cells; a ray that hits neither triangle of a cell has found a crack.
+// Prints million tests per second, hits, and cracks found.
+
+#include "Shapes/Triangle.hh"
+#include "Shapes/TriangleBlock.hh"
+
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <typeinfo>
+#include <vector>
+#include <omp.h>
+
+namespace {
+    using namespace excyrender;
+    using namespace excyrender::Shapes;
+    using Geometry::Point;
+
+    const int cells = 64, runLength = 4;
+
+    struct Tri { Point A, B, C; };
+
+    // Two triangles per cell, eight per run of cells, runs row by row.
+    std::vector<Tri> heightField() {
+        std::mt19937 mt(7);
+        std::uniform_real_distribution<real> d(-0.3, 0.3);
+        std::vector<Point> grid;
+        for (int z=0; z<=cells; ++z)
+            for (int x=0; x<=cells; ++x)
+                grid.push_back({x*real(0.37), real(std::sin(x*0.4)*std::cos(z*0.3)) + d(mt), z*real(0.37)});
+        std::vector<Tri> ret;
+        for (int z=0; z!=cells; ++z) {
+            for (int x=0; x!=cells; ++x) {
+                Point const &A = grid[(z+1)*(cells+1) + x], &B = grid[(z+1)*(cells+1) + x+1],
+                            &C = grid[z*(cells+1) + x],     &D = grid[z*(cells+1) + x+1];
+                ret.push_back({A,B,C});
+                ret.push_back({C,B,D});
+            }
+        }
+        return ret;
+    }
+
+    struct Query {
+        Geometry::Ray ray;
+        int run;        // index of the first triangle / 8
+    };
+
+    std::vector<Query> rays(std::vector<Tri> const &tris, int count, bool edges) {
+        std::mt19937 mt(11);
+        std::uniform_real_distribution<real> d(0, 1);
+        std::vector<Query> ret;
+        const int runs = tris.size() / (2*runLength);
+        for (int n=0; n!=count; ++n) {
+            const int run = std::min(int(d(mt)*runs), runs-1);
+            const int i = run*2*runLength + std::min(int(d(mt)*2*runLength), 2*runLength-1);
+            Geometry::Vector target;
+            if (edges) {
+                // On the diagonal of the cell, edge B-C of its first triangle.
+                Tri const &t = tris[i & ~1];
+                const real s = d(mt);
+                target = static_cast<Geometry::Vector>(t.B)*(1-s) + static_cast<Geometry::Vector>(t.C)*s;
+            } else {
+                Tri const &t = tris[i];
+                real a = d(mt), b = d(mt);
+                if (a+b > 1) { a = 1-a; b = 1-b; }
+                target = static_cast<Geometry::Vector>(t.A) + (t.B-t.A)*a + (t.C-t.A)*b;
+            }
+            const Point origin(target.x + (d(mt)-0.5)*3, 5 + d(mt)*3, target.z + (d(mt)-0.5)*3);
+            ret.push_back({Geometry::Ray(origin, Geometry::Direction::Normalize(Point(target) - origin)), run});
+        }
+        return ret;
+    }
+
+    template <typename F>
+    void measure(char const *name, std::vector<Query> const &qs, std::vector<Query> const &edges,
+                 int repetitions, F test)
+    {
+        long hits = 0;
+        const double start = omp_get_wtime();
+        for (int r=0; r!=repetitions; ++r)
+            for (auto const &q : qs)
+                hits += test(q);
+        const double elapsed = omp_get_wtime() - start;
+        long misses = 0;
+        for (auto const &q : edges)
+            misses += !test(q);
+        std::cout << name << "  " << 1e-6 * double(qs.size()) * repetitions * 2*runLength / elapsed
+                  << " Mtests/s   " << hits / repetitions << " hits   "
+                  << misses << " cracks" << std::endl;
+    }
+
+    template <int N, TriangleTest Test>
+    void measureBlocks(char const *name, std::vector<Tri> const &tris, std::vector<Query> const &qs,
+                       std::vector<Query> const &edges, int repetitions)
+    {
+        std::vector<TriangleBlock<N,Test>> blocks;
+        for (std::size_t i=0; i!=tris.size(); ++i) {
+            if (i % N == 0)
+                blocks.emplace_back();
+            blocks.back().add(tris[i].A, tris[i].B, tris[i].C);
+        }
+        const int perRun = 2*runLength / N;
+        measure(name, qs, edges, repetitions, [&](Query const &q) {
+            bool hit = false;
+            for (int b=0; b!=perRun; ++b)
+                hit = !!blocks[q.run*perRun + b].intersect(q.ray) || hit;
+            return hit;
+        });
+    }
+}
+
+int main (int argc, char *argv[]) {
+    try {
+        const int count = argc > 1 ? std::atoi(argv[1]) : 200000;
+        const int repetitions = argc > 2 ? std::atoi(argv[2]) : 5;
+
+        const auto tris = heightField();
+        const auto qs = rays(tris, count, false), edges = rays(tris, count, true);
+
+        std::vector<Triangle> triangles;
+        std::vector<std::shared_ptr<FiniteShape>> shapes;
+        for (auto const &t : tris) {
+            triangles.emplace_back(t.A, t.B, t.C);
+            shapes.emplace_back(new Triangle(t.A, t.B, t.C));
+        }
+
+        std::cout << tris.size() << " triangles, " << count << " rays of "
+                  << 2*runLength << " tests" << std::endl;
+        measure("Triangle                   ", qs, edges, repetitions, [&](Query const &q) {
+            bool hit = false;
+            for (int i=0; i!=2*runLength; ++i)
+                hit = !!triangles[q.run*2*runLength + i].intersect(q.ray) || hit;
+            return hit;
+        });
+        measure("Triangle, as FiniteShape   ", qs, edges, repetitions, [&](Query const &q) {
+            bool hit = false;
+            for (int i=0; i!=2*runLength; ++i)
+                hit = !!shapes[q.run*2*runLength + i]->intersect(q.ray) || hit;
+            return hit;
+        });
+        measureBlocks<4, TriangleTest::Precomputed>("TriangleBlock<4>, precomp. ", tris, qs, edges, repetitions);
+        measureBlocks<8, TriangleTest::Precomputed>("TriangleBlock<8>, precomp. ", tris, qs, edges, repetitions);
+        measureBlocks<4, TriangleTest::Watertight> ("TriangleBlock<4>, watert.  ", tris, qs, edges, repetitions);
+        measureBlocks<8, TriangleTest::Watertight> ("TriangleBlock<8>, watert.  ", tris, qs, edges, repetitions);
+    } catch (std::exception &e) {
+        std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
+    }
+}
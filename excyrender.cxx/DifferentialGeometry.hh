@@ -8,6 +8,8 @@
 #include "Geometry/Normal.hh"
 #include "Geometry/Direction.hh"
 #include "Geometry/Vector.hh"
+#include "Geometry/Ray.hh"
+#include <cmath>
 
 namespace excyrender {
     struct DifferentialGeometry
@@ -15,8 +17,10 @@ namespace excyrender {
         DifferentialGeometry() = delete;
 
         DifferentialGeometry(real d, Geometry::Point const &poi, Geometry::Normal const &nn,
-                             real u, real v, Geometry::Vector dpdu)
-           : d(d), poi(poi), nn(nn), u(u), v(v), dpdu(dpdu)
+                             real u, real v, Geometry::Vector dpdu,
+                             Geometry::Vector dpdv = Geometry::Vector())
+           : d(d), poi(poi), nn(nn), ng(nn), u(u), v(v), dpdu(dpdu), dpdv(dpdv),
+             dudx(0), dvdx(0), dudy(0), dvdy(0)
         {
         }
 
@@ -24,8 +28,15 @@ namespace excyrender {
         real d;
         Geometry::Point poi;
         Geometry::Normal nn;
+        Geometry::Normal ng;    // of the actual surface, where nn is interpolated; as nn else
         real u, v;
         Geometry::Vector dpdu;
+        Geometry::Vector dpdv;  // zero where the shape has no (u,v) parametrisation
+
+        // Change of poi and (u,v) from one pixel to the next, zero if unknown. Set by
+        // computeDifferentials().
+        Geometry::Vector dpdx, dpdy;
+        real dudx, dvdx, dudy, dvdy;
         // -- shape :: Shape <-- This is as PBRT has it, but it would produce a
         //--                    recursive dependency
     };
@@ -47,6 +58,72 @@ namespace excyrender {
                 s.z*dir.x() + n.z*dir.y() + t.z*dir.z()};
     }
 
+    // Where to start a ray that leaves the surface at 'poi' towards 'dir': 'poi', pushed off
+    // the surface along 'nn' to the side of 'dir', by more than the error 'poi' may have
+    // been computed with. That error grows with the magnitude of the coordinates and is a
+    // lot larger for single precision reals, where a fixed epsilon gives self-intersection
+    // acne on all but the nearest surfaces.
+    inline Geometry::Point offsetOrigin (Geometry::Point const &poi, Geometry::Normal const &nn,
+                                         Geometry::Direction const &dir) noexcept
+    {
+        const real magnitude = max(max(std::fabs(poi.x), std::fabs(poi.y)), std::fabs(poi.z)),
+                   offset = rounding_error * (1 + magnitude),
+                   side = dot(static_cast<Geometry::Direction>(nn), dir) < 0 ? -offset : offset;
+        return poi + Geometry::Vector(nn.x()*side, nn.y()*side, nn.z()*side);
+    }
+
+    inline Geometry::Point offsetOrigin (DifferentialGeometry const &dg, Geometry::Direction const &dir) noexcept {
+        return offsetOrigin(dg.poi, dg.nn, dir);
+    }
+
+    // Intersects the neighbouring rays of 'ray' with the tangent plane at dg.poi, as in
+    // PBRT, to get the pixel footprint on the surface. Leaves the differentials at zero
+    // if 'ray' has none or they are (nearly) parallel to the surface.
+    //
+    // The plane is that of dg.ng, the surface the neighbouring rays actually hit. dpdu and
+    // dpdv are expected in the plane of dg.nn, for shading frames; so are the steps once
+    // projected along dg.nn, and du/dv are solved for there, which is exact as projecting
+    // is linear.
+    inline void computeDifferentials(DifferentialGeometry &dg,
+                                     Geometry::RayDifferential const &ray) noexcept
+    {
+        using namespace Geometry;
+        if (!ray.hasDifferentials)
+            return;
+        const Vector g {dg.ng.x(), dg.ng.y(), dg.ng.z()},
+                     p = dg.poi - Point(0,0,0);
+        const real d = dot(g, p),
+                   nx = dot(g, ray.rxDirection),
+                   ny = dot(g, ray.ryDirection);
+        if (nx == 0 || ny == 0)
+            return;
+        const real tx = (d - dot(g, ray.rxOrigin - Point(0,0,0))) / nx,
+                   ty = (d - dot(g, ray.ryOrigin - Point(0,0,0))) / ny;
+        if (!std::isfinite(tx) || !std::isfinite(ty))
+            return;
+        dg.dpdx = (ray.rxOrigin + ray.rxDirection*tx) - dg.poi;
+        dg.dpdy = (ray.ryOrigin + ray.ryDirection*ty) - dg.poi;
+
+        // (u,v) derivatives from dp = dpdu*du + dpdv*dv, solved in the two dimensions
+        // where the surface is least foreshortened.
+        const Vector n {dg.nn.x(), dg.nn.y(), dg.nn.z()},
+                     sx = dg.dpdx - n * dot(n, dg.dpdx),
+                     sy = dg.dpdy - n * dot(n, dg.dpdy);
+        const real ax = std::fabs(n.x), ay = std::fabs(n.y), az = std::fabs(n.z);
+        auto const at = [](Vector const &v, int i) { return i==0 ? v.x : i==1 ? v.y : v.z; };
+        const int i0 = ax > ay && ax > az ? 1 : 0,
+                  i1 = ax > ay && ax > az ? 2 : ay > az ? 2 : 1;
+        const real a00 = at(dg.dpdu, i0), a01 = at(dg.dpdv, i0),
+                   a10 = at(dg.dpdu, i1), a11 = at(dg.dpdv, i1),
+                   det = a00*a11 - a01*a10;
+        if (std::fabs(det) < real(1e-10))
+            return;
+        dg.dudx = (a11*at(sx, i0) - a01*at(sx, i1)) / det;
+        dg.dvdx = (a00*at(sx, i1) - a10*at(sx, i0)) / det;
+        dg.dudy = (a11*at(sy, i0) - a01*at(sy, i1)) / det;
+        dg.dvdy = (a00*at(sy, i1) - a10*at(sy, i0)) / det;
+    }
+
     inline real distance(DifferentialGeometry const &dg) noexcept {
         return dg.d;
     }
@@ -5,11 +5,24 @@
 #define DIRECTION_HH_INCLUDED_20130709
 
 #include "Vector.hh"
+#include <algorithm>
 #include <cassert>
 #include <stdexcept>
 
 namespace excyrender {
     namespace Geometry {
+        // How far x*x+y*y+z*z of a Direction or Normal may be off 1.
+        static constexpr real unit_tolerance = real(0.00001);
+
+        constexpr inline bool is_unit(real x, real y, real z) noexcept {
+            return excyrender::fabs(x*x + y*y + z*z - 1) <= unit_tolerance;
+        }
+
+        // Passed to the constructors of Direction and Normal for components that are known
+        // to make a unit vector, as those of a normalized vector or of another Direction:
+        // the check is skipped, but for an assertion in builds without NDEBUG.
+        struct Unchecked {};
+
         struct Direction {
             constexpr real x() const { return x_; }
             constexpr real y() const { return y_; }
@@ -18,8 +31,12 @@ namespace excyrender {
             Direction() = delete;
 
             constexpr Direction(real x, real y, real z)
-            : x_(ensure_normalized(x, excyrender::fabs(x*x + y*y + z*z)-1 <= 0.00001)),
-              y_(y), z_(z)
+            : x_(ensure_normalized(x, is_unit(x, y, z))), y_(y), z_(z)
+            {
+            }
+
+            constexpr Direction(real x, real y, real z, Unchecked) noexcept
+            : x_((assert(is_unit(x, y, z)), x)), y_(y), z_(z)
             {
             }
 
@@ -32,7 +49,7 @@ namespace excyrender {
 
             static Direction Normalize(Vector v) noexcept {
                 v = normalize(v);
-                return {v.x, v.y, v.z};
+                return {v.x, v.y, v.z, Unchecked()};
             }
 
             explicit operator Vector () const noexcept {
@@ -53,30 +70,29 @@ namespace excyrender {
             }
 
             friend constexpr inline Direction operator- (Direction const &v) noexcept {
-                // Note: Even though this uses a non-noexcept constructor,
-                //       it never throws because it only negates an
-                //       already constructed Normal.
-                return {-v.x_, -v.y_, -v.z_};
+                return {-v.x_, -v.y_, -v.z_, Unchecked()};
             }
 
         private:
 
-            const real x_, y_, z_;
+            // Not const, so that Directions (and Rays) are assignable; the interface keeps
+            // them immutable otherwise.
+            real x_, y_, z_;
 
             static constexpr real ensure_normalized(real x, bool c) {
                 return c ? x :
-                        throw std::runtime_error("|x*x+y*y+z*z| > 0.00001 in Direction(x,y,z)");
+                        throw std::runtime_error("|x*x+y*y+z*z-1| > unit_tolerance in Direction(x,y,z)");
             }
         };
 
         inline Direction direction(real x, real y, real z) noexcept {
             const auto l = std::sqrt(x*x + y*y + z*z);
-            return {x/l, y/l, z/l};
+            return {x/l, y/l, z/l, Unchecked()};
         }
 
         inline Direction direction(Vector const &v) noexcept {
             const auto l = std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
-            return {v.x/l, v.y/l, v.z/l};
+            return {v.x/l, v.y/l, v.z/l, Unchecked()};
         }
 
 
@@ -89,7 +105,20 @@ namespace excyrender {
                        sinTheta = std::sqrt(1-x2);
             return {std::cos(phi) * sinTheta,
                     cosTheta,
-                    std::sin(phi) * sinTheta};
+                    std::sin(phi) * sinTheta,
+                    Unchecked()};
+        }
+
+        // Uniform over the hemisphere around +y, from two numbers in [0,1). The density
+        // is 1/(2 pi) per steradian.
+        inline Direction uniformHemisphere (real u0, real u1) noexcept {
+            const auto phi = 2*pi*u0,
+                       cosTheta = u1,
+                       sinTheta = std::sqrt(std::max(real(0), 1-u1*u1));
+            return {std::cos(phi) * sinTheta,
+                    cosTheta,
+                    std::sin(phi) * sinTheta,
+                    Unchecked()};
         }
 
         inline std::ostream& operator<< (std::ostream &os, Direction const &v) noexcept {
@@ -17,14 +17,18 @@ namespace excyrender {
             Normal() = delete;
 
             constexpr Normal(real x, real y, real z)
-            : x_(ensure_normalized(x, excyrender::fabs(x*x + y*y + z*z)-1 <= 0.00001)),
-              y_(y), z_(z)
+            : x_(ensure_normalized(x, is_unit(x, y, z))), y_(y), z_(z)
+            {
+            }
+
+            constexpr Normal(real x, real y, real z, Unchecked) noexcept
+            : x_((assert(is_unit(x, y, z)), x)), y_(y), z_(z)
             {
             }
 
             static Normal Normalize(Vector v) noexcept {
                 v = normalize(v);
-                return {v.x, v.y, v.z};
+                return {v.x, v.y, v.z, Unchecked()};
             }
 
             explicit constexpr operator Vector () const noexcept {
@@ -32,10 +36,10 @@ namespace excyrender {
             }
 
             explicit constexpr operator Direction () const noexcept {
-                return {x_,y_,z_};
+                return {x_,y_,z_, Unchecked()};
             }
 
-            explicit constexpr Normal(Direction const &dir) : x_(dir.x()), y_(dir.y()), z_(dir.z())
+            explicit constexpr Normal(Direction const &dir) noexcept : x_(dir.x()), y_(dir.y()), z_(dir.z())
             {
             }
 
@@ -54,10 +58,7 @@ namespace excyrender {
             }
 
             friend constexpr inline Normal operator- (Normal const &v) noexcept {
-                // Note: Even though this uses a non-noexcept constructor,
-                //       it never throws because it only negates an
-                //       already constructed Normal.
-                return {-v.x_, -v.y_, -v.z_};
+                return {-v.x_, -v.y_, -v.z_, Unchecked()};
             }
 
             inline void swap(Normal &rhs) noexcept {
@@ -71,7 +72,7 @@ namespace excyrender {
 
             static constexpr real ensure_normalized(real x, bool c) {
                 return c ? x :
-                        throw std::runtime_error("|x*x+y*y+z*z| > 0.00001 in Normal(x,y,z)");
+                        throw std::runtime_error("|x*x+y*y+z*z-1| > unit_tolerance in Normal(x,y,z)");
             }
         };
 
@@ -81,12 +82,12 @@ namespace excyrender {
 
         inline Normal normal(real x, real y, real z) noexcept {
             const auto l = std::sqrt(x*x + y*y + z*z);
-            return {x/l, y/l, z/l};
+            return {x/l, y/l, z/l, Unchecked()};
         }
 
         inline Normal normal(Vector const &v) noexcept {
             const auto l = std::sqrt(v.x*v.x + v.y*v.y + v.z*v.z);
-            return {v.x/l, v.y/l, v.z/l};
+            return {v.x/l, v.y/l, v.z/l, Unchecked()};
         }
 
 
@@ -23,6 +23,31 @@ namespace excyrender {
             }
         };
 
+        // A camera ray together with the rays through the neighbouring film positions in x
+        // and y, which give the footprint of the pixel where the ray hits a surface (see
+        // computeDifferentials()). Rays spawned at surfaces carry no differentials.
+        struct RayDifferential : Ray {
+            bool hasDifferentials = false;
+            Point rxOrigin, ryOrigin;
+            Vector rxDirection, ryDirection;
+
+            RayDifferential(Ray const &ray) : Ray(ray) {}
+
+            RayDifferential(Point const &origin, Direction const &direction)
+                : Ray(origin, direction)
+            {}
+
+            // Moves the neighbouring rays towards this one, e.g. by 1/sqrt(spp) when each
+            // sample only has to cover part of the pixel.
+            void scaleDifferentials(real f) noexcept {
+                const Vector d = static_cast<Vector>(direction);
+                rxOrigin = origin + (rxOrigin - origin) * f;
+                ryOrigin = origin + (ryOrigin - origin) * f;
+                rxDirection = d + (rxDirection - d) * f;
+                ryDirection = d + (ryDirection - d) * f;
+            }
+        };
+
         inline std::ostream& operator<< (std::ostream &os, Ray const &v) noexcept {
             return os << "ray{" << v.origin << "," << v.direction << '}';
         }
@@ -0,0 +1,53 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SIMD_RAY_HH_INCLUDED_20130907
+#define SIMD_RAY_HH_INCLUDED_20130907
+
+#include "Geometry/Simd/Vector.hh"
+#include "Geometry/Ray.hh"
+
+namespace excyrender { namespace Geometry { namespace Simd {
+
+    // N rays, e.g. the camera rays of neighbouring pixels, traced together.
+    template <int N>
+    struct Ray {
+        Point<N> origin;
+        Direction<N> direction;
+
+        Ray() noexcept = default;
+        Ray(Point<N> const &origin, Direction<N> const &direction) noexcept
+            : origin(origin), direction(direction)
+        {}
+
+        // All lanes 'ray'.
+        explicit Ray(Geometry::Ray const &ray) noexcept
+            : origin(ray.origin), direction(ray.direction)
+        {}
+
+        // Lane i rays[i].
+        explicit Ray(Geometry::Ray const *rays) noexcept {
+            for (int i=0; i!=N; ++i)
+                set(i, rays[i]);
+        }
+
+        Geometry::Ray get(int i) const noexcept {
+            return {origin.get(i), direction.get(i)};
+        }
+
+        void set(int i, Geometry::Ray const &ray) noexcept {
+            origin.set(i, ray.origin);
+            direction.set(i, ray.direction);
+        }
+
+        Point<N> operator() (Real<N> const &f) const noexcept {
+            return origin + direction * f;
+        }
+    };
+
+    typedef Ray<4> Ray4;
+    typedef Ray<8> Ray8;
+
+} } }
+
+#endif // SIMD_RAY_HH_INCLUDED_20130907
@@ -0,0 +1,173 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SIMD_REAL_HH_INCLUDED_20130905
+#define SIMD_REAL_HH_INCLUDED_20130905
+
+#include "real.hh"
+#include <cmath>
+#include <cstring>
+
+namespace excyrender { namespace Geometry { namespace Simd {
+
+    namespace detail {
+        // GCC drops vector_size from typedefs that depend on a template parameter, hence
+        // one specialization per size. Real<N> exists for 4 and 8 lanes of float or double.
+        template <int Bytes> struct VectorOf;
+        template <> struct VectorOf<16> { typedef real type __attribute__((vector_size(16))); };
+        template <> struct VectorOf<32> { typedef real type __attribute__((vector_size(32))); };
+        template <> struct VectorOf<64> { typedef real type __attribute__((vector_size(64))); };
+    }
+
+    template <int N> struct Mask;
+
+    // N reals, operated on at once. A GCC vector: arithmetic and comparisons compile to
+    // the SIMD instructions -march allows, split into as many as needed where N reals do
+    // not fit into one register. Lanes are read with [] and written with set().
+    //
+    // Aligned to its size, which std::vector and new do not give before C++17; therefore,
+    // data that outlives a function is best kept as plain reals, and Load()ed.
+    template <int N>
+    struct Real {
+        typedef typename detail::VectorOf<N * sizeof(real)>::type type;
+        static constexpr int lanes = N;
+
+        type v;
+
+        Real() noexcept = default;                              // uninitialized, as real
+        Real(real f) noexcept : v(type{} + f) {}                // all lanes f
+        Real(type v) noexcept : v(v) {}
+
+        static Real Load(real const *p) noexcept {
+            Real ret;
+            std::memcpy(&ret.v, p, sizeof ret.v);
+            return ret;
+        }
+
+        void store(real *p) const noexcept {
+            std::memcpy(p, &v, sizeof v);
+        }
+
+        real operator[] (int i) const noexcept { return v[i]; }
+        void set(int i, real f) noexcept { v[i] = f; }
+
+        Real& operator+= (Real const &rhs) noexcept { v += rhs.v; return *this; }
+        Real& operator-= (Real const &rhs) noexcept { v -= rhs.v; return *this; }
+        Real& operator*= (Real const &rhs) noexcept { v *= rhs.v; return *this; }
+        Real& operator/= (Real const &rhs) noexcept { v /= rhs.v; return *this; }
+    };
+
+    template <int N> inline Real<N> operator+ (Real<N> const &a, Real<N> const &b) noexcept { return a.v + b.v; }
+    template <int N> inline Real<N> operator- (Real<N> const &a, Real<N> const &b) noexcept { return a.v - b.v; }
+    template <int N> inline Real<N> operator* (Real<N> const &a, Real<N> const &b) noexcept { return a.v * b.v; }
+    template <int N> inline Real<N> operator/ (Real<N> const &a, Real<N> const &b) noexcept { return a.v / b.v; }
+    template <int N> inline Real<N> operator- (Real<N> const &a) noexcept { return -a.v; }
+
+    template <int N> inline Real<N> operator+ (Real<N> const &a, real b) noexcept { return a.v + b; }
+    template <int N> inline Real<N> operator- (Real<N> const &a, real b) noexcept { return a.v - b; }
+    template <int N> inline Real<N> operator* (Real<N> const &a, real b) noexcept { return a.v * b; }
+    template <int N> inline Real<N> operator/ (Real<N> const &a, real b) noexcept { return a.v / b; }
+    template <int N> inline Real<N> operator+ (real a, Real<N> const &b) noexcept { return a + b.v; }
+    template <int N> inline Real<N> operator- (real a, Real<N> const &b) noexcept { return a - b.v; }
+    template <int N> inline Real<N> operator* (real a, Real<N> const &b) noexcept { return a * b.v; }
+    template <int N> inline Real<N> operator/ (real a, Real<N> const &b) noexcept { return a / b.v; }
+
+
+    // Per lane truth, as compared Reals give it.
+    template <int N>
+    struct Mask {
+        typedef decltype(typename Real<N>::type{} < typename Real<N>::type{}) type;
+        static constexpr int lanes = N;
+
+        type m;
+
+        Mask() noexcept = default;
+        Mask(bool b) noexcept : m(type{} + (b ? -1 : 0)) {}
+        Mask(type m) noexcept : m(m) {}
+
+        bool operator[] (int i) const noexcept { return m[i] != 0; }
+    };
+
+    template <int N> inline Mask<N> operator& (Mask<N> const &a, Mask<N> const &b) noexcept { return a.m & b.m; }
+    template <int N> inline Mask<N> operator| (Mask<N> const &a, Mask<N> const &b) noexcept { return a.m | b.m; }
+    template <int N> inline Mask<N> operator! (Mask<N> const &a) noexcept { return ~a.m; }
+
+    template <int N>
+    inline bool any(Mask<N> const &a) noexcept {
+        bool ret = false;
+        for (int i=0; i!=N; ++i)
+            ret |= a.m[i] != 0;
+        return ret;
+    }
+
+    template <int N>
+    inline bool all(Mask<N> const &a) noexcept {
+        bool ret = true;
+        for (int i=0; i!=N; ++i)
+            ret &= a.m[i] != 0;
+        return ret;
+    }
+
+    template <int N> inline bool none(Mask<N> const &a) noexcept { return !any(a); }
+
+    template <int N> inline Mask<N> operator<  (Real<N> const &a, Real<N> const &b) noexcept { return a.v <  b.v; }
+    template <int N> inline Mask<N> operator<= (Real<N> const &a, Real<N> const &b) noexcept { return a.v <= b.v; }
+    template <int N> inline Mask<N> operator>  (Real<N> const &a, Real<N> const &b) noexcept { return a.v >  b.v; }
+    template <int N> inline Mask<N> operator>= (Real<N> const &a, Real<N> const &b) noexcept { return a.v >= b.v; }
+    template <int N> inline Mask<N> operator== (Real<N> const &a, Real<N> const &b) noexcept { return a.v == b.v; }
+    template <int N> inline Mask<N> operator!= (Real<N> const &a, Real<N> const &b) noexcept { return a.v != b.v; }
+    template <int N> inline Mask<N> operator<  (Real<N> const &a, real b) noexcept { return a.v <  b; }
+    template <int N> inline Mask<N> operator<= (Real<N> const &a, real b) noexcept { return a.v <= b; }
+    template <int N> inline Mask<N> operator>  (Real<N> const &a, real b) noexcept { return a.v >  b; }
+    template <int N> inline Mask<N> operator>= (Real<N> const &a, real b) noexcept { return a.v >= b; }
+    template <int N> inline Mask<N> operator== (Real<N> const &a, real b) noexcept { return a.v == b; }
+    template <int N> inline Mask<N> operator!= (Real<N> const &a, real b) noexcept { return a.v != b; }
+
+    // Lanes of 'a' where 'm' holds, of 'b' elsewhere.
+    template <int N>
+    inline Real<N> select(Mask<N> const &m, Real<N> const &a, Real<N> const &b) noexcept {
+        return m.m ? a.v : b.v;
+    }
+
+    template <int N> inline Real<N> min(Real<N> const &a, Real<N> const &b) noexcept { return select(a < b, a, b); }
+    template <int N> inline Real<N> max(Real<N> const &a, Real<N> const &b) noexcept { return select(a > b, a, b); }
+
+    template <int N>
+    inline Real<N> fabs(Real<N> const &a) noexcept {
+        Real<N> ret;
+        for (int i=0; i!=N; ++i)
+            ret.v[i] = std::fabs(a.v[i]);
+        return ret;
+    }
+
+    // A loop, which GCC vectorizes where it has no errno to set (-ffast-math).
+    template <int N>
+    inline Real<N> sqrt(Real<N> const &a) noexcept {
+        Real<N> ret;
+        for (int i=0; i!=N; ++i)
+            ret.v[i] = std::sqrt(a.v[i]);
+        return ret;
+    }
+
+    // Smallest lane, and which one it is.
+    template <int N>
+    inline real hmin(Real<N> const &a, int &lane) noexcept {
+        lane = 0;
+        real ret = a.v[0];
+        for (int i=1; i!=N; ++i) {
+            if (a.v[i] < ret) {
+                ret = a.v[i];
+                lane = i;
+            }
+        }
+        return ret;
+    }
+
+    typedef Real<4> Real4;
+    typedef Real<8> Real8;
+    typedef Mask<4> Mask4;
+    typedef Mask<8> Mask8;
+
+} } }
+
+#endif // SIMD_REAL_HH_INCLUDED_20130905
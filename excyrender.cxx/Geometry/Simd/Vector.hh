@@ -0,0 +1,123 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SIMD_VECTOR_HH_INCLUDED_20130906
+#define SIMD_VECTOR_HH_INCLUDED_20130906
+
+#include "Geometry/Simd/Real.hh"
+#include "Geometry/Vector.hh"
+#include "Geometry/Point.hh"
+#include "Geometry/Direction.hh"
+#include <cassert>
+
+namespace excyrender { namespace Geometry { namespace Simd {
+
+    // N vectors, points or directions in structure-of-arrays layout: one Real<N> per
+    // axis. Lane i holds the i-th element; get() and set() convert it from and to the
+    // scalar type.
+
+    template <int N>
+    struct Vector {
+        Real<N> x, y, z;
+
+        Vector() noexcept = default;
+        Vector(Real<N> const &x, Real<N> const &y, Real<N> const &z) noexcept : x(x), y(y), z(z) {}
+        explicit Vector(Geometry::Vector const &v) noexcept : x(v.x), y(v.y), z(v.z) {}
+
+        Geometry::Vector get(int i) const noexcept { return {x[i], y[i], z[i]}; }
+        void set(int i, Geometry::Vector const &v) noexcept { x.set(i, v.x); y.set(i, v.y); z.set(i, v.z); }
+    };
+
+    template <int N>
+    struct Point {
+        Real<N> x, y, z;
+
+        Point() noexcept = default;
+        Point(Real<N> const &x, Real<N> const &y, Real<N> const &z) noexcept : x(x), y(y), z(z) {}
+        explicit Point(Geometry::Point const &p) noexcept : x(p.x), y(p.y), z(p.z) {}
+
+        Geometry::Point get(int i) const noexcept { return {x[i], y[i], z[i]}; }
+        void set(int i, Geometry::Point const &p) noexcept { x.set(i, p.x); y.set(i, p.y); z.set(i, p.z); }
+    };
+
+    // Unit vectors. Nothing is checked where N of them are made from components, which
+    // must already be normalized; builds without NDEBUG assert it.
+    template <int N>
+    struct Direction {
+        Real<N> x, y, z;
+
+        Direction() noexcept = default;
+        Direction(Real<N> const &x, Real<N> const &y, Real<N> const &z) noexcept : x(x), y(y), z(z) {
+            assert(all(fabs(x*x + y*y + z*z - real(1)) <= Geometry::unit_tolerance));
+        }
+        explicit Direction(Geometry::Direction const &d) noexcept : x(d.x()), y(d.y()), z(d.z()) {}
+
+        Geometry::Direction get(int i) const noexcept {
+            return Geometry::Direction(x[i], y[i], z[i], Geometry::Unchecked());
+        }
+        void set(int i, Geometry::Direction const &d) noexcept { x.set(i, d.x()); y.set(i, d.y()); z.set(i, d.z()); }
+    };
+
+
+    template <int N> inline Vector<N> operator+ (Vector<N> const &a, Vector<N> const &b) noexcept { return {a.x+b.x, a.y+b.y, a.z+b.z}; }
+    template <int N> inline Vector<N> operator- (Vector<N> const &a, Vector<N> const &b) noexcept { return {a.x-b.x, a.y-b.y, a.z-b.z}; }
+    template <int N> inline Vector<N> operator- (Vector<N> const &a) noexcept { return {-a.x, -a.y, -a.z}; }
+    template <int N> inline Vector<N> operator* (Vector<N> const &a, Real<N> const &f) noexcept { return {a.x*f, a.y*f, a.z*f}; }
+    template <int N> inline Vector<N> operator* (Direction<N> const &a, Real<N> const &f) noexcept { return {a.x*f, a.y*f, a.z*f}; }
+
+    template <int N> inline Vector<N> operator- (Point<N> const &a, Point<N> const &b) noexcept { return {a.x-b.x, a.y-b.y, a.z-b.z}; }
+    template <int N> inline Point<N>  operator+ (Point<N> const &a, Vector<N> const &b) noexcept { return {a.x+b.x, a.y+b.y, a.z+b.z}; }
+    template <int N> inline Point<N>  operator- (Point<N> const &a, Vector<N> const &b) noexcept { return {a.x-b.x, a.y-b.y, a.z-b.z}; }
+
+    template <int N> inline Direction<N> operator- (Direction<N> const &a) noexcept { return {-a.x, -a.y, -a.z}; }
+
+    template <int N>
+    inline Real<N> dot(Vector<N> const &a, Vector<N> const &b) noexcept {
+        return a.x*b.x + a.y*b.y + a.z*b.z;
+    }
+
+    template <int N>
+    inline Real<N> dot(Direction<N> const &a, Vector<N> const &b) noexcept {
+        return a.x*b.x + a.y*b.y + a.z*b.z;
+    }
+
+    template <int N>
+    inline Real<N> dot(Direction<N> const &a, Direction<N> const &b) noexcept {
+        return a.x*b.x + a.y*b.y + a.z*b.z;
+    }
+
+    template <int N>
+    inline Vector<N> cross(Vector<N> const &a, Vector<N> const &b) noexcept {
+        return {a.y*b.z - a.z*b.y,
+                a.z*b.x - a.x*b.z,
+                a.x*b.y - a.y*b.x};
+    }
+
+    template <int N>
+    inline Vector<N> cross(Direction<N> const &a, Vector<N> const &b) noexcept {
+        return {a.y*b.z - a.z*b.y,
+                a.z*b.x - a.x*b.z,
+                a.x*b.y - a.y*b.x};
+    }
+
+    template <int N>
+    inline Real<N> len(Vector<N> const &v) noexcept {
+        return sqrt(dot(v, v));
+    }
+
+    template <int N>
+    inline Direction<N> normalize(Vector<N> const &v) noexcept {
+        const Real<N> f = real(1) / len(v);
+        return {v.x*f, v.y*f, v.z*f};
+    }
+
+    typedef Vector<4> Vector4;
+    typedef Vector<8> Vector8;
+    typedef Point<4> Point4;
+    typedef Point<8> Point8;
+    typedef Direction<4> Direction4;
+    typedef Direction<8> Direction8;
+
+} } }
+
+#endif // SIMD_VECTOR_HH_INCLUDED_20130906
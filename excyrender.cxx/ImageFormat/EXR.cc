@@ -0,0 +1,138 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "ImageFormat/EXR.hh"
+#include <cstring>
+#include <stdexcept>
+
+namespace excyrender { namespace ImageFormat {
+
+    namespace {
+        // OpenEXR is little endian throughout.
+        void put32(std::vector<char> &out, std::uint32_t v) {
+            for (int i=0; i!=4; ++i)
+                out.push_back(static_cast<char>((v >> (8*i)) & 0xff));
+        }
+
+        void put64(std::vector<char> &out, std::uint64_t v) {
+            for (int i=0; i!=8; ++i)
+                out.push_back(static_cast<char>((v >> (8*i)) & 0xff));
+        }
+
+        void putFloat(std::vector<char> &out, float f) {
+            std::uint32_t v;
+            std::memcpy(&v, &f, sizeof v);
+            put32(out, v);
+        }
+
+        void putString(std::vector<char> &out, char const *s) {
+            out.insert(out.end(), s, s + std::strlen(s) + 1);
+        }
+
+        void attribute(std::vector<char> &out, char const *name, char const *type,
+                       std::vector<char> const &value)
+        {
+            putString(out, name);
+            putString(out, type);
+            put32(out, value.size());
+            out.insert(out.end(), value.begin(), value.end());
+        }
+
+        enum : std::uint32_t {
+            pixel_type_float = 2,
+            no_compression   = 0,
+            random_y         = 2,
+            tiled_flag       = 0x200
+        };
+
+        // Channels are stored in alphabetical order.
+        const char *const channels[3] = { "B", "G", "R" };
+        const int channel_index[3] = { 2, 1, 0 };
+    }
+
+
+    EXRTileWriter::EXRTileWriter(std::string const &filename, int width, int height, int tileSize)
+        : TileWriter(width, height, tileSize),
+          offsets_(std::size_t((width + tileSize-1) / tileSize) * ((height + tileSize-1) / tileSize), 0)
+    {
+        std::vector<char> header, v;
+        put32(header, 20000630);        // magic
+        put32(header, 2 | tiled_flag);  // version
+
+        v.clear();
+        for (auto c : channels) {
+            putString(v, c);
+            put32(v, pixel_type_float);
+            v.push_back(0);                             // pLinear
+            v.push_back(0); v.push_back(0); v.push_back(0);
+            put32(v, 1); put32(v, 1);                   // x, y sampling
+        }
+        v.push_back(0);
+        attribute(header, "channels", "chlist", v);
+
+        v.clear(); v.push_back(no_compression);
+        attribute(header, "compression", "compression", v);
+
+        v.clear(); put32(v, 0); put32(v, 0); put32(v, width-1); put32(v, height-1);
+        attribute(header, "dataWindow", "box2i", v);
+        attribute(header, "displayWindow", "box2i", v);
+
+        v.clear(); v.push_back(random_y);
+        attribute(header, "lineOrder", "lineOrder", v);
+
+        v.clear(); putFloat(v, 1);
+        attribute(header, "pixelAspectRatio", "float", v);
+
+        v.clear(); putFloat(v, 0); putFloat(v, 0);
+        attribute(header, "screenWindowCenter", "v2f", v);
+
+        v.clear(); putFloat(v, 1);
+        attribute(header, "screenWindowWidth", "float", v);
+
+        v.clear(); put32(v, tileSize); put32(v, tileSize); v.push_back(0);  // ONE_LEVEL
+        attribute(header, "tiles", "tiledesc", v);
+
+        header.push_back(0);
+
+        tableOffset_ = header.size();
+        open(file_, filename, tableOffset_ + std::streamoff(offsets_.size() * 8));
+        file_.seekp(0);
+        file_.write(header.data(), header.size());
+        file_.seekp(0, std::ios::end);
+        if (!file_)
+            throw std::runtime_error("EXRTileWriter: write failed");
+    }
+
+    void EXRTileWriter::writeTile(int x, int y, int w, int h, float const *rgb) {
+        const int tileX = x / tileSize(), tileY = y / tileSize(),
+                  tilesX = (width() + tileSize()-1) / tileSize();
+
+        chunk_.clear();
+        put32(chunk_, tileX);
+        put32(chunk_, tileY);
+        put32(chunk_, 0);   // level
+        put32(chunk_, 0);
+        put32(chunk_, w * h * 3 * 4);
+        for (int v=0; v!=h; ++v)
+            for (int c=0; c!=3; ++c)
+                for (int u=0; u!=w; ++u)
+                    putFloat(chunk_, rgb[(v*w + u)*3 + channel_index[c]]);
+
+        offsets_[tileY * tilesX + tileX] = file_.tellp();
+        file_.write(chunk_.data(), chunk_.size());
+        if (!file_)
+            throw std::runtime_error("EXRTileWriter: write failed");
+    }
+
+    void EXRTileWriter::finishFile() {
+        std::vector<char> table;
+        for (auto o : offsets_)
+            put64(table, o);
+        file_.seekp(tableOffset_);
+        file_.write(table.data(), table.size());
+        file_.close();
+        if (!file_)
+            throw std::runtime_error("EXRTileWriter: write failed");
+    }
+
+} }
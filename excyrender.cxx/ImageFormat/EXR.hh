@@ -0,0 +1,35 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef EXR_HH_INCLUDED_20130831
+#define EXR_HH_INCLUDED_20130831
+
+#include "ImageFormat/TileWriter.hh"
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace excyrender { namespace ImageFormat {
+
+    // Tiled OpenEXR (single part, one level, no compression) with linear RGB as 32 bit
+    // float channels. Written without the OpenEXR library: the header and an offset table
+    // come first, then tiles are appended in the order they arrive (line order RANDOM_Y),
+    // and finish() fills in the offset table.
+    class EXRTileWriter final : public TileWriter {
+    public:
+        EXRTileWriter(std::string const &filename, int width, int height, int tileSize);
+
+    private:
+        void writeTile(int x, int y, int w, int h, float const *rgb) override;
+        void finishFile() override;
+
+        std::fstream file_;
+        std::streamoff tableOffset_;
+        std::vector<std::uint64_t> offsets_;
+        std::vector<char> chunk_;
+    };
+
+} }
+
+#endif // EXR_HH_INCLUDED_20130831
@@ -0,0 +1,99 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "ImageFormat/PFM.hh"
+#include "Photometry/RGB.hh"
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+
+namespace excyrender { namespace ImageFormat {
+
+    namespace {
+        // The sign of the scale gives the byte order of the floats: negative is little endian.
+        std::string header(int width, int height) {
+            const std::uint16_t one = 1;
+            const bool little = *reinterpret_cast<unsigned char const*>(&one) == 1;
+            std::ostringstream ss;
+            ss << "PF\n" << width << ' ' << height << '\n' << (little ? "-1.0" : "1.0") << '\n';
+            return ss.str();
+        }
+    }
+
+    void pfm (std::ostream &os, int width, int height, std::vector<Photometry::RGB> const &pixels) {
+        if (std::size_t(width) * height != pixels.size())
+            throw std::runtime_error ("ImageFormat::pfm: width*height is inequal to number of pixels passed");
+        os << header(width, height);
+        std::vector<float> row(width*3);
+        for (int y=height-1; y>=0; --y) {
+            for (int x=0; x<width; ++x) {
+                Photometry::RGB const &p = pixels[y*width+x];
+                row[x*3+0] = p.r;
+                row[x*3+1] = p.g;
+                row[x*3+2] = p.b;
+            }
+            os.write(reinterpret_cast<char const*>(row.data()), row.size() * sizeof(float));
+        }
+    }
+
+
+    std::vector<Photometry::RGB> readPfm (std::istream &is, int &width, int &height) {
+        std::string magic;
+        float scale = 0;
+        is >> magic >> width >> height >> scale;
+        if (!is || magic != "PF" || width <= 0 || height <= 0 || scale == 0)
+            throw std::runtime_error("ImageFormat::readPfm: not a colour PFM");
+        is.get();
+
+        const std::uint16_t one = 1;
+        const bool little = *reinterpret_cast<unsigned char const*>(&one) == 1,
+                   swap = little != (scale < 0);
+        std::vector<float> row(width*3);
+        std::vector<Photometry::RGB> pixels(std::size_t(width) * height);
+        for (int y=height-1; y>=0; --y) {
+            is.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float));
+            if (!is)
+                throw std::runtime_error("ImageFormat::readPfm: file is truncated");
+            if (swap) {
+                for (auto &f : row) {
+                    unsigned char *b = reinterpret_cast<unsigned char*>(&f);
+                    std::reverse(b, b + sizeof(float));
+                }
+            }
+            for (int x=0; x<width; ++x)
+                pixels[y*width+x] = Photometry::RGB(row[x*3+0], row[x*3+1], row[x*3+2]);
+        }
+        return pixels;
+    }
+
+
+    PFMTileWriter::PFMTileWriter(std::string const &filename, int width, int height, int tileSize)
+        : TileWriter(width, height, tileSize)
+    {
+        const std::string h = header(width, height);
+        headerSize_ = h.size();
+        open(file_, filename, headerSize_ + std::streamoff(width) * height * 3 * sizeof(float));
+        file_.seekp(0);
+        file_.write(h.data(), h.size());
+    }
+
+    void PFMTileWriter::writeTile(int x, int y, int w, int h, float const *rgb) {
+        for (int v=0; v!=h; ++v) {
+            const std::streamoff row = height()-1 - (y+v);
+            file_.seekp(headerSize_ + (row * width() + x) * 3 * std::streamoff(sizeof(float)));
+            file_.write(reinterpret_cast<char const*>(rgb + v*w*3), w * 3 * sizeof(float));
+        }
+        if (!file_)
+            throw std::runtime_error("PFMTileWriter: write failed");
+    }
+
+    void PFMTileWriter::finishFile() {
+        file_.close();
+        if (!file_)
+            throw std::runtime_error("PFMTileWriter: write failed");
+    }
+
+} }
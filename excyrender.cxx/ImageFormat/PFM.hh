@@ -0,0 +1,42 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef PFM_HH_INCLUDED_20130831
+#define PFM_HH_INCLUDED_20130831
+
+#include "ImageFormat/TileWriter.hh"
+#include <fstream>
+#include <iosfwd>
+#include <string>
+#include <vector>
+
+namespace excyrender {
+    namespace Photometry {
+        struct RGB;
+    }
+
+    namespace ImageFormat {
+
+        // Portable float map: linear RGB as 32 bit floats, for HDR output that can be
+        // tone mapped later. Rows are stored bottom to top.
+        void pfm (std::ostream &os, int width, int height, std::vector<Photometry::RGB> const &pixels);
+
+        // Reads what pfm() writes, either byte order; rows top to bottom. Throws
+        // std::runtime_error on anything else.
+        std::vector<Photometry::RGB> readPfm (std::istream &is, int &width, int &height);
+
+        class PFMTileWriter final : public TileWriter {
+        public:
+            PFMTileWriter(std::string const &filename, int width, int height, int tileSize);
+
+        private:
+            void writeTile(int x, int y, int w, int h, float const *rgb) override;
+            void finishFile() override;
+
+            std::fstream file_;
+            std::streamoff headerSize_;
+        };
+    }
+}
+
+#endif // PFM_HH_INCLUDED_20130831
@@ -3,7 +3,9 @@
 // See COPYING in the root-folder of the excygen project folder.
 #include "ImageFormat/PPM.hh"
 #include "Photometry/RGB.hh"
+#include <istream>
 #include <ostream>
+#include <sstream>
 #include <stdexcept>
 
 namespace excyrender { namespace ImageFormat {
@@ -28,4 +30,90 @@ namespace excyrender { namespace ImageFormat {
         }
     }
 
+    namespace {
+        unsigned char byte(real v) noexcept {
+            return static_cast<int>(saturate<real>(v*255, 0, 255));
+        }
+
+        std::string p6Header(int width, int height) {
+            std::ostringstream ss;
+            ss << "P6\n" << width << ' ' << height << '\n' << "255\n";
+            return ss.str();
+        }
+    }
+
+    void p6 (std::ostream &os, int width, int height, std::vector<Photometry::RGB> const &pixels) {
+        if (std::size_t(width) * height != pixels.size())
+            throw std::runtime_error ("ImageFormat::p6: width*height is inequal to number of pixels passed");
+        os << p6Header(width, height);
+        std::vector<unsigned char> row(width*3);
+        for (int y=0; y<height; ++y) {
+            for (int x=0; x<width; ++x) {
+                Photometry::RGB const &p = pixels[y*width+x];
+                row[x*3+0] = byte(p.r);
+                row[x*3+1] = byte(p.g);
+                row[x*3+2] = byte(p.b);
+            }
+            os.write(reinterpret_cast<char const*>(row.data()), row.size());
+        }
+    }
+
+
+    std::vector<Photometry::RGB> readPpm (std::istream &is, int &width, int &height) {
+        std::string magic;
+        int maxval = 0;
+        is >> magic >> width >> height >> maxval;
+        if (!is || (magic != "P3" && magic != "P6") || width <= 0 || height <= 0 || maxval != 255)
+            throw std::runtime_error("ImageFormat::readPpm: not an 8 bit P3 or P6");
+        is.get();
+
+        std::vector<Photometry::RGB> pixels(std::size_t(width) * height);
+        std::vector<unsigned char> row(width*3);
+        for (int y=0; y<height; ++y) {
+            if (magic == "P6") {
+                is.read(reinterpret_cast<char*>(row.data()), row.size());
+            } else {
+                for (auto &b : row) {
+                    int v;
+                    is >> v;
+                    b = v;
+                }
+            }
+            if (!is)
+                throw std::runtime_error("ImageFormat::readPpm: file is truncated");
+            for (int x=0; x<width; ++x)
+                pixels[y*width+x] = Photometry::RGB(row[x*3+0], row[x*3+1], row[x*3+2]) * (real(1)/255);
+        }
+        return pixels;
+    }
+
+
+    PPMTileWriter::PPMTileWriter(std::string const &filename, int width, int height, int tileSize)
+        : TileWriter(width, height, tileSize)
+    {
+        const std::string header = p6Header(width, height);
+        headerSize_ = header.size();
+        open(file_, filename, headerSize_ + std::streamoff(width) * height * 3);
+        file_.seekp(0);
+        file_.write(header.data(), header.size());
+    }
+
+    void PPMTileWriter::writeTile(int x, int y, int w, int h, float const *rgb) {
+        row_.resize(w*3);
+        for (int v=0; v!=h; ++v) {
+            for (int i=0; i!=w*3; ++i)
+                row_[i] = byte(rgb[v*w*3 + i]);
+            file_.seekp(headerSize_ + (std::streamoff(y+v) * width() + x) * 3);
+            file_.write(reinterpret_cast<char const*>(row_.data()), row_.size());
+        }
+        if (!file_)
+            throw std::runtime_error("PPMTileWriter: write failed");
+    }
+
+    void PPMTileWriter::finishFile() {
+        file_.close();
+        if (!file_)
+            throw std::runtime_error("PPMTileWriter: write failed");
+    }
+
 } }
@@ -5,6 +5,9 @@
 #define PPM_HH_INCLUDED_20130708
 
 #include "real.hh"
+#include "ImageFormat/TileWriter.hh"
+#include <fstream>
+#include <string>
 #include <vector>
 #include <iosfwd>
 
@@ -14,7 +17,30 @@ namespace excyrender {
     }
 
     namespace ImageFormat {
+        // ASCII (P3).
         void ppm (std::ostream &os, int width, int height, std::vector<Photometry::RGB> const &pixels);
+
+        // Binary (P6); a third of the size of P3 and much faster to write and read.
+        void p6 (std::ostream &os, int width, int height, std::vector<Photometry::RGB> const &pixels);
+
+        // Reads P3 or P6 with a maximum value of 255, scaled to [0,1]. Throws
+        // std::runtime_error on anything else.
+        std::vector<Photometry::RGB> readPpm (std::istream &is, int &width, int &height);
+
+        // Binary (P6), tile by tile. The header has a fixed size, so each tile's rows are
+        // written straight to where they belong.
+        class PPMTileWriter final : public TileWriter {
+        public:
+            PPMTileWriter(std::string const &filename, int width, int height, int tileSize);
+
+        private:
+            void writeTile(int x, int y, int w, int h, float const *rgb) override;
+            void finishFile() override;
+
+            std::fstream file_;
+            std::streamoff headerSize_;
+            std::vector<unsigned char> row_;
+        };
     }
 }
 
@@ -0,0 +1,97 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "ImageFormat/TileWriter.hh"
+#include "ImageFormat/PPM.hh"
+#include "ImageFormat/PFM.hh"
+#include "ImageFormat/EXR.hh"
+#include "Photometry/RGB.hh"
+#include <algorithm>
+#include <stdexcept>
+
+namespace excyrender { namespace ImageFormat {
+
+TileWriter::TileWriter(int width, int height, int tileSize)
+    : width_(width), height_(height), tileSize_(tileSize)
+{
+    if (width <= 0 || height <= 0 || tileSize <= 0)
+        throw std::logic_error("TileWriter: width, height and tileSize must be positive");
+    const int tilesX = (width + tileSize-1) / tileSize,
+              tilesY = (height + tileSize-1) / tileSize;
+    written_.assign(tilesX * tilesY, 0);
+    missing_ = tilesX * tilesY;
+}
+
+void TileWriter::write(int x, int y, int w, int h, float const *rgb) {
+    const int tilesX = (width_ + tileSize_-1) / tileSize_;
+    if (x < 0 || y < 0 || x % tileSize_ || y % tileSize_
+        || w != std::min(tileSize_, width_ - x) || h != std::min(tileSize_, height_ - y))
+        throw std::logic_error("TileWriter::write: tile is not on the grid");
+    char &written = written_[(y / tileSize_) * tilesX + x / tileSize_];
+    if (written)
+        throw std::logic_error("TileWriter::write: tile written twice");
+    writeTile(x, y, w, h, rgb);
+    written = 1;
+    --missing_;
+}
+
+void TileWriter::finish() {
+    if (missing_)
+        throw std::logic_error("TileWriter::finish: not all tiles have been written");
+    finishFile();
+}
+
+void TileWriter::open(std::fstream &file, std::string const &filename, std::streamoff size) {
+    file.open(filename, std::ios::in | std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+        throw std::runtime_error("TileWriter: cannot open '" + filename + "'");
+    if (size > 0) {
+        file.seekp(size - 1);
+        file.put(0);
+    }
+    if (!file)
+        throw std::runtime_error("TileWriter: cannot write '" + filename + "'");
+}
+
+
+std::unique_ptr<TileWriter> tileWriter(std::string const &filename, int width, int height, int tileSize) {
+    auto const endsWith = [&](char const *ext) {
+        const std::string e(ext);
+        return filename.size() >= e.size()
+            && filename.compare(filename.size() - e.size(), e.size(), e) == 0;
+    };
+    if (endsWith(".ppm"))
+        return std::unique_ptr<TileWriter>(new PPMTileWriter(filename, width, height, tileSize));
+    if (endsWith(".pfm"))
+        return std::unique_ptr<TileWriter>(new PFMTileWriter(filename, width, height, tileSize));
+    if (endsWith(".exr"))
+        return std::unique_ptr<TileWriter>(new EXRTileWriter(filename, width, height, tileSize));
+    throw std::runtime_error("tileWriter: unknown format of '" + filename + "' (want .ppm, .pfm or .exr)");
+}
+
+
+void write(TileWriter &writer, std::vector<Photometry::RGB> const &pixels) {
+    const int width = writer.width(), height = writer.height(), tileSize = writer.tileSize();
+    if (pixels.size() != std::size_t(width) * height)
+        throw std::runtime_error("ImageFormat::write: width*height is inequal to number of pixels passed");
+
+    std::vector<float> rgb;
+    for (int y=0; y<height; y+=tileSize) {
+        for (int x=0; x<width; x+=tileSize) {
+            const int w = std::min(tileSize, width - x), h = std::min(tileSize, height - y);
+            rgb.resize(w*h*3);
+            for (int v=0; v!=h; ++v) {
+                for (int u=0; u!=w; ++u) {
+                    Photometry::RGB const &p = pixels[(y+v)*width + x+u];
+                    rgb[(v*w+u)*3+0] = p.r;
+                    rgb[(v*w+u)*3+1] = p.g;
+                    rgb[(v*w+u)*3+2] = p.b;
+                }
+            }
+            writer.write(x, y, w, h, rgb.data());
+        }
+    }
+    writer.finish();
+}
+
+} }
@@ -0,0 +1,63 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TILEWRITER_HH_INCLUDED_20130831
+#define TILEWRITER_HH_INCLUDED_20130831
+
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace excyrender {
+    namespace Photometry {
+        struct RGB;
+    }
+
+    namespace ImageFormat {
+
+        // Writes an image tile by tile, in any order, so that the whole frame never has to
+        // be in memory. Tiles are aligned to a grid of tileSize x tileSize pixels; those
+        // at the right and bottom borders are smaller.
+        //
+        // Not thread-safe; calls from concurrently rendered tiles must be serialised.
+        class TileWriter {
+        public:
+            TileWriter(int width, int height, int tileSize);
+            virtual ~TileWriter() {}
+
+            // 'rgb' holds w*h linear RGB triples, row by row, for the tile whose top left
+            // pixel is (x,y). Throws std::runtime_error on I/O errors, std::logic_error
+            // for tiles not on the grid.
+            void write(int x, int y, int w, int h, float const *rgb);
+
+            // Completes the file. All tiles must have been written.
+            void finish();
+
+            int width()    const noexcept { return width_; }
+            int height()   const noexcept { return height_; }
+            int tileSize() const noexcept { return tileSize_; }
+
+        protected:
+            virtual void writeTile(int x, int y, int w, int h, float const *rgb) = 0;
+            virtual void finishFile() {}
+
+            // Opens 'filename' for writing anywhere in it, truncated to 'size' bytes.
+            static void open(std::fstream &file, std::string const &filename, std::streamoff size = 0);
+
+        private:
+            int width_, height_, tileSize_;
+            std::vector<char> written_;
+            int missing_;
+        };
+
+        // Picks the format by extension: .ppm (binary P6), .pfm or .exr.
+        std::unique_ptr<TileWriter> tileWriter(std::string const &filename,
+                                               int width, int height, int tileSize);
+
+        // Writes a whole in-memory image through a TileWriter.
+        void write(TileWriter &, std::vector<Photometry::RGB> const &pixels);
+    }
+}
+
+#endif // TILEWRITER_HH_INCLUDED_20130831
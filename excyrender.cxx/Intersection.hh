@@ -6,14 +6,14 @@
 
 #include "DifferentialGeometry.hh"
 #include "Photometry/Material/Material.hh"
-#include <memory>
 
 namespace excyrender {
 
     struct Intersection
     {
         DifferentialGeometry dg;
-        std::shared_ptr<const Photometry::Material::Material> material;
+        // Non-owning; materials live in the Scene.
+        Photometry::Material::Material const *material;
     };
 
     inline real distance(Intersection const &i) noexcept {
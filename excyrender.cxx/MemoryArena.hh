@@ -0,0 +1,124 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef MEMORYARENA_HH_INCLUDED_20130821
+#define MEMORYARENA_HH_INCLUDED_20130821
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace excyrender {
+
+    // Scratch memory for short-lived objects, e.g. the BSDFs and BxDFs built at each
+    // intersection. Objects are placement-constructed into big blocks and destroyed all at
+    // once by reset(); blocks are kept for reuse, so that after warm-up the arena itself
+    // allocates nothing. What the objects hold may still be on the heap: a BxDF's
+    // Spectrum keeps its bins in a std::valarray.
+    //
+    // An arena is not thread-safe; the intended use is one arena per thread, reset after
+    // each camera sample.
+    class MemoryArena final {
+    public:
+        explicit MemoryArena(std::size_t blockSize = 32*1024)
+            : blockSize_(blockSize)
+        {}
+
+        MemoryArena(MemoryArena const &)            = delete;
+        MemoryArena& operator=(MemoryArena const &) = delete;
+
+        MemoryArena(MemoryArena &&rhs) noexcept
+            : blockSize_(rhs.blockSize_),
+              blocks_(std::move(rhs.blocks_)),
+              currentBlock_(rhs.currentBlock_),
+              offset_(rhs.offset_),
+              cleanups_(rhs.cleanups_)
+        {
+            rhs.cleanups_ = nullptr;
+            rhs.currentBlock_ = 0;
+            rhs.offset_ = 0;
+        }
+
+        ~MemoryArena() {
+            reset();
+        }
+
+        // Constructs a T from 'args'. Its destructor, if non-trivial, runs upon reset().
+        template <typename T, typename ...Args>
+        T* create(Args&& ...args) {
+            T *ret = new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+            if (!std::is_trivially_destructible<T>::value) {
+                Cleanup *c = new (allocate(sizeof(Cleanup), alignof(Cleanup)))
+                                 Cleanup{&destroy<T>, ret, cleanups_};
+                cleanups_ = c;
+            }
+            return ret;
+        }
+
+        // Destroys all objects in reverse order of creation and makes the memory
+        // available again.
+        void reset() noexcept {
+            for (Cleanup *c = cleanups_; c; c = c->next)
+                c->destroy(c->object);
+            cleanups_ = nullptr;
+            currentBlock_ = 0;
+            offset_ = 0;
+        }
+
+        std::size_t capacity() const noexcept {
+            std::size_t ret = 0;
+            for (auto const &b : blocks_)
+                ret += b.size;
+            return ret;
+        }
+
+    private:
+        struct Block {
+            std::unique_ptr<char[]> data;
+            std::size_t size;
+        };
+
+        struct Cleanup {
+            void (*destroy)(void*);
+            void *object;
+            Cleanup *next;
+        };
+
+        template <typename T>
+        static void destroy(void *p) noexcept {
+            static_cast<T*>(p)->~T();
+        }
+
+        void* allocate(std::size_t size, std::size_t alignment) {
+            for (;;) {
+                if (currentBlock_ < blocks_.size()) {
+                    Block &b = blocks_[currentBlock_];
+                    const std::uintptr_t base    = reinterpret_cast<std::uintptr_t>(b.data.get()),
+                                         aligned = (base + offset_ + alignment-1) & ~(alignment-1);
+                    if (aligned + size <= base + b.size) {
+                        offset_ = aligned + size - base;
+                        return reinterpret_cast<void*>(aligned);
+                    }
+                    // Does not fit. Move on to the next block; if this was not the last
+                    // block, the one following may be big enough.
+                    ++currentBlock_;
+                    offset_ = 0;
+                    continue;
+                }
+                const std::size_t s = size + alignment > blockSize_ ? size + alignment : blockSize_;
+                blocks_.push_back(Block{std::unique_ptr<char[]>(new char[s]), s});
+            }
+        }
+
+        std::size_t blockSize_;
+        std::vector<Block> blocks_;
+        std::size_t currentBlock_ = 0, offset_ = 0;
+        Cleanup *cleanups_ = nullptr;
+    };
+}
+
+#endif // MEMORYARENA_HH_INCLUDED_20130821
@@ -0,0 +1,40 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "MeshFormat/MappedFile.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace excyrender { namespace MeshFormat {
+
+MappedFile::MappedFile(std::string const &path)
+    : map_(MAP_FAILED), size_(0)
+{
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw std::runtime_error("'" + path + "' cannot be opened: " + std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_ = st.st_size;
+        map_ = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map_ != MAP_FAILED)
+            ::madvise(map_, size_, MADV_SEQUENTIAL);
+    }
+    ::close(fd);
+    if (map_ == MAP_FAILED)
+        throw std::runtime_error("'" + path + "' is empty or cannot be mapped");
+}
+
+
+MappedFile::~MappedFile() {
+    ::munmap(map_, size_);
+}
+
+} }
@@ -0,0 +1,33 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef MAPPEDFILE_HH_INCLUDED_20130908
+#define MAPPEDFILE_HH_INCLUDED_20130908
+
+#include <cstddef>
+#include <string>
+
+namespace excyrender { namespace MeshFormat {
+
+    // A whole file, mapped read-only into memory, so that it can be parsed in parallel
+    // without reading it into a buffer first. The data is not NUL terminated.
+    class MappedFile final {
+    public:
+        // Throws std::runtime_error if 'path' cannot be opened or mapped.
+        explicit MappedFile(std::string const &path);
+        ~MappedFile();
+        MappedFile(MappedFile const &) = delete;
+        MappedFile& operator= (MappedFile const &) = delete;
+
+        char const *begin() const noexcept { return static_cast<char const*>(map_); }
+        char const *end() const noexcept { return begin() + size_; }
+        std::size_t size() const noexcept { return size_; }
+
+    private:
+        void *map_;
+        std::size_t size_;
+    };
+
+} }
+
+#endif // MAPPEDFILE_HH_INCLUDED_20130908
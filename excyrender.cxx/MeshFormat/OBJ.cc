@@ -0,0 +1,280 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "MeshFormat/OBJ.hh"
+#include "MeshFormat/MappedFile.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include <stdexcept>
+#include <unordered_map>
+
+#include <omp.h>
+
+namespace excyrender { namespace MeshFormat {
+
+namespace {
+    const std::uint32_t none = ~std::uint32_t(0);
+
+    struct Corner {
+        std::uint32_t p, t, n;
+        bool operator== (Corner const &rhs) const noexcept {
+            return p == rhs.p && t == rhs.t && n == rhs.n;
+        }
+    };
+
+    struct CornerHash {
+        std::size_t operator() (Corner const &c) const noexcept {
+            return (std::size_t(c.p) * 73856093) ^ (std::size_t(c.t) * 19349663) ^ (std::size_t(c.n) * 83492791);
+        }
+    };
+
+    enum class Line { Other, V, VT, VN, F };
+
+    bool blank(char c) noexcept {
+        return c == ' ' || c == '\t' || c == '\r';
+    }
+
+    // The lines of a file from 'begin' to 'end', which is a line break or the end of a
+    // NUL terminated string, so that strtod() and strtol() stop there.
+    struct Chunk {
+        char const *begin, *end;
+        std::size_t v = 0, vt = 0, vn = 0;   // counted, then offsets of the first of each
+        std::vector<Corner> corners;         // three per triangle
+        char const *error = nullptr;
+    };
+
+    Line kind(char const *&p, char const *end) noexcept {
+        while (p != end && blank(*p))
+            ++p;
+        if (end - p < 2)
+            return Line::Other;
+        if (p[0] == 'f' && blank(p[1])) {
+            p += 2;
+            return Line::F;
+        }
+        if (p[0] != 'v')
+            return Line::Other;
+        if (blank(p[1])) {
+            p += 2;
+            return Line::V;
+        }
+        if (end - p < 3 || !blank(p[2]))
+            return Line::Other;
+        p += 3;
+        return p[-2] == 't' ? Line::VT : p[-2] == 'n' ? Line::VN : Line::Other;
+    }
+
+    bool number(char const *&p, char const *end, real &out) noexcept {
+        while (p != end && blank(*p))
+            ++p;
+        if (p == end)
+            return false;
+        char *q;
+        out = std::strtod(p, &q);
+        if (q == p)
+            return false;
+        p = q;
+        return true;
+    }
+
+    // One index of a face corner, made zero based. Negative ones count back from 'count',
+    // the number of vertices before this line.
+    bool index(char const *&p, std::size_t count, std::size_t total, std::uint32_t &out) noexcept {
+        if (*p != '-' && *p != '+' && (*p < '0' || *p > '9'))
+            return false;
+        char *q;
+        const long i = std::strtol(p, &q, 10);
+        p = q;
+        const long resolved = i > 0 ? i-1 : long(count) + i;
+        if (i == 0 || resolved < 0 || std::size_t(resolved) >= total)
+            return false;
+        out = resolved;
+        return true;
+    }
+
+    template <typename F>
+    void forEachLine(Chunk const &chunk, F f) {
+        for (char const *p = chunk.begin; p < chunk.end; ) {
+            char const *eol = std::find(p, chunk.end, '\n');
+            f(p, eol);
+            p = eol + 1;
+        }
+    }
+
+    void count(Chunk &chunk) {
+        forEachLine(chunk, [&](char const *p, char const *eol) {
+            switch (kind(p, eol)) {
+            case Line::V:  ++chunk.v;  break;
+            case Line::VT: ++chunk.vt; break;
+            case Line::VN: ++chunk.vn; break;
+            default: break;
+            }
+        });
+    }
+
+    void parse(Chunk &chunk, std::size_t vs, std::size_t vts, std::size_t vns,
+               Shapes::MeshBuffers &mesh, std::vector<Geometry::Point2d> &uvs,
+               std::vector<Geometry::Vector> &normals)
+    {
+        std::size_t v = chunk.v, vt = chunk.vt, vn = chunk.vn;
+        std::vector<Corner> polygon;
+        forEachLine(chunk, [&](char const *p, char const *eol) {
+            if (chunk.error)
+                return;
+            real a, b, c = 0;
+            switch (kind(p, eol)) {
+            case Line::V:
+                if (!number(p, eol, a) || !number(p, eol, b) || !number(p, eol, c))
+                    chunk.error = "malformed v";
+                else
+                    mesh.positions[v++] = Geometry::Point(a, b, c);
+                break;
+            case Line::VT:
+                if (!number(p, eol, a))
+                    chunk.error = "malformed vt";
+                else {
+                    if (!number(p, eol, b))
+                        b = 0;
+                    uvs[vt++] = Geometry::Point2d{a, b};
+                }
+                break;
+            case Line::VN:
+                if (!number(p, eol, a) || !number(p, eol, b) || !number(p, eol, c))
+                    chunk.error = "malformed vn";
+                else
+                    normals[vn++] = Geometry::Vector(a, b, c);
+                break;
+            case Line::F:
+                polygon.clear();
+                for (;;) {
+                    while (p != eol && blank(*p))
+                        ++p;
+                    if (p == eol)
+                        break;
+                    Corner corner = {none, none, none};
+                    bool ok = index(p, v, vs, corner.p);
+                    if (ok && *p == '/') {
+                        ++p;
+                        if (*p != '/')
+                            ok = index(p, vt, vts, corner.t);
+                        if (ok && *p == '/') {
+                            ++p;
+                            ok = index(p, vn, vns, corner.n);
+                        }
+                    }
+                    if (!ok || (p != eol && !blank(*p))) {
+                        chunk.error = "malformed f, or index out of range";
+                        return;
+                    }
+                    polygon.push_back(corner);
+                }
+                for (std::size_t k=2; k<polygon.size(); ++k) {
+                    chunk.corners.push_back(polygon[0]);
+                    chunk.corners.push_back(polygon[k-1]);
+                    chunk.corners.push_back(polygon[k]);
+                }
+                break;
+            default:
+                break;
+            }
+        });
+    }
+}
+
+
+Shapes::MeshBuffers readObj (std::string const &path) {
+    const MappedFile file(path);
+
+    // Chunks end at line breaks. A last line without one is copied, so that it is NUL
+    // terminated, too.
+    char const *body = file.end();
+    while (body != file.begin() && body[-1] != '\n')
+        --body;
+    const std::string last(body, file.end());
+
+    const std::size_t minChunk = 1 << 20;
+    const std::size_t n = std::max<std::size_t>(1, std::min<std::size_t>(
+                              8 * omp_get_max_threads(), (body - file.begin()) / minChunk));
+    std::vector<Chunk> chunks(n + 1);
+    char const *p = file.begin();
+    for (std::size_t i=0; i!=n; ++i) {
+        chunks[i].begin = p;
+        p = i+1 == n ? body
+                     : std::min(body, std::find(file.begin() + (body - file.begin()) * (i+1) / n, body, '\n') + 1);
+        chunks[i].end = std::max(chunks[i].begin, p - 1);
+    }
+    chunks[n].begin = last.c_str();
+    chunks[n].end = last.c_str() + last.size();
+
+    const long chunkCount = chunks.size();
+    #pragma omp parallel for schedule(dynamic)
+    for (long i=0; i<chunkCount; ++i)
+        count(chunks[i]);
+
+    std::size_t vs = 0, vts = 0, vns = 0;
+    for (auto &chunk : chunks) {
+        std::swap(vs, chunk.v);   vs += chunk.v;
+        std::swap(vts, chunk.vt); vts += chunk.vt;
+        std::swap(vns, chunk.vn); vns += chunk.vn;
+    }
+    if (vs == 0)
+        throw std::runtime_error("OBJ: '" + path + "' has no vertices");
+
+    Shapes::MeshBuffers ret;
+    std::vector<Geometry::Point2d> uvs(vts);
+    std::vector<Geometry::Vector> normals(vns);
+    ret.positions.resize(vs);
+    #pragma omp parallel for schedule(dynamic)
+    for (long i=0; i<chunkCount; ++i)
+        parse(chunks[i], vs, vts, vns, ret, uvs, normals);
+
+    std::size_t corners = 0;
+    bool everyT = vts != 0, everyN = vns != 0, sameT = vts == vs, sameN = vns == vs;
+    for (auto const &chunk : chunks) {
+        if (chunk.error)
+            throw std::runtime_error("OBJ: '" + path + "': " + chunk.error);
+        corners += chunk.corners.size();
+        for (auto const &c : chunk.corners) {
+            everyT = everyT && c.t != none;
+            everyN = everyN && c.n != none;
+            sameT = sameT && c.t == c.p;
+            sameN = sameN && c.n == c.p;
+        }
+    }
+    if (corners == 0)
+        throw std::runtime_error("OBJ: '" + path + "' has no triangles");
+
+    ret.indices.reserve(corners);
+    if ((!everyT || sameT) && (!everyN || sameN)) {
+        // Positions, normals and uvs correspond one to one, as most exporters write them.
+        for (auto const &chunk : chunks)
+            for (auto const &c : chunk.corners)
+                ret.indices.push_back(c.p);
+        if (everyT) ret.uvs = std::move(uvs);
+        if (everyN) ret.normals = std::move(normals);
+        return ret;
+    }
+
+    std::vector<Geometry::Point> positions;
+    std::unordered_map<Corner, std::uint32_t, CornerHash> vertices;
+    for (auto const &chunk : chunks) {
+        for (Corner c : chunk.corners) {
+            if (!everyT) c.t = none;
+            if (!everyN) c.n = none;
+            auto it = vertices.find(c);
+            if (it == vertices.end()) {
+                it = vertices.insert(std::make_pair(c, std::uint32_t(positions.size()))).first;
+                positions.push_back(ret.positions[c.p]);
+                if (everyT) ret.uvs.push_back(uvs[c.t]);
+                if (everyN) ret.normals.push_back(normals[c.n]);
+            }
+            ret.indices.push_back(it->second);
+        }
+    }
+    ret.positions = std::move(positions);
+    return ret;
+}
+
+} }
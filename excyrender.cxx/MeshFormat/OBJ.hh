@@ -0,0 +1,23 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef OBJ_HH_INCLUDED_20130908
+#define OBJ_HH_INCLUDED_20130908
+
+#include "Shapes/TriangleMesh.hh"
+#include <string>
+
+namespace excyrender { namespace MeshFormat {
+
+    // Wavefront OBJ: v, vt, vn and f lines, with positive or negative (relative) indices;
+    // polygons are split into fans, everything else is skipped. Normals and uvs are kept if
+    // every face corner has one. Corners that pair a position with different normals or
+    // uvs become vertices of their own.
+    //
+    // The file is split into chunks at line boundaries, which are parsed in parallel.
+    // Throws std::runtime_error if it is malformed.
+    Shapes::MeshBuffers readObj (std::string const &path);
+
+} }
+
+#endif // OBJ_HH_INCLUDED_20130908
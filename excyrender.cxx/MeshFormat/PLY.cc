@@ -0,0 +1,316 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "MeshFormat/PLY.hh"
+#include "MeshFormat/MappedFile.hh"
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+namespace excyrender { namespace MeshFormat {
+
+namespace {
+    enum class Type { Int8, UInt8, Int16, UInt16, Int32, UInt32, Float32, Float64 };
+
+    Type type(std::string const &name) {
+        if (name == "char"   || name == "int8")    return Type::Int8;
+        if (name == "uchar"  || name == "uint8")   return Type::UInt8;
+        if (name == "short"  || name == "int16")   return Type::Int16;
+        if (name == "ushort" || name == "uint16")  return Type::UInt16;
+        if (name == "int"    || name == "int32")   return Type::Int32;
+        if (name == "uint"   || name == "uint32")  return Type::UInt32;
+        if (name == "float"  || name == "float32") return Type::Float32;
+        if (name == "double" || name == "float64") return Type::Float64;
+        throw std::runtime_error("PLY: unknown type '" + name + "'");
+    }
+
+    std::size_t size(Type t) noexcept {
+        switch (t) {
+        case Type::Int8:  case Type::UInt8:   return 1;
+        case Type::Int16: case Type::UInt16:  return 2;
+        case Type::Int32: case Type::UInt32: case Type::Float32: return 4;
+        case Type::Float64: return 8;
+        }
+        return 0;
+    }
+
+    template <typename T>
+    T load(char const *p, bool swap) noexcept {
+        char b[sizeof(T)];
+        std::memcpy(b, p, sizeof b);
+        if (swap)
+            std::reverse(b, b + sizeof b);
+        T ret;
+        std::memcpy(&ret, b, sizeof ret);
+        return ret;
+    }
+
+    double read(char const *p, Type t, bool swap) noexcept {
+        switch (t) {
+        case Type::Int8:    return load<std::int8_t>(p, swap);
+        case Type::UInt8:   return load<std::uint8_t>(p, swap);
+        case Type::Int16:   return load<std::int16_t>(p, swap);
+        case Type::UInt16:  return load<std::uint16_t>(p, swap);
+        case Type::Int32:   return load<std::int32_t>(p, swap);
+        case Type::UInt32:  return load<std::uint32_t>(p, swap);
+        case Type::Float32: return load<float>(p, swap);
+        case Type::Float64: return load<double>(p, swap);
+        }
+        return 0;
+    }
+
+    struct Property {
+        std::string name;
+        Type type;
+        bool list;
+        Type countType;
+    };
+
+    struct Element {
+        std::string name;
+        std::size_t count;
+        std::vector<Property> properties;
+
+        // Bytes per item, or 0 if items have lists and differ in size.
+        std::size_t stride() const noexcept {
+            std::size_t ret = 0;
+            for (auto const &p : properties) {
+                if (p.list)
+                    return 0;
+                ret += size(p.type);
+            }
+            return ret;
+        }
+
+        int find(std::initializer_list<char const*> names) const noexcept {
+            for (auto name : names)
+                for (std::size_t i=0; i!=properties.size(); ++i)
+                    if (properties[i].name == name)
+                        return i;
+            return -1;
+        }
+    };
+
+    struct Header {
+        bool swap;
+        std::vector<Element> elements;
+        char const *body;
+    };
+
+    Header parseHeader(MappedFile const &file) {
+        const char endHeader[] = "end_header";
+        char const *end = std::search(file.begin(), file.end(), endHeader, endHeader + sizeof endHeader - 1);
+        if (file.size() < 4 || std::memcmp(file.begin(), "ply", 3) != 0 || end == file.end())
+            throw std::runtime_error("PLY: not a PLY file");
+        char const *body = std::find(end, file.end(), '\n');
+        if (body == file.end())
+            throw std::runtime_error("PLY: file ends after its header");
+
+        Header ret;
+        ret.body = body + 1;
+        bool little = true, haveFormat = false;
+        std::istringstream is(std::string(file.begin(), end));
+        for (std::string line; std::getline(is, line); ) {
+            std::istringstream ls(line);
+            std::string keyword;
+            ls >> keyword;
+            if (keyword == "format") {
+                std::string format;
+                ls >> format;
+                if (format == "binary_little_endian")
+                    little = true;
+                else if (format == "binary_big_endian")
+                    little = false;
+                else
+                    throw std::runtime_error("PLY: format '" + format + "' not supported, only binary");
+                haveFormat = true;
+            } else if (keyword == "element") {
+                Element e;
+                if (!(ls >> e.name >> e.count))
+                    throw std::runtime_error("PLY: malformed element '" + line + "'");
+                ret.elements.push_back(e);
+            } else if (keyword == "property") {
+                if (ret.elements.empty())
+                    throw std::runtime_error("PLY: property outside of element");
+                Property p;
+                std::string t;
+                ls >> t;
+                p.list = t == "list";
+                if (p.list) {
+                    std::string countType;
+                    ls >> countType >> t;
+                    p.countType = type(countType);
+                }
+                p.type = type(t);
+                if (!(ls >> p.name))
+                    throw std::runtime_error("PLY: malformed property '" + line + "'");
+                ret.elements.back().properties.push_back(p);
+            }
+        }
+        if (!haveFormat)
+            throw std::runtime_error("PLY: no format given");
+        const std::uint16_t one = 1;
+        const bool nativeLittle = *reinterpret_cast<char const*>(&one) == 1;
+        ret.swap = little != nativeLittle;
+        return ret;
+    }
+
+    // Walks over one item of an element with lists, calling f(property index, data) for
+    // each of its properties.
+    template <typename F>
+    char const* walk(Element const &e, char const *p, char const *end, bool swap, F f) {
+        for (std::size_t i=0; i!=e.properties.size(); ++i) {
+            Property const &prop = e.properties[i];
+            std::size_t bytes = size(prop.type);
+            if (prop.list) {
+                if (p + size(prop.countType) > end)
+                    throw std::runtime_error("PLY: file is truncated");
+                bytes = size(prop.countType) + size(prop.type) * std::size_t(read(p, prop.countType, swap));
+            }
+            if (p + bytes > end)
+                throw std::runtime_error("PLY: file is truncated");
+            f(i, p);
+            p += bytes;
+        }
+        return p;
+    }
+}
+
+
+Shapes::MeshBuffers readPly (std::string const &path) {
+    const MappedFile file(path);
+    const Header header = parseHeader(file);
+    const bool swap = header.swap;
+    char const *p = header.body, *const end = file.end();
+
+    Shapes::MeshBuffers ret;
+    bool haveVertices = false;
+    for (Element const &e : header.elements) {
+        const std::size_t stride = e.stride();
+
+        if (e.name == "vertex") {
+            if (!stride)
+                throw std::runtime_error("PLY: vertices with list properties are not supported");
+            if (std::size_t(end - p) / stride < e.count)
+                throw std::runtime_error("PLY: file is truncated");
+            const int x = e.find({"x"}), y = e.find({"y"}), z = e.find({"z"}),
+                      nx = e.find({"nx"}), ny = e.find({"ny"}), nz = e.find({"nz"}),
+                      u = e.find({"u", "s", "texture_u"}), v = e.find({"v", "t", "texture_v"});
+            if (x < 0 || y < 0 || z < 0)
+                throw std::runtime_error("PLY: vertices have no x, y and z");
+            const bool normals = nx >= 0 && ny >= 0 && nz >= 0,
+                       uvs = u >= 0 && v >= 0;
+
+            std::vector<std::size_t> offset(e.properties.size());
+            for (std::size_t i=1; i<offset.size(); ++i)
+                offset[i] = offset[i-1] + size(e.properties[i-1].type);
+            auto const get = [&](char const *item, int i) {
+                return real(read(item + offset[i], e.properties[i].type, swap));
+            };
+
+            ret.positions.resize(e.count);
+            if (normals) ret.normals.resize(e.count);
+            if (uvs)     ret.uvs.resize(e.count);
+            const long count = e.count;
+            #pragma omp parallel for schedule(static)
+            for (long i=0; i<count; ++i) {
+                char const *item = p + i*stride;
+                ret.positions[i] = Geometry::Point(get(item, x), get(item, y), get(item, z));
+                if (normals)
+                    ret.normals[i] = Geometry::Vector(get(item, nx), get(item, ny), get(item, nz));
+                if (uvs)
+                    ret.uvs[i] = Geometry::Point2d{get(item, u), get(item, v)};
+            }
+            p += e.count * stride;
+            haveVertices = true;
+
+        } else if (e.name == "face") {
+            if (!haveVertices)
+                throw std::runtime_error("PLY: faces before vertices");
+            const int list = e.find({"vertex_indices", "vertex_index"});
+            if (list < 0 || !e.properties[list].list)
+                throw std::runtime_error("PLY: faces have no vertex_indices");
+            Property const &indices = e.properties[list];
+            const std::int64_t vertices = ret.positions.size();
+
+            // If every face is a triangle, and nothing else is a list, faces are equally
+            // long, and converted in parallel. Reading the counts at those offsets detects
+            // the first face that is not a triangle, so nothing is misread.
+            bool triangles = true;
+            std::size_t before = 0, triangleStride = 0;
+            for (std::size_t i=0; i!=e.properties.size(); ++i) {
+                if (int(i) == list) {
+                    before = triangleStride;
+                    triangleStride += size(indices.countType) + 3 * size(indices.type);
+                } else if (e.properties[i].list) {
+                    triangles = false;
+                } else {
+                    triangleStride += size(e.properties[i].type);
+                }
+            }
+            triangles = triangles && std::size_t(end - p) / triangleStride >= e.count;
+            const long count = e.count;
+            if (triangles) {
+                #pragma omp parallel for schedule(static) reduction(&&:triangles)
+                for (long i=0; i<count; ++i)
+                    triangles = triangles && read(p + i*triangleStride + before, indices.countType, swap) == 3;
+            }
+
+            bool outOfRange = false;
+            if (triangles) {
+                ret.indices.resize(3 * e.count);
+                #pragma omp parallel for schedule(static) reduction(||:outOfRange)
+                for (long i=0; i<count; ++i) {
+                    char const *item = p + i*triangleStride + before + size(indices.countType);
+                    for (int k=0; k!=3; ++k) {
+                        const std::int64_t index = read(item + k*size(indices.type), indices.type, swap);
+                        outOfRange = outOfRange || index < 0 || index >= vertices;
+                        ret.indices[3*i+k] = index;
+                    }
+                }
+                p += e.count * triangleStride;
+            } else {
+                ret.indices.reserve(3 * e.count);
+                std::vector<std::uint32_t> polygon;
+                for (std::size_t i=0; i!=e.count; ++i) {
+                    p = walk(e, p, end, swap, [&](std::size_t prop, char const *data) {
+                        if (int(prop) != list)
+                            return;
+                        const std::size_t n = read(data, indices.countType, swap);
+                        data += size(indices.countType);
+                        polygon.clear();
+                        for (std::size_t k=0; k!=n; ++k) {
+                            const std::int64_t index = read(data + k*size(indices.type), indices.type, swap);
+                            outOfRange = outOfRange || index < 0 || index >= vertices;
+                            polygon.push_back(index);
+                        }
+                        for (std::size_t k=2; k<n; ++k) {
+                            ret.indices.push_back(polygon[0]);
+                            ret.indices.push_back(polygon[k-1]);
+                            ret.indices.push_back(polygon[k]);
+                        }
+                    });
+                }
+            }
+            if (outOfRange)
+                throw std::runtime_error("PLY: face index out of range");
+
+        } else if (stride) {
+            if (std::size_t(end - p) / stride < e.count)
+                throw std::runtime_error("PLY: file is truncated");
+            p += e.count * stride;
+        } else {
+            for (std::size_t i=0; i!=e.count; ++i)
+                p = walk(e, p, end, swap, [](std::size_t, char const*) {});
+        }
+    }
+
+    if (ret.indices.empty())
+        throw std::runtime_error("PLY: '" + path + "' has no triangles");
+    return ret;
+}
+
+} }
@@ -0,0 +1,23 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef PLY_HH_INCLUDED_20130908
+#define PLY_HH_INCLUDED_20130908
+
+#include "Shapes/TriangleMesh.hh"
+#include <string>
+
+namespace excyrender { namespace MeshFormat {
+
+    // Binary PLY, either byte order, as scanners write it. Reads the vertex properties
+    // x,y,z, nx,ny,nz and u,v (or s,t, texture_u,texture_v) of any scalar type, and the
+    // vertex_indices (or vertex_index) list of faces; polygons are split into fans, other
+    // elements and properties are skipped. Vertices, and faces if all are triangles, are
+    // converted in parallel, straight out of the mapped file.
+    //
+    // Throws std::runtime_error for ASCII PLY and anything malformed.
+    Shapes::MeshBuffers readPly (std::string const &path);
+
+} }
+
+#endif // PLY_HH_INCLUDED_20130908
@@ -0,0 +1,25 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "MeshFormat/ReadMesh.hh"
+#include "MeshFormat/OBJ.hh"
+#include "MeshFormat/PLY.hh"
+
+#include <stdexcept>
+
+namespace excyrender { namespace MeshFormat {
+
+Shapes::MeshBuffers readMesh (std::string const &path) {
+    auto const endsWith = [&](char const *ext) {
+        const std::string e(ext);
+        return path.size() >= e.size()
+            && path.compare(path.size() - e.size(), e.size(), e) == 0;
+    };
+    if (endsWith(".ply"))
+        return readPly(path);
+    if (endsWith(".obj"))
+        return readObj(path);
+    throw std::runtime_error("readMesh: unknown format of '" + path + "' (want .ply or .obj)");
+}
+
+} }
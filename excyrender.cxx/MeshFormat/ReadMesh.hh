@@ -0,0 +1,18 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef READMESH_HH_INCLUDED_20130908
+#define READMESH_HH_INCLUDED_20130908
+
+#include "Shapes/TriangleMesh.hh"
+#include <string>
+
+namespace excyrender { namespace MeshFormat {
+
+    // readPly() or readObj(), by the extension of 'path'. Throws std::runtime_error for
+    // other extensions.
+    Shapes::MeshBuffers readMesh (std::string const &path);
+
+} }
+
+#endif // READMESH_HH_INCLUDED_20130908
@@ -10,45 +10,57 @@
 #include "DifferentialGeometry.hh"
 #include "Geometry/Direction.hh"
 #include "optional.hh"
-#include <vector>
-#include <memory>
 #include <initializer_list>
+#include <stdexcept>
+#include <tuple>
+#include <utility>
 
 
 namespace excyrender { namespace Photometry { namespace Surface {
 
-    class BSDF final
+    // pdf(), f() and sample_f() of BSDF and ClosedBSDF, over the BxDFs of a Derived with
+    //
+    //   int size() const noexcept;
+    //   template <typename F> auto visit(int b, F &&f) const;   // f(BxDF number b)
+    //
+    // where f is called with the BxDF as its actual type if Derived knows it.
+    template <typename Derived>
+    class BasicBSDF
     {
     public:
-        BSDF() = delete;
-        BSDF(std::initializer_list<std::shared_ptr<BxDF>> const &l)
-            : bxdfs(l)
-        {
-            if (!l.size())
-                throw std::logic_error("BSDF must have one or more BxDFs");
-        }
+        // One, as long as sample_f() can not choose between BxDFs; add() checks it, so
+        // that rendering need not.
+        static constexpr int max_bxdfs = 1;
 
-        real pdf(Geometry::Direction const &wo, Geometry::Direction const &wi) const noexcept
+        // Density of sample_f() choosing world space 'wi'. Specular BxDFs do not
+        // contribute, so 0 means that 'wi' can only be reached by a specular sample.
+        real pdf(DifferentialGeometry const &dg,
+                 Geometry::Direction const &wo, Geometry::Direction const &wi) const noexcept
         {
+            const auto wo_ = worldToLocal(dg, wo),
+                       wi_ = worldToLocal(dg, wi);
             real sum = 0;
-            for (auto const &bxdf_ : bxdfs) {
-                auto const &bxdf = *bxdf_;
-                if (bxdf.distribution == BxDF::Distribution::Continuous)
-                    sum += bxdf.pdf(wo, wi);
-            }
+            for (int b=0; b!=self().size(); ++b)
+                sum += self().visit(b, Pdf{wo_, wi_});
             return sum;
         }
 
+        // As f(wo,wi), but for world space directions.
+        Photometry::Spectrum
+         f(DifferentialGeometry const &dg,
+           Geometry::Direction const &wo, Geometry::Direction const &wi)
+         const noexcept
+        {
+            return f(worldToLocal(dg, wo), worldToLocal(dg, wi));
+        }
+
         Photometry::Spectrum
          f(Geometry::Direction const &wo, Geometry::Direction const &wi)
          const noexcept
         {
             auto sum = Photometry::Spectrum::Black(400,800,8);
-            for (auto const &bxdf_ : bxdfs) {
-                auto const &bxdf = *bxdf_;
-                if (bxdf.distribution == BxDF::Distribution::Continuous)
-                    sum += bxdf.f(wo, wi);
-            }
+            for (int b=0; b!=self().size(); ++b)
+                self().visit(b, F{wo, wi, sum});
             return sum;
         }
 
@@ -57,29 +69,15 @@ namespace excyrender { namespace Photometry { namespace Surface {
                   optional<BxDF::ReflectionClass> refl,
                   DifferentialGeometry const &dg,
                   Geometry::Direction const &wo,
-                  std::function<real()> rng
+                  Sampling::Sampler &sampler
                  ) const noexcept
         {
-            int count = 0;
-            for (auto const &bxdf : bxdfs) {
-                if ((!dist || *dist==bxdf->distribution)
-                  && (!refl || *refl==bxdf->reflection))
-                  ++count;
-            }
-            if (count > 1)
-                throw std::logic_error("BSDF currently supports up tp 1 sample-able BxDFs");
-            if (count != 0) {
-                const auto wo_ = worldToLocal(dg, wo);
-                for (auto const &bxdf_ : bxdfs) {
-                    auto const &bxdf = *bxdf_;
-                    if ((!dist || *dist==bxdf.distribution)
-                      && (!refl || *refl==bxdf.reflection))
-                    {
-                        const auto & r = bxdf.sample_f(wo_, rng);
-                        return std::make_tuple(localToWorld(dg, std::get<0>(r)),
-                                               std::get<1>(r),
-                                               std::get<2>(r));
-                    }
+            for (int b=0; b!=self().size(); ++b) {
+                if (self().visit(b, Matches{dist, refl})) {
+                    const auto r = self().visit(b, SampleF{worldToLocal(dg, wo), sampler});
+                    return std::make_tuple(localToWorld(dg, std::get<0>(r)),
+                                           std::get<1>(r),
+                                           std::get<2>(r));
                 }
             }
             return std::make_tuple(Geometry::Direction(0,1,0),
@@ -87,8 +85,90 @@ namespace excyrender { namespace Photometry { namespace Surface {
                                    0);
         }
 
+    protected:
+        BasicBSDF() = default;
+        ~BasicBSDF() = default;
+
     private:
-        std::vector<std::shared_ptr<BxDF>> bxdfs;
+        Derived const& self() const noexcept {
+            return static_cast<Derived const&>(*this);
+        }
+
+        struct Pdf {
+            Geometry::Direction const &wo, &wi;
+            template <typename T> real operator() (T const &bxdf) const noexcept {
+                return bxdf.distribution == BxDF::Distribution::Continuous ? bxdf.pdf(wo, wi) : 0;
+            }
+        };
+        struct F {
+            Geometry::Direction const &wo, &wi;
+            Photometry::Spectrum &sum;
+            template <typename T> void operator() (T const &bxdf) const noexcept {
+                if (bxdf.distribution == BxDF::Distribution::Continuous)
+                    sum += bxdf.f(wo, wi);
+            }
+        };
+        struct Matches {
+            optional<BxDF::Distribution> const &dist;
+            optional<BxDF::ReflectionClass> const &refl;
+            template <typename T> bool operator() (T const &bxdf) const noexcept {
+                return (!dist || *dist==bxdf.distribution) && (!refl || *refl==bxdf.reflection);
+            }
+        };
+        struct SampleF {
+            Geometry::Direction const &wo;
+            Sampling::Sampler &sampler;
+            template <typename T>
+            std::tuple<Geometry::Direction, Photometry::Spectrum, real> operator() (T const &bxdf) const noexcept {
+                return bxdf.sample_f(wo, sampler);
+            }
+        };
+    };
+
+
+    // A BSDF only refers to its BxDFs. Usually, both are created in a MemoryArena by
+    // Material::bsdf(), and live until the arena is reset.
+    class BSDF final : public BasicBSDF<BSDF>
+    {
+    public:
+        BSDF() = delete;
+
+        explicit BSDF(BxDF const *bxdf)
+        {
+            add(bxdf);
+        }
+
+        BSDF(std::initializer_list<BxDF const*> const &l)
+        {
+            if (!l.size())
+                throw std::logic_error("BSDF must have one or more BxDFs");
+            for (auto bxdf : l)
+                add(bxdf);
+        }
+
+        void add(BxDF const *bxdf)
+        {
+            if (!bxdf)
+                throw std::logic_error("BSDF::add() called with null BxDF");
+            if (count == max_bxdfs)
+                throw std::logic_error("BSDF supports at most BSDF::max_bxdfs BxDFs");
+            bxdfs[count++] = bxdf;
+        }
+
+    private:
+        friend class BasicBSDF<BSDF>;
+
+        BxDF const *bxdfs[max_bxdfs];
+        int count = 0;
+
+        int size() const noexcept {
+            return count;
+        }
+
+        template <typename F>
+        auto visit(int b, F &&f) const -> decltype(f(std::declval<BxDF const&>())) {
+            return f(*bxdfs[b]);
+        }
     };
 } } }
 
@@ -6,6 +6,7 @@
 
 #include "Geometry/Direction.hh"
 #include "Photometry/Spectrum.hh"
+#include "Sampling/Sampler.hh"
 #include <tuple>
 
 namespace excyrender { namespace Photometry { namespace Surface {
@@ -30,7 +31,7 @@ public:
     virtual real pdf(Geometry::Direction const &wo, Geometry::Direction const &wi) const noexcept = 0;
     virtual Photometry::Spectrum f(Geometry::Direction const &wo, Geometry::Direction const &wi) const noexcept = 0;
     virtual std::tuple<Geometry::Direction, Photometry::Spectrum, real>
-         sample_f(Geometry::Direction const &wo, std::function<real()> rng) const noexcept = 0;
+         sample_f(Geometry::Direction const &wo, Sampling::Sampler &sampler) const noexcept = 0;
 
 protected:        
     BxDF(Distribution d, ReflectionClass r)
@@ -62,9 +63,9 @@ public:
     }
     
     std::tuple<Geometry::Direction, Photometry::Spectrum, real>
-      sample_f(Geometry::Direction const &wo, std::function<real()> rng) const noexcept
+      sample_f(Geometry::Direction const &wo, Sampling::Sampler &sampler) const noexcept
     {
-        const auto wi = Geometry::cosineWeightedHemisphere(rng);
+        const auto wi = Geometry::cosineWeightedHemisphere(sampler);
         return std::make_tuple(wi, s, pdf(wo,wi));
     }
 
@@ -97,7 +98,7 @@ public:
     }
     
     std::tuple<Geometry::Direction, Photometry::Spectrum, real>
-      sample_f(Geometry::Direction const &wo, std::function<real()>) const noexcept
+      sample_f(Geometry::Direction const &wo, Sampling::Sampler &) const noexcept
     {
         const Geometry::Direction rdir {-wo.x(), wo.y(), -wo.z()};
         return std::make_tuple(rdir, s * (1 / fabs(rdir.y())), 1);
@@ -0,0 +1,91 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef CLOSEDBSDF_HH_INCLUDED_20130911
+#define CLOSEDBSDF_HH_INCLUDED_20130911
+
+#include "Photometry/BSDF/BSDF.hh"
+#include "detail/Variant.hh"
+#include <new>
+#include <stdexcept>
+
+namespace excyrender { namespace Photometry { namespace Surface {
+
+    // As BSDF, but for BxDFs of the types BxDFs only, which it holds by value: calls to
+    // them are resolved at compile time, and can be inlined. See
+    // SurfaceIntegrators::ClosedWorld.
+    template <typename ...BxDFs>
+    class ClosedBSDF final : public BasicBSDF<ClosedBSDF<BxDFs...>>
+    {
+        typedef BasicBSDF<ClosedBSDF<BxDFs...>> base_type;
+    public:
+        typedef excyrender::detail::Variant<BxDFs...> bxdf_type;
+
+        ClosedBSDF() = delete;
+
+        explicit ClosedBSDF(bxdf_type const &bxdf)
+        {
+            add(bxdf);
+        }
+
+        ClosedBSDF(ClosedBSDF const &rhs)
+        {
+            for (int b=0; b!=rhs.count; ++b)
+                add(rhs[b]);
+        }
+
+        ClosedBSDF& operator= (ClosedBSDF const &) = delete;
+
+        ~ClosedBSDF()
+        {
+            for (int b=0; b!=count; ++b)
+                (*this)[b].~bxdf_type();
+        }
+
+        void add(bxdf_type const &bxdf)
+        {
+            if (count == base_type::max_bxdfs)
+                throw std::logic_error("ClosedBSDF supports at most BSDF::max_bxdfs BxDFs");
+            new (&bxdfs[count++]) bxdf_type(bxdf);
+        }
+
+        // A BSDF referring to the BxDFs held here, for interfaces that take one, like
+        // LightSource. Valid for as long as this lives.
+        BSDF open() const
+        {
+            BSDF ret(&base(0));
+            for (int b=1; b<count; ++b)
+                ret.add(&base(b));
+            return ret;
+        }
+
+    private:
+        friend class BasicBSDF<ClosedBSDF<BxDFs...>>;
+
+        typename std::aligned_storage<sizeof(bxdf_type), alignof(bxdf_type)>::type bxdfs[base_type::max_bxdfs];
+        int count = 0;
+
+        bxdf_type const& operator[] (int b) const noexcept {
+            return *reinterpret_cast<bxdf_type const*>(&bxdfs[b]);
+        }
+
+        int size() const noexcept {
+            return count;
+        }
+
+        template <typename F>
+        auto visit(int b, F &&f) const -> decltype((*this)[b].visit(std::forward<F>(f))) {
+            return (*this)[b].visit(std::forward<F>(f));
+        }
+
+        struct Base {
+            template <typename T> BxDF const& operator() (T const &bxdf) const noexcept { return bxdf; }
+        };
+        BxDF const& base(int b) const noexcept {
+            return (*this)[b].visit(Base());
+        }
+    };
+
+} } }
+
+#endif // CLOSEDBSDF_HH_INCLUDED_20130911
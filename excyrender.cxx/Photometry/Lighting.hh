@@ -13,9 +13,24 @@
 #include "Photometry/BSDF/BSDF.hh"
 #include "Primitives/Primitive.hh"
 #include "Photometry/Spectrum.hh"
+#include "Statistics.hh"
+#include "optional.hh"
+#include <functional>
 
 namespace excyrender { namespace Photometry {
 
+    // Light arriving at a point from a sampled direction.
+    struct LightSample {
+        Geometry::Direction wi;
+        Photometry::Spectrum Li;
+        // Solid angle density with which 'wi' was chosen; 1 for delta lights.
+        real pdf;
+        // Delta lights cannot be hit by BSDF sampled rays.
+        bool delta;
+        // Position of the emitter; none for lights at infinity.
+        optional<Geometry::Point> position;
+    };
+
     class LightSource {
     public:
         virtual ~LightSource() {}
@@ -23,8 +38,25 @@ namespace excyrender { namespace Photometry {
             lightFrom (Geometry::Direction const &wo, Surface::BSDF const &bsdf,
                        Primitives::Primitive const &prim,
                        Geometry::Point const &at, Geometry::Normal const &n) const noexcept = 0;
+
+        // Samples incident light at 'dg' from two numbers in [0,1). Occlusion is left to
+        // the caller.
+        virtual LightSample sample (DifferentialGeometry const &dg, real u0, real u1) const noexcept = 0;
+
+        // Density with which sample() chooses 'wi' at 'dg'. 0 for delta lights.
+        virtual real pdf (DifferentialGeometry const &dg, Geometry::Direction const &wi) const noexcept = 0;
     };
 
+    // 'at' is best an offsetOrigin() of the surface point.
+    inline bool occluded(Primitives::Primitive const &prim, Geometry::Point const &at,
+                         LightSample const &s) noexcept
+    {
+        const bool ret = s.position ? prim.occludes(at, *s.position)
+                                    : prim.occludes(at, s.wi);
+        Statistics::ray(Statistics::RayType::Shadow, ret);
+        return ret;
+    }
+
     class Directional final : public LightSource {
     public:
         Directional() = delete;
@@ -38,27 +70,83 @@ namespace excyrender { namespace Photometry {
                       Primitives::Primitive const &prim,
                       Geometry::Point const &at, Geometry::Normal const &n) const noexcept
         {
-            const real transmittance = prim.occludes(at, wi) ? 0 : 1,
+            const bool occluded = prim.occludes(offsetOrigin(at, n, wi), wi);
+            Statistics::ray(Statistics::RayType::Shadow, occluded);
+            const real transmittance = occluded ? 0 : 1,
                        dot_ = max(real(0), dot(static_cast<Geometry::Direction>(n), wi));
             return bsdf.f(wo, wi) * color * (dot_*transmittance);
         }
 
+        LightSample sample (DifferentialGeometry const &, real, real) const noexcept
+        {
+            return LightSample{wi, color, 1, true, optional<Geometry::Point>()};
+        }
+
+        real pdf (DifferentialGeometry const &, Geometry::Direction const &) const noexcept
+        {
+            return 0;
+        }
+
     private:
         Geometry::Direction wi;
         Photometry::Spectrum color;
     };
 
 
+    // Light from the scene background, sampled uniformly over the hemisphere above the
+    // surface.
+    //
+    // Integrators that do not sample lights pick environment light up through rays that
+    // escape the scene; therefore, lightFrom() contributes nothing.
+    class Environment final : public LightSource {
+    public:
+        typedef std::function<Photometry::Spectrum(Geometry::Direction const &)> Radiance;
+
+        Environment() = delete;
+
+        explicit Environment(Radiance radiance)
+            : radiance(radiance)
+        {}
+
+        Photometry::Spectrum
+           lightFrom (Geometry::Direction const &, Surface::BSDF const &,
+                      Primitives::Primitive const &,
+                      Geometry::Point const &, Geometry::Normal const &) const noexcept
+        {
+            return Photometry::Spectrum::Black(400,800,8);
+        }
+
+        LightSample sample (DifferentialGeometry const &dg, real u0, real u1) const noexcept
+        {
+            const auto wi = localToWorld(dg, Geometry::uniformHemisphere(u0, u1));
+            return LightSample{wi, radiance(wi), 1/(2*pi), false, optional<Geometry::Point>()};
+        }
+
+        real pdf (DifferentialGeometry const &dg, Geometry::Direction const &wi) const noexcept
+        {
+            return dot(static_cast<Geometry::Direction>(dg.nn), wi) > 0 ? 1/(2*pi) : 0;
+        }
+
+        Photometry::Spectrum operator() (Geometry::Direction const &wi) const
+        {
+            return radiance(wi);
+        }
+
+    private:
+        Radiance radiance;
+    };
+
+
     template <typename Lights>
     Spectrum directLighting(Lights const &lights,
                             Primitives::Primitive const &prim,
+                            Surface::BSDF const &bsdf,
                             Intersection const &intersection,
                             Geometry::Direction const &wo) noexcept
     {
         Photometry::Spectrum sum = Photometry::Spectrum::Black(400, 800, 8);
-        for (auto light : lights) {
-            sum += light->lightFrom(wo, intersection.material->bsdf(intersection.dg),
-                                    prim, intersection.dg.poi, intersection.dg.nn);
+        for (auto const &light : lights) {
+            sum += light->lightFrom(wo, bsdf, prim, intersection.dg.poi, intersection.dg.nn);
         }
         return sum;
     }
@@ -5,16 +5,34 @@
 #define SIMPLE_HH_INCLUDED_20130809
 
 #include "Material.hh"
+#include "memory.hh"
+#include <vector>
+#include <initializer_list>
 
 namespace excyrender { namespace Photometry { namespace Material {
+        // Yields the same BxDFs everywhere. The BxDFs are owned by the material, only the
+        // BSDF referring to them is built in the arena.
         struct BSDFPassthrough final : Material {
-            BSDFPassthrough(Surface::BSDF const &bsdf) : bsdf_(bsdf) {}
+            BSDFPassthrough(std::initializer_list<shared_ptr<const Surface::BxDF>> bxdfs)
+                : bxdfs(bxdfs)
+            {
+                if (!bxdfs.size())
+                    throw std::logic_error("BSDFPassthrough must have one or more BxDFs");
+                if (bxdfs.size() > Surface::BSDF::max_bxdfs)
+                    throw std::logic_error("BSDFPassthrough supports at most BSDF::max_bxdfs BxDFs");
+                for (auto const &bxdf : bxdfs)
+                    if (!bxdf)
+                        throw std::logic_error("BSDFPassthrough called with null BxDF");
+            }
 
-            Surface::BSDF bsdf(DifferentialGeometry const &) const noexcept {
-                return bsdf_;
+            Surface::BSDF const& bsdf(DifferentialGeometry const &, MemoryArena &arena) const noexcept {
+                auto ret = arena.create<Surface::BSDF>(bxdfs[0].get());
+                for (size_t i=1; i<bxdfs.size(); ++i)
+                    ret->add(bxdfs[i].get());
+                return *ret;
             }
         private:
-            Surface::BSDF bsdf_;
+            std::vector<shared_ptr<const Surface::BxDF>> bxdfs;
         };
 } } }
 
@@ -6,24 +6,51 @@
 
 #include "Material.hh"
 #include "Photometry/Texture/Texture.hh"
+#include "Photometry/Texture/CompiledTexture.hh"
 #include "Photometry/BSDF/BSDF.hh"
 #include "Photometry/BSDF/BxDF.hh"
 #include "memory.hh"
+#include <stdexcept>
 
 namespace excyrender { namespace Photometry { namespace Material {
         struct Lambertian final : Material {
+            // The texture is compiled, see Texture::CompiledTexture. A tree that can not be
+            // compiled (too deep for the registers, or with a constant of another spectral
+            // topology) is evaluated as it is.
             Lambertian (shared_ptr<Photometry::Texture::SpectrumTexture> texture)
-             : texture(texture) {
+             : tree(texture), compiled(compile(texture)) {
             }
 
-            Surface::BSDF bsdf(DifferentialGeometry const &dg) const noexcept {
+            Surface::BSDF const& bsdf(DifferentialGeometry const &dg, MemoryArena &arena) const noexcept {
                 using namespace Surface;
-                const auto spec = (*texture)(dg);
-                return Surface::BSDF({shared_ptr<BxDF>(new Surface::Lambertian(spec))});
+                return *arena.create<BSDF>(arena.create<Surface::Lambertian>(reflectance(dg)));
+            }
+
+            // As bsdf(), but by value, as a Surface::ClosedBSDF that can hold a
+            // Surface::Lambertian. See SurfaceIntegrators::ClosedWorld.
+            template <typename ClosedBSDF>
+            ClosedBSDF closedBsdf(DifferentialGeometry const &dg) const noexcept {
+                return ClosedBSDF(Surface::Lambertian(reflectance(dg)));
             }
 
         private:
-            shared_ptr<Photometry::Texture::Texture<Spectrum>> texture;
+            typedef Photometry::Texture::CompiledTexture<Spectrum> Compiled;
+
+            shared_ptr<Photometry::Texture::SpectrumTexture> tree;
+            unique_ptr<Compiled> compiled;   // null if 'tree' could not be compiled
+
+            static unique_ptr<Compiled> compile(shared_ptr<Photometry::Texture::SpectrumTexture> const &tree) {
+                try {
+                    return unique_ptr<Compiled>(new Compiled(tree));
+                } catch (std::logic_error &) {
+                } catch (std::runtime_error &) {
+                }
+                return nullptr;
+            }
+
+            Spectrum reflectance(DifferentialGeometry const &dg) const noexcept {
+                return compiled ? (*compiled)(dg) : (*tree)(dg);
+            }
         };
 } } }
 
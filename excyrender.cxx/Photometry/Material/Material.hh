@@ -5,10 +5,17 @@
 #define MATERIAL_HH_INCLUDED_20130809
 
 #include "Photometry/BSDF/BSDF.hh"
+#include "MemoryArena.hh"
 
 namespace excyrender { namespace Photometry { namespace Material {
     struct Material {
-        virtual Surface::BSDF bsdf(DifferentialGeometry const &) const noexcept = 0;
+        virtual ~Material() {}
+
+        // Builds the BSDF at 'dg'. The BSDF and its BxDFs are constructed into 'arena'
+        // and stay valid until the arena is reset. The Spectra of textures and BxDFs are
+        // still heap allocated; that, or a Spectrum of another topology, can throw, which
+        // terminates rendering.
+        virtual Surface::BSDF const& bsdf(DifferentialGeometry const &, MemoryArena &arena) const noexcept = 0;
     };
 } } }
 
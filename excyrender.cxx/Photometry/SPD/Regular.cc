@@ -16,6 +16,7 @@ import Photometry.RGB(RGB(..))
 #include "Photometry/RGBToSpectrumCurves.hh"
 #include "Photometry/RGB.hh"
 #include <algorithm>
+#include <array>
 
 namespace excyrender {
     namespace Photometry {
@@ -38,14 +39,17 @@ namespace excyrender {
             {
                 using namespace CIEMatchingCurves;
 
-                std::valarray<real> samples(cie_length);
+                real x = 0, y = 0, z = 0;
                 for (int i=0; i!=cie_length; ++i) {
-                    samples[i] = (*this)(lambda_min + inverseDelta_ * i);
+                    const real s = (*this)(lambda_min + inverseDelta_ * i);
+                    x += s * cie_x[i];
+                    y += s * cie_y[i];
+                    z += s * cie_z[i];
                 }
                 return std::make_tuple(
-                    cie_inverse_length * (samples * cie_x).sum(),
-                    cie_inverse_length * (samples * cie_x).sum(),
-                    cie_inverse_length * (samples * cie_x).sum()
+                    cie_inverse_length * x,
+                    cie_inverse_length * y,
+                    cie_inverse_length * z
                 );
             }
 
@@ -53,49 +57,10 @@ namespace excyrender {
             {
                 using namespace RGBToSpectrumCurves;
 
-                const real r = rgb.r, g = rgb.g, b = rgb.b;
-
-                std::valarray<real> u(rgbToSpectrumCurves_length),
-                                    v(rgbToSpectrumCurves_length),
-                                    w(rgbToSpectrumCurves_length);
-                if (r<=g && r<=b)
-                {
-                    // Compute reflectance _SampledSpectrum_ with _r_ as minimum
-                    u = rgbRefl2SpectWhite * r;          // -- r += r * rgbRefl2SpectWhite
-                    if (g<=b) {
-                        v = rgbRefl2SpectCyan * (g-r);   // -- r += (g - r) * rgbRefl2SpectCyan;
-                        w = rgbRefl2SpectBlue * (b-g);   // -- r += (b - g) * rgbRefl2SpectBlue;
-                    } else {
-                        v = rgbRefl2SpectCyan  * (b-r);  // -- r += (b - r) * rgbRefl2SpectCyan;
-                        w = rgbRefl2SpectGreen * (g-b);  // -- r += (g - b) * rgbRefl2SpectGreen;
-                    }
-                }
-                else if (g<=r && g<=b)
-                {
-                    // -- Compute reflectance _SampledSpectrum_ with _g_ as minimum
-                    u = rgbRefl2SpectWhite * g;           // -- r += g * rgbRefl2SpectWhite
-                    if (r<=b) {
-                        v = rgbRefl2SpectMagenta * (r-g); // -- r += (r - g) * rgbRefl2SpectMagenta
-                        w = rgbRefl2SpectBlue    * (b-r); // -- r += (b - r) * rgbRefl2SpectBlue
-                    } else {
-                        v = rgbRefl2SpectMagenta * (b-g); // -- r += (b - g) * rgbRefl2SpectMagenta
-                        w = rgbRefl2SpectRed     * (r-b); // -- r += (r - b) * rgbRefl2SpectRed
-                    }
-                }
-                else
-                {
-                    // -- Compute reflectance _SampledSpectrum_ with _b_ as minimum
-                    u = rgbRefl2SpectWhite * b;          // -- r += b * rgbRefl2SpectWhite;
-                    if (r<=b) {
-                        v = rgbRefl2SpectYellow * (r-b); // -- r += (r - b) * rgbRefl2SpectYellow;
-                        w = rgbRefl2SpectGreen  * (g-r); // -- r += (g - r) * rgbRefl2SpectGreen;
-                    } else {
-                        v = rgbRefl2SpectYellow * (g-b); // -- r += (g - b) * rgbRefl2SpectYellow;
-                        w = rgbRefl2SpectRed    * (r-g); // -- r += (r - g) * rgbRefl2SpectRed;
-                    }
-                }
-                // TODO: check what this 0.94 is for
-                return Regular(rgbToSpectrumCurves_start, rgbToSpectrumCurves_end, (u+v+w)*0.94);
+                std::array<real, rgbToSpectrumCurves_length> spectrum;
+                reflectanceFromRGB(rgb.r, rgb.g, rgb.b, reflectanceCurves,
+                                   rgbToSpectrumCurves_length, spectrum.data());
+                return Regular(rgbToSpectrumCurves_start, rgbToSpectrumCurves_end, spectrum);
             }
         }
     }
@@ -0,0 +1,181 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SPECTRALTOPOLOGY_HH_INCLUDED_20130820
+#define SPECTRALTOPOLOGY_HH_INCLUDED_20130820
+
+#include "real.hh"
+#include "Photometry/RGB.hh"
+#include "Photometry/CIEMatchingCurves.hh"
+#include "Photometry/RGBToSpectrumCurves.hh"
+#include <array>
+#include <tuple>
+
+namespace excyrender { namespace Photometry {
+
+    namespace detail {
+        template <int ...> struct indices {};
+        template <int N, int ...Is> struct make_indices : make_indices<N-1, N-1, Is...> {};
+        template <int ...Is> struct make_indices<0, Is...> { typedef indices<Is...> type; };
+
+        constexpr int floor_positive(real x) noexcept {
+            return static_cast<int>(x);
+        }
+
+        // Weight of 'bin' when linearly interpolating a 'length'-bin spectrum at 'x'
+        // (measured in bins). Mirrors Spectrum::operator().
+        constexpr real lerp_weight(real x, int bin, int length) noexcept {
+            return (floor_positive(x) == bin ? 1 - (x - floor_positive(x)) : 0)
+                 + ((floor_positive(x)+1 < length ? floor_positive(x)+1 : length-1) == bin
+                    ? x - floor_positive(x) : 0);
+        }
+
+        // Position of the i-th CIE sample in bins of a spectrum. Mirrors the resampling
+        // Spectrum::toXYZ() does through Spectrum::FromSpectrum().
+        constexpr real cie_sample_position(int i, real lambdaMin, real lambdaMax, int length) noexcept {
+            return ((i / real(CIEMatchingCurves::cie_length) * (lambdaMax-lambdaMin) + lambdaMin)
+                    - lambdaMin) * (1 / ((lambdaMax-lambdaMin) / (length-1)));
+        }
+
+        // Sums the contribution of CIE samples [first,last) to 'bin'. Recursion is by
+        // halving, so that the constexpr nesting depth stays logarithmic.
+        constexpr real cie_weight(real const (&curve)[CIEMatchingCurves::cie_length],
+                                  int bin, real lambdaMin, real lambdaMax, int length,
+                                  int first, int last) noexcept
+        {
+            return last-first == 1
+                 ? curve[first] * lerp_weight(cie_sample_position(first, lambdaMin, lambdaMax, length),
+                                              bin, length)
+                 : cie_weight(curve, bin, lambdaMin, lambdaMax, length, first, (first+last)/2)
+                   + cie_weight(curve, bin, lambdaMin, lambdaMax, length, (first+last)/2, last);
+        }
+
+        // Value of an RGB-to-spectrum curve at 'lambda'. Mirrors SPD::Regular::operator(),
+        // including that values outside the curve are 0.
+        constexpr real rgb_curve_at(real const (&curve)[RGBToSpectrumCurves::rgbToSpectrumCurves_length],
+                                    real x) noexcept
+        {
+            using namespace RGBToSpectrumCurves;
+            return x < 0 ? 0
+                 : (floor_positive(x) < rgbToSpectrumCurves_length ? curve[floor_positive(x)] : 0)
+                        * (1 - (x - floor_positive(x)))
+                 + (floor_positive(x)+1 < rgbToSpectrumCurves_length ? curve[floor_positive(x)+1] : 0)
+                        * (x - floor_positive(x));
+        }
+
+        // Samples an RGB-to-spectrum curve at the i-th bin of a spectrum. Mirrors
+        // Spectrum::FromSPD().
+        constexpr real rgb_curve_sample(real const (&curve)[RGBToSpectrumCurves::rgbToSpectrumCurves_length],
+                                        int i, real lambdaMin, real lambdaMax, int length) noexcept
+        {
+            using namespace RGBToSpectrumCurves;
+            return rgb_curve_at(curve,
+                                ((i / real(length) * (lambdaMax-lambdaMin) + rgbToSpectrumCurves_start)
+                                  - rgbToSpectrumCurves_start)
+                                * (1 / ((rgbToSpectrumCurves_end - rgbToSpectrumCurves_start)
+                                        / (rgbToSpectrumCurves_length-1))));
+        }
+
+        template <int LambdaMin, int LambdaMax, int Length,
+                  typename Indices = typename make_indices<Length>::type>
+        struct SpectralTopologyTables;
+
+        template <int LambdaMin, int LambdaMax, int Length, int ...I>
+        struct SpectralTopologyTables<LambdaMin, LambdaMax, Length, indices<I...>> {
+            #define EXCYRENDER_CIE_WEIGHTS(curve) \
+                { cie_weight(CIEMatchingCurves::curve, I, LambdaMin, LambdaMax, Length, \
+                             0, CIEMatchingCurves::cie_length) \
+                  * CIEMatchingCurves::cie_inverse_length ... }
+            #define EXCYRENDER_RGB_SAMPLES(curve) \
+                { rgb_curve_sample(RGBToSpectrumCurves::curve, I, LambdaMin, LambdaMax, Length) ... }
+
+            static constexpr real cie_x[Length] = EXCYRENDER_CIE_WEIGHTS(cie_x),
+                                  cie_y[Length] = EXCYRENDER_CIE_WEIGHTS(cie_y),
+                                  cie_z[Length] = EXCYRENDER_CIE_WEIGHTS(cie_z);
+
+            static constexpr real white  [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectWhite),
+                                  cyan   [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectCyan),
+                                  magenta[Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectMagenta),
+                                  yellow [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectYellow),
+                                  red    [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectRed),
+                                  green  [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectGreen),
+                                  blue   [Length] = EXCYRENDER_RGB_SAMPLES(rgbRefl2SpectBlue);
+
+            #undef EXCYRENDER_CIE_WEIGHTS
+            #undef EXCYRENDER_RGB_SAMPLES
+        };
+
+        #define EXCYRENDER_DEFINE_TABLE(name) \
+            template <int LambdaMin, int LambdaMax, int Length, int ...I> \
+            constexpr real SpectralTopologyTables<LambdaMin, LambdaMax, Length, indices<I...>>::name[Length];
+        EXCYRENDER_DEFINE_TABLE(cie_x)
+        EXCYRENDER_DEFINE_TABLE(cie_y)
+        EXCYRENDER_DEFINE_TABLE(cie_z)
+        EXCYRENDER_DEFINE_TABLE(white)
+        EXCYRENDER_DEFINE_TABLE(cyan)
+        EXCYRENDER_DEFINE_TABLE(magenta)
+        EXCYRENDER_DEFINE_TABLE(yellow)
+        EXCYRENDER_DEFINE_TABLE(red)
+        EXCYRENDER_DEFINE_TABLE(green)
+        EXCYRENDER_DEFINE_TABLE(blue)
+        #undef EXCYRENDER_DEFINE_TABLE
+    }
+
+
+    // A spectral topology is a fixed (lambda_min, lambda_max, bins) triple. For a known
+    // topology, everything that only depends on the CIE and RGB-to-spectrum curves is
+    // derived at compile time: toXYZ() is then a Length-element dot product, and FromRGB()
+    // a blend of three Length-element curves, instead of resampling 471 CIE samples or
+    // going through an SPD::Regular.
+    //
+    // Wavelengths are integral nanometers so that they can be template arguments.
+    template <int LambdaMin, int LambdaMax, int Length>
+    struct SpectralTopology {
+        static_assert(LambdaMin < LambdaMax, "SpectralTopology: LambdaMin must be less than LambdaMax");
+        static_assert(Length >= 2, "SpectralTopology: Length must be 2 or greater");
+
+        static constexpr real lambda_min = LambdaMin,
+                              lambda_max = LambdaMax;
+        static constexpr int length = Length;
+
+        typedef detail::SpectralTopologyTables<LambdaMin, LambdaMax, Length> tables;
+        typedef std::array<real, Length> bins_type;
+
+        static constexpr bool matches(real lambdaMin, real lambdaMax, int length_) noexcept {
+            return lambdaMin == lambda_min && lambdaMax == lambda_max && length_ == length;
+        }
+
+        static std::tuple<real,real,real> toXYZ(real const *bins) noexcept {
+            real x = 0, y = 0, z = 0;
+            for (int i=0; i!=Length; ++i) {
+                x += tables::cie_x[i] * bins[i];
+                y += tables::cie_y[i] * bins[i];
+                z += tables::cie_z[i] * bins[i];
+            }
+            return std::make_tuple(x, y, z);
+        }
+
+        static real toY(real const *bins) noexcept {
+            real y = 0;
+            for (int i=0; i!=Length; ++i)
+                y += tables::cie_y[i] * bins[i];
+            return y;
+        }
+
+        static bins_type FromRGB(RGB const &rgb) noexcept {
+            static constexpr RGBToSpectrumCurves::ReflectanceCurves curves {
+                tables::white, tables::cyan, tables::magenta, tables::yellow,
+                tables::red, tables::green, tables::blue
+            };
+            bins_type ret;
+            RGBToSpectrumCurves::reflectanceFromRGB(rgb.r, rgb.g, rgb.b, curves, Length, ret.data());
+            return ret;
+        }
+    };
+
+    // The topology used throughout the renderer (Spectrum::Black(400,800,8) et al.).
+    typedef SpectralTopology<400,800,8> DefaultSpectralTopology;
+
+} }
+
+#endif // SPECTRALTOPOLOGY_HH_INCLUDED_20130820
@@ -9,6 +9,7 @@
 #include "Photometry/SPD/Regular.hh"
 #include "Photometry/RGB.hh"
 #include "Photometry/CIEMatchingCurves.hh"
+#include "Photometry/SpectralTopology.hh"
 #include <tuple>
 #include <valarray>
 #include <sstream>
@@ -49,10 +50,13 @@ namespace excyrender { namespace Photometry {
         Spectrum operator*= (real rhs);
         Spectrum operator/= (real rhs);
         Spectrum pow(real exponent) const;
+        real max() const;
 
         // -- conversion ----------------------------------------------------------------
         std::tuple<real,real,real> toXYZ() const;
         real toY() const;
+        // Throws std::runtime_error if not of DefaultSpectralTopology.
+        DefaultSpectralTopology::bins_type toDefaultBins() const;
 
         friend std::ostream& operator<< (std::ostream &, Spectrum const&);
 
@@ -111,6 +115,8 @@ namespace excyrender { namespace Photometry {
     }
 
     inline Spectrum Spectrum::FromRGB(real lambdaMin, real lambdaMax, int resolution, RGB const &rgb) {
+        if (DefaultSpectralTopology::matches(lambdaMin, lambdaMax, resolution))
+            return Spectrum(lambdaMin, lambdaMax, DefaultSpectralTopology::FromRGB(rgb));
         return FromSPD (lambdaMin, lambdaMax, resolution, SPD::Regular::FromRGB(rgb));
     }
 
@@ -152,6 +158,9 @@ namespace excyrender { namespace Photometry {
         ret.bins_ = std::pow(bins_, exponent);
         return ret;
     }
+    inline real Spectrum::max() const {
+        return bins_.max();
+    }
 
     inline real Spectrum::operator() (real lambda) const {
         const real x = (lambda - lambdaMin_) * inverseDelta_;
@@ -166,16 +175,46 @@ namespace excyrender { namespace Photometry {
     // -- conversion ------------------------------------------------------------------------------
     inline std::tuple<real,real,real> Spectrum::toXYZ() const {
         using namespace CIEMatchingCurves;
+        if (DefaultSpectralTopology::matches(lambdaMin_, lambdaMax_, bins_.size()))
+            return DefaultSpectralTopology::toXYZ(&bins_[0]);
+
         const auto &samples = FromSpectrum(lambdaMin_, lambdaMax_, cie_length, *this).bins_;
-        return std::make_tuple(cie_inverse_length * (cie_x * samples).sum(),
-                               cie_inverse_length * (cie_y * samples).sum(),
-                               cie_inverse_length * (cie_z * samples).sum());
+        real x = 0, y = 0, z = 0;
+        for (int i=0; i!=cie_length; ++i) {
+            x += cie_x[i] * samples[i];
+            y += cie_y[i] * samples[i];
+            z += cie_z[i] * samples[i];
+        }
+        return std::make_tuple(cie_inverse_length * x,
+                               cie_inverse_length * y,
+                               cie_inverse_length * z);
     }
 
     inline real Spectrum::toY() const {
         using namespace CIEMatchingCurves;
+        if (DefaultSpectralTopology::matches(lambdaMin_, lambdaMax_, bins_.size()))
+            return DefaultSpectralTopology::toY(&bins_[0]);
+
         const auto &samples = FromSpectrum(lambdaMin_, lambdaMax_, cie_length, *this).bins_;
-        return cie_inverse_length * (cie_y * samples).sum();
+        real y = 0;
+        for (int i=0; i!=cie_length; ++i)
+            y += cie_y[i] * samples[i];
+        return cie_inverse_length * y;
+    }
+
+
+
+    inline DefaultSpectralTopology::bins_type Spectrum::toDefaultBins() const {
+        if (!DefaultSpectralTopology::matches(lambdaMin_, lambdaMax_, bins_.size())) {
+            std::stringstream ss;
+            ss << "Tried to convert a Spectrum of topology "
+               << "[" << lambdaMin_ << " " << lambdaMax_ << " " << bins_.size() << "]"
+               << " to the default topology";
+            throw std::runtime_error(ss.str());
+        }
+        DefaultSpectralTopology::bins_type ret;
+        std::copy(std::begin(bins_), std::end(bins_), ret.begin());
+        return ret;
     }
 
 
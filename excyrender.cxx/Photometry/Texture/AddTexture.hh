@@ -6,15 +6,16 @@
 
 #include "Texture.hh"
 #include "memory.hh"
+#include <utility>
 
 namespace excyrender { namespace Photometry { namespace Texture {
 
     namespace detail {
         template <typename LHS, typename RHS>
         using addtexture_result_type = decltype(
-            (*((LHS*)nullptr)) (*((DifferentialGeometry*)nullptr))
+            std::declval<LHS const&>()(std::declval<DifferentialGeometry const&>())
             +
-            (*((LHS*)nullptr)) (*((DifferentialGeometry*)nullptr))
+            std::declval<RHS const&>()(std::declval<DifferentialGeometry const&>())
         );
     }
 
@@ -33,6 +34,11 @@ namespace excyrender { namespace Photometry { namespace Texture {
             return (*lhs)(dg) + (*rhs)(dg);
         }
 
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            const auto l = lhs->compile(b);
+            return b.add(l, rhs->compile(b));
+        }
+
     private:
         shared_ptr<LHS> lhs;
         shared_ptr<RHS> rhs;
@@ -0,0 +1,73 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef COMPILEDTEXTURE_HH_INCLUDED_20130903
+#define COMPILEDTEXTURE_HH_INCLUDED_20130903
+
+#include "Texture.hh"
+#include "Program.hh"
+#include "memory.hh"
+
+namespace excyrender { namespace Photometry { namespace Texture {
+
+    // A texture tree, evaluated as a Program: one pass over a flat instruction list
+    // instead of a virtual call and a Spectrum per node. Throws std::logic_error if the
+    // tree is too deep for the register file, std::runtime_error if a constant is not
+    // of DefaultSpectralTopology.
+    template <typename T>
+    class CompiledTexture final : public Texture<T> {
+    public:
+        explicit CompiledTexture (shared_ptr<Texture<T>> tree)
+            : tree(tree), program(build(*tree))
+        {
+        }
+
+        T operator() (DifferentialGeometry const &dg) const noexcept {
+            return result(program(dg));
+        }
+
+        // Evaluates 'count' hits at once.
+        void operator() (DifferentialGeometry const *dg, std::size_t count, T *out) const {
+            Program::Bins bins[Program::batch];
+            for (std::size_t i=0; i<count; i+=Program::batch) {
+                const std::size_t n = std::min(count-i, std::size_t(Program::batch));
+                program(dg+i, n, bins);
+                for (std::size_t j=0; j!=n; ++j)
+                    out[i+j] = result(bins[j]);
+            }
+        }
+
+        Program const &code() const noexcept { return program; }
+
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return tree->compile(b);
+        }
+
+    private:
+        shared_ptr<Texture<T>> tree;
+        Program program;
+
+        static Program build(Texture<T> const &tree) {
+            ProgramBuilder b;
+            return b.finish(tree.compile(b));
+        }
+
+        static T result(Program::Bins const &bins) noexcept;
+    };
+
+
+    template <>
+    inline
+    real CompiledTexture<real>::result(Program::Bins const &bins) noexcept {
+        return bins[0];
+    }
+
+    template <>
+    inline
+    Spectrum CompiledTexture<Spectrum>::result(Program::Bins const &bins) noexcept {
+        return Spectrum(DefaultSpectralTopology::lambda_min, DefaultSpectralTopology::lambda_max, bins);
+    }
+
+} } }
+
+#endif // COMPILEDTEXTURE_HH_INCLUDED_20130903
@@ -17,6 +17,10 @@ namespace excyrender { namespace Photometry { namespace Texture {
             return val;
         }
 
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return b.constant(val);
+        }
+
     private:
         T val;
     };
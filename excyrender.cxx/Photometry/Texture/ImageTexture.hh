@@ -7,27 +7,47 @@
 #include "Texture.hh"
 #include "Mapping2d.hh"
 #include "detail/Image.hh"
+#include <type_traits>
 
 namespace excyrender { namespace Photometry { namespace Texture {
 
     using excyrender::detail::ImageWrap;
+    using excyrender::detail::ImageFilter;
 
+    // Filtered over the pixel footprint where the mapping knows it (see
+    // computeDifferentials()), bicubic otherwise.
     template <typename T>
     class ImageTexture final : public Texture<T> {
     public:
 
         ImageTexture(shared_ptr<Mapping2d> mapping,
                      std::string const &filename,
-                     ImageWrap wrap = ImageWrap::Wrap)
-            : mapping(mapping), wrap(wrap), image(filename, wrap)
+                     ImageWrap wrap = ImageWrap::Wrap,
+                     ImageFilter filter = ImageFilter::EWA)
+            : mapping(mapping), wrap(wrap), filter(filter), image(filename, wrap)
         {
         }
 
         T operator() (DifferentialGeometry const &dg) const noexcept;
 
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return b.rgb(this, &ImageTexture::lookupRGB, std::is_same<T,real>::value);
+        }
+
     private:
         shared_ptr<Mapping2d> mapping;
         ImageWrap wrap;
+        ImageFilter filter;
+
+        Photometry::RGB lookup(DifferentialGeometry const &dg) const noexcept {
+            const auto c = (*mapping)(dg);
+            return image.filtered(c.s, c.t, c.dsdx, c.dtdx, c.dsdy, c.dtdy, filter);
+        }
+
+        static Photometry::RGB lookupRGB(void const *self, DifferentialGeometry const &dg) {
+            return static_cast<ImageTexture const*>(self)->lookup(dg);
+        }
+
         excyrender::detail::Image image;
     };
 
@@ -35,15 +55,13 @@ namespace excyrender { namespace Photometry { namespace Texture {
     template <>
     inline
     real ImageTexture<real>::operator() (DifferentialGeometry const &dg) const noexcept {
-        const auto coords = (*mapping)(dg);
-        return Spectrum::FromRGB(400,800,8, image.cubic(coords.s, coords.t)).toY(); // TODO: optimize
+        return Spectrum::FromRGB(400,800,8, lookup(dg)).toY(); // TODO: optimize
     }
 
     template <>
     inline
     Spectrum ImageTexture<Spectrum>::operator() (DifferentialGeometry const &dg) const noexcept {
-        const auto coords = (*mapping)(dg);
-        return Spectrum::FromRGB(400,800,8, image.cubic(coords.s, coords.t));
+        return Spectrum::FromRGB(400,800,8, lookup(dg));
     }
 
     using ColorImageTexture = ImageTexture<Spectrum>;
@@ -6,17 +6,18 @@
 
 #include "Texture.hh"
 #include "memory.hh"
+#include <utility>
 
 namespace excyrender { namespace Photometry { namespace Texture {
 
     namespace detail {
         template <typename LHS, typename RHS, typename FACTOR>
         using lerptexture_result_type = decltype(
-            (*((LHS*)nullptr)) (*((DifferentialGeometry*)nullptr))
-              * (1-(*((FACTOR*)nullptr)) (*((DifferentialGeometry*)nullptr)))
+            std::declval<LHS const&>()(std::declval<DifferentialGeometry const&>())
+              * (1-std::declval<FACTOR const&>()(std::declval<DifferentialGeometry const&>()))
             +
-            (*((LHS*)nullptr)) (*((DifferentialGeometry*)nullptr))
-              * (*((FACTOR*)nullptr)) (*((DifferentialGeometry*)nullptr))
+            std::declval<RHS const&>()(std::declval<DifferentialGeometry const&>())
+              * std::declval<FACTOR const&>()(std::declval<DifferentialGeometry const&>())
         );
     }
 
@@ -37,6 +38,12 @@ namespace excyrender { namespace Photometry { namespace Texture {
             return (*lhs)(dg) * (1-tmp) + (*rhs)(dg) * tmp;
         }
 
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            const auto l = lhs->compile(b);
+            const auto r = rhs->compile(b);
+            return b.lerp(l, r, factor->compile(b));
+        }
+
     private:
         shared_ptr<LHS> lhs;
         shared_ptr<RHS> rhs;
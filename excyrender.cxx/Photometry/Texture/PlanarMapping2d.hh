@@ -22,7 +22,9 @@ namespace excyrender { namespace Photometry { namespace Texture {
         TexCoords2d operator() (DifferentialGeometry const &dg) const noexcept {
             const auto vec = dg.poi - Geometry::Point(0,0,0);
             return { ds + dot(vec, vs),
-                     dt + dot(vec, vt) };
+                     dt + dot(vec, vt),
+                     dot(dg.dpdx, vs), dot(dg.dpdx, vt),
+                     dot(dg.dpdy, vs), dot(dg.dpdy, vt) };
         }
 
     private:
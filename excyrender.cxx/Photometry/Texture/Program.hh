@@ -0,0 +1,293 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef PROGRAM_HH_INCLUDED_20130903
+#define PROGRAM_HH_INCLUDED_20130903
+
+#include "DifferentialGeometry.hh"
+#include "Photometry/Spectrum.hh"
+#include "Photometry/SpectralTopology.hh"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <vector>
+
+namespace excyrender { namespace Photometry { namespace Texture {
+
+    template <typename T> struct Texture;
+
+    // A texture tree flattened into a sequence of instructions over a small register
+    // file, as built by ProgramBuilder from Texture::compile(). All values are spectra
+    // in DefaultSpectralTopology; scalars are held as spectra of equal bins.
+    //
+    // Hits are evaluated in batches, one instruction at a time for the whole batch, so
+    // that the cost of dispatching an instruction is shared by the batch and no Spectrum
+    // is allocated until the result is handed out.
+    //
+    // A program refers to the textures it was compiled from; they must outlive it.
+    class Program final {
+    public:
+        typedef DefaultSpectralTopology::bins_type Bins;
+        typedef std::int16_t Operand;   // register if >= 0, else ~index of a constant
+
+        static constexpr int registers = 16;
+        static constexpr int batch = 16;
+
+        typedef Photometry::RGB (*RGBLookup) (void const *texture, DifferentialGeometry const &);
+        typedef void (*CallLookup) (void const *texture, DifferentialGeometry const &, Bins &);
+
+        enum class Op : std::uint8_t {
+            Add,        // dst = a + b
+            Mul,        // dst = a * b
+            Lerp,       // dst = a * (1-c) + b * c
+            RGB,        // dst = rgb(texture, dg) as spectrum
+            Luminance,  // dst = rgb(texture, dg) as luminance
+            Call        // dst = texture(dg), for textures that do not compile
+        };
+
+        struct Instruction {
+            Op op;
+            Operand dst, a, b, c;
+            void const *texture;
+            RGBLookup rgb;
+            CallLookup call;
+        };
+
+        // Evaluates 'count' hits into 'out'.
+        void operator() (DifferentialGeometry const *dg, std::size_t count, Bins *out) const noexcept {
+            for (std::size_t i=0; i<count; i+=batch)
+                run(dg+i, std::min(count-i, std::size_t(batch)), out+i);
+        }
+
+        Bins operator() (DifferentialGeometry const &dg) const noexcept {
+            Bins ret;
+            run(&dg, 1, &ret);
+            return ret;
+        }
+
+        std::size_t size() const noexcept { return code_.size(); }
+        std::size_t constants() const noexcept { return constants_.size(); }
+
+    private:
+        friend class ProgramBuilder;
+
+        std::vector<Instruction> code_;
+        std::vector<Bins> constants_;
+        Operand result_ = 0;
+
+        void run(DifferentialGeometry const *dg, std::size_t n, Bins *out) const noexcept {
+            const int L = DefaultSpectralTopology::length;
+            Bins regs[registers][batch];
+
+            // Constants are shared by the batch, registers are per hit.
+            auto const operand = [&](Operand o, std::size_t &stride) -> Bins const* {
+                stride = o < 0 ? 0 : 1;
+                return o < 0 ? &constants_[~o] : regs[o];
+            };
+
+            for (Instruction const &in : code_) {
+                Bins *dst = regs[in.dst];
+                std::size_t sa, sb, sc;
+                switch (in.op) {
+                case Op::Add: {
+                    Bins const *a = operand(in.a, sa), *b = operand(in.b, sb);
+                    for (std::size_t j=0; j!=n; ++j)
+                        for (int k=0; k!=L; ++k)
+                            dst[j][k] = a[j*sa][k] + b[j*sb][k];
+                    break;
+                }
+                case Op::Mul: {
+                    Bins const *a = operand(in.a, sa), *b = operand(in.b, sb);
+                    for (std::size_t j=0; j!=n; ++j)
+                        for (int k=0; k!=L; ++k)
+                            dst[j][k] = a[j*sa][k] * b[j*sb][k];
+                    break;
+                }
+                case Op::Lerp: {
+                    Bins const *a = operand(in.a, sa), *b = operand(in.b, sb), *c = operand(in.c, sc);
+                    for (std::size_t j=0; j!=n; ++j)
+                        for (int k=0; k!=L; ++k)
+                            dst[j][k] = a[j*sa][k] * (1-c[j*sc][k]) + b[j*sb][k] * c[j*sc][k];
+                    break;
+                }
+                case Op::RGB:
+                    for (std::size_t j=0; j!=n; ++j)
+                        dst[j] = DefaultSpectralTopology::FromRGB(in.rgb(in.texture, dg[j]));
+                    break;
+                case Op::Luminance:
+                    for (std::size_t j=0; j!=n; ++j) {
+                        const Bins s = DefaultSpectralTopology::FromRGB(in.rgb(in.texture, dg[j]));
+                        dst[j].fill(DefaultSpectralTopology::toY(s.data()));
+                    }
+                    break;
+                case Op::Call:
+                    for (std::size_t j=0; j!=n; ++j)
+                        in.call(in.texture, dg[j], dst[j]);
+                    break;
+                }
+            }
+
+            std::size_t sr;
+            Bins const *r = operand(result_, sr);
+            for (std::size_t j=0; j!=n; ++j)
+                out[j] = r[j*sr];
+        }
+    };
+
+
+    // Receives a texture tree from Texture::compile(). Subtrees that only depend on
+    // constants are folded into a constant, as are additions of zero, multiplications
+    // by one and interpolations by zero or one.
+    //
+    // Every Value is to be passed to exactly one operation (or to finish()), which then
+    // owns its register.
+    class ProgramBuilder final {
+    public:
+        typedef Program::Operand Value;
+
+        Value constant(real v) {
+            Program::Bins b;
+            b.fill(v);
+            return constant(b);
+        }
+
+        Value constant(Spectrum const &s) {
+            return constant(s.toDefaultBins());
+        }
+
+        Value constant(Program::Bins const &b) {
+            if (prog_.constants_.size() >= 32767)
+                throw std::logic_error("ProgramBuilder: too many constants");
+            prog_.constants_.push_back(b);
+            return ~Value(prog_.constants_.size()-1);
+        }
+
+        Value add(Value a, Value b) {
+            if (isConstant(a) && isConstant(b))
+                return fold(a, b, b, [](real x, real y, real) { return x + y; });
+            if (isConstant(a, 0)) return b;
+            if (isConstant(b, 0)) return a;
+            return emit(Program::Op::Add, a, b, 0);
+        }
+
+        Value mul(Value a, Value b) {
+            if (isConstant(a) && isConstant(b))
+                return fold(a, b, b, [](real x, real y, real) { return x * y; });
+            if (isConstant(a, 1)) return b;
+            if (isConstant(b, 1)) return a;
+            return emit(Program::Op::Mul, a, b, 0);
+        }
+
+        Value lerp(Value lhs, Value rhs, Value factor) {
+            if (isConstant(lhs) && isConstant(rhs) && isConstant(factor))
+                return fold(lhs, rhs, factor, [](real x, real y, real f) { return x*(1-f) + y*f; });
+            if (isConstant(factor, 0)) { release(rhs); return lhs; }
+            if (isConstant(factor, 1)) { release(lhs); return rhs; }
+            return emit(Program::Op::Lerp, lhs, rhs, factor);
+        }
+
+        // A lookup of RGB values, e.g. from an image, converted to a spectrum or, if
+        // 'luminance', to its luminance.
+        Value rgb(void const *texture, Program::RGBLookup lookup, bool luminance) {
+            Program::Instruction in {luminance ? Program::Op::Luminance : Program::Op::RGB,
+                                     allocate(), 0, 0, 0, texture, lookup, nullptr};
+            prog_.code_.push_back(in);
+            return in.dst;
+        }
+
+        // A texture that is not compiled further, called as is.
+        template <typename T>
+        Value call(Texture<T> const &texture) {
+            Program::Instruction in {Program::Op::Call, allocate(), 0, 0, 0,
+                                     &texture, nullptr, &callTexture<T>};
+            prog_.code_.push_back(in);
+            return in.dst;
+        }
+
+        // Drops instructions whose result is never read, e.g. the operand a folded
+        // interpolation did not pick.
+        Program finish(Value result) {
+            prog_.result_ = result;
+            std::vector<Program::Instruction> live;
+            std::uint32_t needed = result >= 0 ? 1u << result : 0;
+            for (auto in = prog_.code_.rbegin(); in != prog_.code_.rend(); ++in) {
+                if (!(needed & (1u << in->dst)))
+                    continue;
+                needed &= ~(1u << in->dst);
+                if (in->op == Program::Op::Add || in->op == Program::Op::Mul || in->op == Program::Op::Lerp) {
+                    for (Value v : {in->a, in->b, in->op == Program::Op::Lerp ? in->c : Value(-1)})
+                        if (v >= 0)
+                            needed |= 1u << v;
+                }
+                live.push_back(*in);
+            }
+            prog_.code_.assign(live.rbegin(), live.rend());
+            return std::move(prog_);
+        }
+
+    private:
+        Program prog_;
+        std::uint32_t busy_ = 0;
+
+        static void toBins(real v, Program::Bins &out) noexcept { out.fill(v); }
+        static void toBins(Spectrum const &s, Program::Bins &out) noexcept { out = s.toDefaultBins(); }
+
+        template <typename T>
+        static void callTexture(void const *texture, DifferentialGeometry const &dg,
+                                Program::Bins &out) noexcept
+        {
+            toBins((*static_cast<Texture<T> const*>(texture))(dg), out);
+        }
+
+        bool isConstant(Value v) const noexcept { return v < 0; }
+
+        bool isConstant(Value v, real c) const noexcept {
+            if (v >= 0)
+                return false;
+            for (real x : prog_.constants_[~v])
+                if (x != c)
+                    return false;
+            return true;
+        }
+
+        template <typename F>
+        Value fold(Value a, Value b, Value c, F f) {
+            Program::Bins r;
+            Program::Bins const &x = prog_.constants_[~a], &y = prog_.constants_[~b],
+                                &z = prog_.constants_[~c];
+            for (std::size_t k=0; k!=r.size(); ++k)
+                r[k] = f(x[k], y[k], z[k]);
+            return constant(r);
+        }
+
+        Value emit(Program::Op op, Value a, Value b, Value c) {
+            release(a);
+            release(b);
+            if (op == Program::Op::Lerp)
+                release(c);
+            Program::Instruction in {op, allocate(), a, b, c, nullptr, nullptr, nullptr};
+            prog_.code_.push_back(in);
+            return in.dst;
+        }
+
+        Value allocate() {
+            for (int r=0; r!=Program::registers; ++r) {
+                if (!(busy_ & (1u << r))) {
+                    busy_ |= 1u << r;
+                    return r;
+                }
+            }
+            throw std::logic_error("ProgramBuilder: texture needs more than 16 registers");
+        }
+
+        void release(Value v) noexcept {
+            if (v >= 0)
+                busy_ &= ~(1u << v);
+        }
+    };
+
+} } }
+
+#endif // PROGRAM_HH_INCLUDED_20130903
@@ -8,8 +8,11 @@
 
 namespace excyrender { namespace Photometry { namespace Texture {
 
+    // Texture coordinates, and their change from one pixel to the next (zero if
+    // unknown), which textures may use to filter over the pixel footprint.
     struct TexCoords2d {
         real s, t;
+        real dsdx, dtdx, dsdy, dtdy;
     };
 
 } } }
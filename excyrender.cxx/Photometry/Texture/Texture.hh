@@ -6,6 +6,7 @@
 
 #include "DifferentialGeometry.hh"
 #include "Photometry/Spectrum.hh"
+#include "Program.hh"
 
 namespace excyrender { namespace Photometry { namespace Texture {
 
@@ -13,6 +14,12 @@ namespace excyrender { namespace Photometry { namespace Texture {
     struct Texture {
         virtual ~Texture() {}
         virtual T operator() (DifferentialGeometry const &) const noexcept = 0;
+
+        // Appends this texture to a Program. Textures that are not made of others are
+        // called as they are.
+        virtual ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return b.call(*this);
+        }
     };
 
     using RealTexture     = Texture<real>;
@@ -0,0 +1,70 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TILEDIMAGETEXTURE_HH_INCLUDED_20130902
+#define TILEDIMAGETEXTURE_HH_INCLUDED_20130902
+
+#include "Texture.hh"
+#include "Mapping2d.hh"
+#include "TextureCache/TiledImage.hh"
+#include <type_traits>
+
+namespace excyrender { namespace Photometry { namespace Texture {
+
+    using excyrender::detail::ImageWrap;
+    using excyrender::detail::ImageFilter;
+
+    // Like ImageTexture, but from a file written by TextureCache::write(), which stays on
+    // disk: only the tiles in use take memory, under the budget of the tile cache.
+    template <typename T>
+    class TiledImageTexture final : public Texture<T> {
+    public:
+
+        TiledImageTexture(shared_ptr<Mapping2d> mapping,
+                          std::string const &filename,
+                          ImageWrap wrap = ImageWrap::Wrap,
+                          ImageFilter filter = ImageFilter::EWA,
+                          TextureCache::TileCache &cache = TextureCache::TileCache::global())
+            : mapping(mapping), filter(filter), image(filename, wrap, cache)
+        {
+        }
+
+        T operator() (DifferentialGeometry const &dg) const noexcept;
+
+        ProgramBuilder::Value compile(ProgramBuilder &b) const {
+            return b.rgb(this, &TiledImageTexture::lookupRGB, std::is_same<T,real>::value);
+        }
+
+    private:
+        shared_ptr<Mapping2d> mapping;
+        ImageFilter filter;
+        TextureCache::TiledImage image;
+
+        Photometry::RGB lookup(DifferentialGeometry const &dg) const noexcept {
+            const auto c = (*mapping)(dg);
+            return image.filtered(c.s, c.t, c.dsdx, c.dtdx, c.dsdy, c.dtdy, filter);
+        }
+
+        static Photometry::RGB lookupRGB(void const *self, DifferentialGeometry const &dg) {
+            return static_cast<TiledImageTexture const*>(self)->lookup(dg);
+        }
+    };
+
+
+    template <>
+    inline
+    real TiledImageTexture<real>::operator() (DifferentialGeometry const &dg) const noexcept {
+        return Spectrum::FromRGB(400,800,8, lookup(dg)).toY(); // TODO: optimize
+    }
+
+    template <>
+    inline
+    Spectrum TiledImageTexture<Spectrum>::operator() (DifferentialGeometry const &dg) const noexcept {
+        return Spectrum::FromRGB(400,800,8, lookup(dg));
+    }
+
+    using ColorTiledImageTexture = TiledImageTexture<Spectrum>;
+
+} } }
+
+#endif // TILEDIMAGETEXTURE_HH_INCLUDED_20130902
@@ -16,7 +16,9 @@ namespace excyrender { namespace Photometry { namespace Texture {
 
         TexCoords2d operator() (DifferentialGeometry const &dg) const noexcept {
             return {scale_u * dg.u + offset_u,
-                    scale_v * dg.v + offset_v};
+                    scale_v * dg.v + offset_v,
+                    scale_u * dg.dudx, scale_v * dg.dvdx,
+                    scale_u * dg.dudy, scale_v * dg.dvdy};
         }
 
     private:
@@ -4,7 +4,6 @@
 #include "detail/BIH/RecursiveTraverser.hh"
 #include "detail/BIH/Builder.hh"
 #include "BoundingIntervalHierarchy.hh"
-#include "DebugPixel.hh"
 
 using namespace excyrender::Geometry;
 
@@ -22,11 +21,7 @@ inline AABB aabb (std::shared_ptr<FinitePrimitive> const &fp) {
 
 
 optional<Intersection> BoundingIntervalHierarchy::intersect(Ray const &ray) const noexcept {
-    int steps = 0;
-    auto ret = detail::BIH::recursive_intersect(data_, ray, steps);
-    if (current_debug)
-        current_debug->traversal0 += steps;
-    return ret;
+    return detail::BIH::recursive_intersect(data_, ray);
 }
 
 bool BoundingIntervalHierarchy::occludes(Point const &a, Point const &b) const noexcept {
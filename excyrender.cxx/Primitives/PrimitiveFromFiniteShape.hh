@@ -14,7 +14,7 @@ class PrimitiveFromFiniteShape final : public FinitePrimitive
 public:
     PrimitiveFromFiniteShape() = delete;
     PrimitiveFromFiniteShape(std::shared_ptr<const Shapes::FiniteShape> shape,
-                             std::shared_ptr<const Photometry::Material::Material> const &material) :
+                             Photometry::Material::Material const *material) :
         shape(shape),
         material(material)
     {
@@ -45,7 +45,7 @@ public:
 
 private:
     std::shared_ptr<const Shapes::FiniteShape> shape;
-    std::shared_ptr<const Photometry::Material::Material> material;
+    Photometry::Material::Material const *material;
 };
 
 } }
@@ -15,7 +15,7 @@ class PrimitiveFromShape final : public Primitive
 public:
     PrimitiveFromShape() = delete;
     PrimitiveFromShape(std::shared_ptr<const Shapes::Shape> shape,
-                       std::shared_ptr<const Photometry::Material::Material> material) :
+                       Photometry::Material::Material const *material) :
         shape(shape),
         material(material)
     {
@@ -40,7 +40,7 @@ public:
     }
 private:
     std::shared_ptr<const Shapes::Shape> shape;
-    std::shared_ptr<const Photometry::Material::Material> material;
+    Photometry::Material::Material const *material;
 };
 
 } }
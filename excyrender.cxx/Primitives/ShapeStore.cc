@@ -0,0 +1,138 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "detail/BIH/RecursiveTraverser.hh"
+#include "detail/BIH/Builder.hh"
+#include "ShapeStore.hh"
+#include <stdexcept>
+
+using namespace excyrender::Geometry;
+
+namespace excyrender { namespace Primitives {
+
+constexpr std::uint32_t ShapeStore::triangleBit;
+
+
+AABB ShapeStore::References::aabb(std::uint32_t shape) const noexcept {
+    if (shape & triangleBit)
+        return store->triangles_[shape & ~triangleBit].aabb();
+    return store->spheres_[shape].aabb();
+}
+
+optional<ShapeStore::Hit> ShapeStore::References::intersect(std::uint32_t shape, Ray const &ray) const noexcept {
+    const real t = shape & triangleBit ? store->triangles_[shape & ~triangleBit].nearest(ray)
+                                       : store->spheres_[shape].nearest(ray);
+    if (t < 0)
+        return optional<Hit>();
+    return Hit{t, shape};
+}
+
+
+
+optional<ShapeStore::IdIntersection> ShapeStore::intersectWithId(Ray const &ray) const noexcept {
+    const auto hit = detail::BIH::recursive_intersect(bih_, references_(), ray);
+    if (!hit)
+        return optional<IdIntersection>();
+
+    // Intersecting once more gives the same distance, as it is the same computation.
+    const std::uint32_t i = hit->shape & ~triangleBit;
+    if (hit->shape & triangleBit) {
+        if (const auto dg = triangles_[i].intersect(ray))
+            return IdIntersection{*dg, triangleMaterials_[i]};
+    } else {
+        if (const auto dg = spheres_[i].intersect(ray))
+            return IdIntersection{*dg, sphereMaterials_[i]};
+    }
+    return optional<IdIntersection>();
+}
+
+optional<Intersection> ShapeStore::intersect(Ray const &ray) const noexcept {
+    const auto i = intersectWithId(ray);
+    if (!i)
+        return optional<Intersection>();
+    return Intersection{i->dg, materials_[i->material]};
+}
+
+bool ShapeStore::occludes(Point const &a, Point const &b) const noexcept {
+    return detail::BIH::recursive_occludes(bih_, references_(), a, b);
+}
+
+bool ShapeStore::occludes(Point const &a, Direction const &b) const noexcept {
+    return detail::BIH::recursive_occludes(bih_, references_(), a, b);
+}
+
+AABB ShapeStore::aabb() const noexcept {
+    return bih_.aabb;
+}
+
+
+
+ShapeStoreBuilder::ShapeStoreBuilder()
+    : store_(new ShapeStore)
+{
+}
+
+ShapeStore::MaterialId ShapeStoreBuilder::material(Photometry::Material::Material const *material) {
+    check("material()");
+    if (!material)
+        throw std::logic_error("ShapeStoreBuilder: called 'material()' with null");
+    const auto it = ids_.find(material);
+    if (it != ids_.end())
+        return it->second;
+    if (store_->materials_.size() > 0xFFFF)
+        throw std::logic_error("ShapeStoreBuilder: more than 65536 materials");
+    const ShapeStore::MaterialId id = store_->materials_.size();
+    store_->materials_.push_back(material);
+    ids_[material] = id;
+    return id;
+}
+
+void ShapeStoreBuilder::add (Shapes::Sphere const &sphere, ShapeStore::MaterialId material) {
+    check("add(Sphere)", material);
+    if (store_->spheres_.size() >= ShapeStore::triangleBit)
+        throw std::logic_error("ShapeStoreBuilder: too many spheres");
+    store_->spheres_.push_back(sphere);
+    store_->sphereMaterials_.push_back(material);
+}
+
+void ShapeStoreBuilder::add (Shapes::Triangle const &triangle, ShapeStore::MaterialId material) {
+    check("add(Triangle)", material);
+    if (store_->triangles_.size() >= ShapeStore::triangleBit)
+        throw std::logic_error("ShapeStoreBuilder: too many triangles");
+    store_->triangles_.push_back(triangle);
+    store_->triangleMaterials_.push_back(material);
+}
+
+std::shared_ptr<ShapeStore> ShapeStoreBuilder::finalize(int max_rec) {
+    check("finalize()");
+    if (store_->spheres_.empty() && store_->triangles_.empty())
+        throw std::logic_error("ShapeStoreBuilder: called 'finalize()' without shapes");
+    finalized = true;
+
+    ShapeStore &s = *store_;
+    s.bih_.objects.reserve(s.spheres_.size() + s.triangles_.size());
+    for (std::uint32_t i=0; i!=s.spheres_.size(); ++i)
+        s.bih_.objects.push_back(i);
+    for (std::uint32_t i=0; i!=s.triangles_.size(); ++i)
+        s.bih_.objects.push_back(i | ShapeStore::triangleBit);
+    detail::BIH::build(s.bih_, max_rec, s.references_());
+
+    std::shared_ptr<ShapeStore> ret;
+    ret.swap(store_);
+    return ret;
+}
+
+void ShapeStoreBuilder::check(char const *what) const {
+    if (finalized)
+        throw std::logic_error(std::string("ShapeStoreBuilder: called '") + what + "' "
+                               "but builder is finalized already");
+}
+
+void ShapeStoreBuilder::check(char const *what, ShapeStore::MaterialId material) const {
+    check(what);
+    if (material >= store_->materials_.size())
+        throw std::logic_error(std::string("ShapeStoreBuilder: called '") + what + "' "
+                               "with an id not returned by 'material()'");
+}
+
+} }
@@ -0,0 +1,121 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SHAPESTORE_HH_INCLUDED_20130909
+#define SHAPESTORE_HH_INCLUDED_20130909
+
+#include "Primitives/FinitePrimitive.hh"
+#include "Shapes/Sphere.hh"
+#include "Shapes/Triangle.hh"
+#include "detail/BIH/Data.hh"
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace excyrender { namespace Primitives {
+
+    // Many small shapes, and their materials, without an object per shape: spheres and
+    // triangles are kept by value in one array per type, next to an array of 16 bit
+    // material ids, and a BIH indexes into those. Where a BIH over
+    // PrimitiveFromFiniteShapes follows a primitive, a shape and a material pointer per
+    // object it tests, this reads one shape.
+    //
+    // Tests only yield the distance; the Intersection is made once, for the nearest hit.
+    //
+    // Large shapes with an acceleration structure of their own, like Terrain2d and
+    // TriangleMesh, are better off as primitives next to the store.
+    class ShapeStore final : public FinitePrimitive {
+    public:
+        typedef std::uint16_t MaterialId;
+
+        ShapeStore(ShapeStore const &)            = delete;
+        ShapeStore& operator=(ShapeStore const &) = delete;
+
+        optional<Intersection> intersect(Geometry::Ray const &) const noexcept;
+        bool occludes(Geometry::Point const &a, Geometry::Point const &b) const noexcept;
+        bool occludes(Geometry::Point const &a, Geometry::Direction const &b) const noexcept;
+        AABB aabb() const noexcept;
+
+        std::size_t spheres() const noexcept { return spheres_.size(); }
+        std::size_t triangles() const noexcept { return triangles_.size(); }
+
+        // As intersect(), but with the id of the material instead of the material, for
+        // dispatching on ids (see SurfaceIntegrators::ClosedWorld).
+        struct IdIntersection {
+            DifferentialGeometry dg;
+            MaterialId material;
+        };
+        optional<IdIntersection> intersectWithId(Geometry::Ray const &) const noexcept;
+
+        // The materials, indexed by MaterialId.
+        std::vector<Photometry::Material::Material const*> const& materials() const noexcept {
+            return materials_;
+        }
+
+        // Nearest hit so far: its distance, and a reference to what was hit.
+        struct Hit {
+            real t;
+            std::uint32_t shape;
+
+            friend real distance(Hit const &hit) noexcept {
+                return hit.t;
+            }
+        };
+
+    private:
+        friend class ShapeStoreBuilder;
+
+        // Shape references, as the BIH holds them: the index into spheres_, or, with
+        // triangleBit set, into triangles_.
+        static constexpr std::uint32_t triangleBit = std::uint32_t(1) << 31;
+
+        // How the BIH gets at shapes by reference.
+        struct References {
+            ShapeStore const *store;
+            AABB aabb(std::uint32_t shape) const noexcept;
+            optional<Hit> intersect(std::uint32_t shape, Geometry::Ray const &ray) const noexcept;
+        };
+
+        ShapeStore() = default;
+        References references_() const noexcept { return References{this}; }
+
+        std::vector<Shapes::Sphere> spheres_;
+        std::vector<MaterialId> sphereMaterials_;
+        std::vector<Shapes::Triangle> triangles_;
+        std::vector<MaterialId> triangleMaterials_;
+        std::vector<Photometry::Material::Material const*> materials_;
+        detail::BIH::Data<std::uint32_t> bih_;
+    };
+
+} }
+
+
+namespace excyrender { namespace Primitives {
+
+    class ShapeStoreBuilder {
+    public:
+        ShapeStoreBuilder();
+        ShapeStoreBuilder(ShapeStoreBuilder const &)            = delete;
+        ShapeStoreBuilder& operator=(ShapeStoreBuilder const &) = delete;
+
+        // The id of 'material', as returned by Scene::add(), which must outlive the store.
+        // Throws std::logic_error beyond 65536 different materials.
+        ShapeStore::MaterialId material(Photometry::Material::Material const *material);
+
+        void add (Shapes::Sphere const &sphere, ShapeStore::MaterialId material);
+        void add (Shapes::Triangle const &triangle, ShapeStore::MaterialId material);
+        std::shared_ptr<ShapeStore> finalize(int max_rec);
+
+    private:
+        void check(char const *what) const;
+        void check(char const *what, ShapeStore::MaterialId material) const;
+
+        bool finalized = false;
+        std::shared_ptr<ShapeStore> store_;
+        std::unordered_map<Photometry::Material::Material const*, ShapeStore::MaterialId> ids_;
+    };
+
+} }
+
+#endif // SHAPESTORE_HH_INCLUDED_20130909
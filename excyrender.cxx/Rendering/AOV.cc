@@ -0,0 +1,57 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "AOV.hh"
+#include "ImageFormat/TileWriter.hh"
+#include <functional>
+
+namespace excyrender { namespace Rendering {
+
+std::string aovFilename(std::string const &output, std::string const &name) {
+    const auto dot = output.rfind('.');
+    const auto slash = output.rfind('/');
+    if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+        return output + "." + name + ".pfm";
+    const std::string stem = output.substr(0, dot),
+                      extension = output.substr(dot);
+    return stem + "." + name + (extension == ".exr" ? extension : ".pfm");
+}
+
+
+namespace {
+    void write(std::string const &filename, int width, int height, std::vector<Photometry::RGB> const &pixels) {
+        ImageFormat::write(*ImageFormat::tileWriter(filename, width, height, 32), pixels);
+    }
+
+    void writeHeatmap(std::string const &filename, Statistics::Frame const &frame,
+                      std::function<real (Statistics::Counters const &)> value)
+    {
+        std::vector<Photometry::RGB> pixels;
+        pixels.reserve(frame.pixels.size());
+        for (auto const &c : frame.pixels) {
+            const real v = value(c);
+            pixels.emplace_back(v, v, v);
+        }
+        write(filename, frame.width, frame.height, pixels);
+    }
+}
+
+
+void writeAovs(std::string const &output, int width, int height, GeometryAovs const &geometry,
+               Statistics::Frame const *statistics, int samplesPerPixel)
+{
+    write(aovFilename(output, "depth"), width, height, geometry.depth);
+    write(aovFilename(output, "normal"), width, height, geometry.normal);
+    if (!statistics)
+        return;
+
+    const real perSample = real(1) / samplesPerPixel;
+    writeHeatmap(aovFilename(output, "nodes"), *statistics,
+                 [=](Statistics::Counters const &c) { return c.nodes * perSample; });
+    writeHeatmap(aovFilename(output, "tests"), *statistics,
+                 [=](Statistics::Counters const &c) { return c.tests * perSample; });
+    writeHeatmap(aovFilename(output, "time"), *statistics,
+                 [](Statistics::Counters const &c) { return real(c.seconds * 1000); });
+}
+
+} }
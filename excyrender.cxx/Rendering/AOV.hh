@@ -0,0 +1,61 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef AOV_HH_INCLUDED_20130911
+#define AOV_HH_INCLUDED_20130911
+
+#include "real.hh"
+#include "Statistics.hh"
+#include "Photometry/RGB.hh"
+#include "Primitives/Primitive.hh"
+
+#include <string>
+#include <vector>
+
+// Images besides the rendered one ("arbitrary output variables"), to see where a scene is
+// expensive or broken.
+namespace excyrender { namespace Rendering {
+
+    // Of the first hit through the center of each pixel: the distance (in all three
+    // channels; 0 where nothing is hit), and the shading normal (x,y,z as r,g,b).
+    struct GeometryAovs {
+        std::vector<Photometry::RGB> depth, normal;
+    };
+
+    // 'camera' is as for render_tiles(). Not counted in Statistics.
+    template <typename Camera>
+    GeometryAovs geometryAovs(int width, int height, Camera const &camera,
+                              Primitives::Primitive const &primitive)
+    {
+        GeometryAovs ret;
+        ret.depth.resize(width*height);
+        ret.normal.resize(width*height);
+        #pragma omp parallel for schedule(dynamic, 16)
+        for (int p=0; p<width*height; ++p) {
+            Statistics::current = nullptr;
+            if (const auto i = primitive.intersect(camera(p % width + real(0.5), p / width + real(0.5)))) {
+                ret.depth[p] = Photometry::RGB(i->dg.d, i->dg.d, i->dg.d);
+                ret.normal[p] = Photometry::RGB(i->dg.nn.x(), i->dg.nn.y(), i->dg.nn.z());
+            }
+        }
+        return ret;
+    }
+
+    // Where the AOV 'name' of the image 'output' goes: "out.exr" gives "out.name.exr".
+    // Images in formats without floats (PPM) get a ".pfm" instead.
+    std::string aovFilename(std::string const &output, std::string const &name);
+
+    // Writes the AOVs of the image 'output' next to it (see aovFilename()):
+    //
+    //     depth, normal   as in GeometryAovs
+    //     nodes           BIH nodes visited, per sample
+    //     tests           intersection tests, per sample
+    //     time            milliseconds spent on the pixel
+    //
+    // The last three are heatmaps, one value in all channels, from 'statistics'; they
+    // are left out if it is null. Throws std::runtime_error on I/O errors.
+    void writeAovs(std::string const &output, int width, int height, GeometryAovs const &geometry,
+                   Statistics::Frame const *statistics, int samplesPerPixel);
+} }
+
+#endif // AOV_HH_INCLUDED_20130911
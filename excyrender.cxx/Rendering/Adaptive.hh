@@ -0,0 +1,205 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef ADAPTIVE_HH_INCLUDED_20130827
+#define ADAPTIVE_HH_INCLUDED_20130827
+
+#include "real.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include "Geometry/Ray.hh"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+#include <stdexcept>
+#include <tuple>
+#include <vector>
+#include <omp.h>
+
+namespace excyrender { namespace Rendering {
+
+    // Running mean of a pixel in CIE XYZ, and the variance of its luminance (Welford).
+    struct PixelEstimate {
+        real X = 0, Y = 0, Z = 0;
+        real m2 = 0;
+        std::uint32_t samples = 0;
+
+        void add(std::tuple<real,real,real> const &xyz) noexcept {
+            ++samples;
+            const real inv = real(1) / samples,
+                       dY  = std::get<1>(xyz) - Y;
+            X += (std::get<0>(xyz) - X) * inv;
+            Y += dY * inv;
+            Z += (std::get<2>(xyz) - Z) * inv;
+            m2 += dY * (std::get<1>(xyz) - Y);
+        }
+
+        real variance() const noexcept {
+            return samples > 1 ? m2 / (samples-1) : 0;
+        }
+
+        // Standard error of the mean luminance, relative to the luminance. Below 'floor',
+        // it is relative to 'floor' instead, so that near-black pixels do not ask for
+        // arbitrarily many samples. With fewer than 2 samples there is no estimate, which
+        // is reported as the largest real: -ffast-math assumes there are no infinities.
+        real relativeError(real floor) const noexcept {
+            if (samples < 2)
+                return std::numeric_limits<real>::max();
+            const real mean = Y <= floor ? floor : Y;
+            return std::sqrt(variance() / samples) / mean;
+        }
+    };
+
+
+    struct AdaptivePolicy {
+        int  minSamples     = 16;    // per pixel, before its error estimate is trusted
+        int  maxSamples     = 1024;  // per pixel
+        int  samplesPerPass = 8;     // added per pass to each pixel not yet converged
+        real targetError    = 0.02;  // see PixelEstimate::relativeError()
+        real darkFloor      = 0.01;
+        double timeBudget   = 0;     // seconds; 0 means unlimited
+    };
+
+    inline void validate(AdaptivePolicy const &policy) {
+        if (policy.minSamples < 2)
+            throw std::logic_error("AdaptivePolicy::minSamples must be 2 or greater");
+        if (policy.maxSamples < policy.minSamples)
+            throw std::logic_error("AdaptivePolicy::maxSamples must not be less than minSamples");
+        if (policy.samplesPerPass < 1)
+            throw std::logic_error("AdaptivePolicy::samplesPerPass must be positive");
+        if (policy.targetError < 0 || policy.darkFloor <= 0)
+            throw std::logic_error("AdaptivePolicy::targetError must not be negative, darkFloor must be positive");
+        if (policy.timeBudget < 0)
+            throw std::logic_error("AdaptivePolicy::timeBudget must not be negative");
+    }
+
+
+    struct AdaptiveReport {
+        int passes = 0;
+        std::uint64_t samples = 0;
+        std::uint32_t converged = 0;   // pixels at or below the target error
+        double seconds = 0;
+        bool outOfTime = false;
+    };
+
+
+    // Renders 'width' x 'height' pixels into 'pixels'. 'camera(x,y)' returns the primary
+    // ray through the continuous raster position (x,y); 'integrate' is called as
+    // integrate(Ray, Sampling::Sampler&, MemoryArena&).
+    //
+    // Rendering is done in passes. A pass adds samples to each pixel that has fewer than
+    // minSamples, or whose error, or that of a direct neighbour, is above targetError
+    // (neighbours are looked at so that a lucky low-variance estimate next to a noisy
+    // region does not stop too early). It ends when no pixel is left, or the time budget
+    // is used up.
+    //
+    // With a time budget, the samples of a pass are scaled down to what the measured
+    // time per sample says still fits; a pass that overruns nonetheless is cut short
+    // pixel by pixel, so completion is late by at most one pixel's worth of samples.
+    // The first pass, one sample per pixel, is exempt: no pixel is left without a
+    // sample, even if that pass alone exceeds the budget.
+    template <typename Camera, typename Integrator>
+    AdaptiveReport render_adaptive(int width, int height, AdaptivePolicy const &policy,
+                                   Sampling::Sequence sequence,
+                                   Camera const &camera, Integrator const &integrate,
+                                   std::vector<PixelEstimate> &pixels)
+    {
+        validate(policy);
+
+        const double start    = omp_get_wtime(),
+                     deadline = start + policy.timeBudget;
+        const bool   timed    = policy.timeBudget > 0;
+
+        pixels.assign(width*height, PixelEstimate());
+        std::vector<real> error(width*height);
+        std::vector<int> active;
+        active.reserve(width*height);
+
+        std::vector<MemoryArena> arenas(omp_get_max_threads());
+
+        AdaptiveReport report;
+        double secondsPerSample = 0;
+
+        for (;;) {
+            // Select the pixels of this pass.
+            for (int i=0, s=width*height; i!=s; ++i)
+                error[i] = pixels[i].relativeError(policy.darkFloor);
+            active.clear();
+            for (int y=0; y!=height; ++y) {
+                for (int x=0; x!=width; ++x) {
+                    PixelEstimate const &p = pixels[y*width+x];
+                    real e = error[y*width+x];
+                    for (int v=std::max(0,y-1), ve=std::min(height,y+2); v!=ve; ++v)
+                        for (int u=std::max(0,x-1), ue=std::min(width,x+2); u!=ue; ++u)
+                            e = std::max(e, error[v*width+u]);
+                    if (p.samples < std::uint32_t(policy.minSamples)
+                        || (p.samples < std::uint32_t(policy.maxSamples) && e > policy.targetError))
+                        active.push_back(y*width+x);
+                }
+            }
+            if (active.empty())
+                break;
+
+            // The first pass is a single sample, to measure the time per sample.
+            const bool first = report.passes == 0;
+            int samples = first ? 1 : policy.samplesPerPass;
+            const double now = omp_get_wtime();
+            if (timed && !first) {
+                if (now >= deadline) {
+                    report.outOfTime = true;
+                    break;
+                }
+                if (secondsPerSample > 0) {
+                    const double fit = (deadline - now) / (secondsPerSample * active.size());
+                    samples = static_cast<int>(std::max(1.0, std::min<double>(samples, fit)));
+                }
+            }
+
+            std::uint64_t passSamples = 0;
+            bool cut = false;
+            #pragma omp parallel for schedule(dynamic, 16) reduction(+:passSamples)
+            for (int a=0; a<int(active.size()); ++a) {
+                if (timed && !first && omp_get_wtime() >= deadline) {
+                    #pragma omp atomic write
+                    cut = true;
+                    continue;
+                }
+                const int i = active[a], x = i % width, y = i / width;
+                PixelEstimate &p = pixels[i];
+                MemoryArena &arena = arenas[omp_get_thread_num()];
+
+                Sampling::Sampler sampler(x, y, p.samples, sequence);
+                const std::uint32_t n = std::min<std::uint32_t>(samples, policy.maxSamples - p.samples);
+                for (std::uint32_t j=0; j!=n; ++j) {
+                    sampler.startSample(p.samples);
+                    const real sx = x + sampler() - real(0.5),
+                               sy = y + sampler() - real(0.5);
+                    p.add(integrate(camera(sx, sy), sampler, arena).toXYZ());
+                    arena.reset();
+                }
+                passSamples += n;
+            }
+
+            report.samples += passSamples;
+            ++report.passes;
+            const double elapsed = omp_get_wtime() - now;
+            if (passSamples)
+                secondsPerSample = elapsed / passSamples;
+            if (cut) {
+                report.outOfTime = true;
+                break;
+            }
+        }
+
+        for (auto const &p : pixels)
+            if (p.relativeError(policy.darkFloor) <= policy.targetError)
+                ++report.converged;
+        report.seconds = omp_get_wtime() - start;
+        return report;
+    }
+
+} }
+
+#endif // ADAPTIVE_HH_INCLUDED_20130827
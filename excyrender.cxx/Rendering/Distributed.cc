@@ -0,0 +1,385 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "Rendering/Distributed.hh"
+
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <iostream>
+#include <stdexcept>
+#include <thread>
+#include <chrono>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <omp.h>
+
+namespace excyrender { namespace Rendering { namespace Distributed {
+
+namespace {
+    // Messages are a type and a payload length (both uint32, native byte order, as both
+    // ends are on the same machine), then the payload:
+    //
+    //   Hello  worker -> coordinator  uint64 scene hash, uint32 pid
+    //   Reject coordinator -> worker  -
+    //   Work   coordinator -> worker  uint32 id, int32 x0 y0 x1 y1, uint32 spp, uint64 scene hash
+    //   Result worker -> coordinator  uint32 id, float xyz[3*pixels]
+    //   Done   coordinator -> worker  -
+    enum MessageType : std::uint32_t { Hello = 1, Reject, Work, Result, Done };
+
+    const std::uint32_t max_payload = 64*1024*1024;
+
+    std::runtime_error error(std::string const &what) {
+        return std::runtime_error(what + ": " + std::strerror(errno));
+    }
+
+    class Socket final {
+    public:
+        explicit Socket(int fd = -1) noexcept : fd_(fd) {}
+        Socket(Socket &&rhs) noexcept : fd_(rhs.fd_) { rhs.fd_ = -1; }
+        Socket& operator= (Socket &&rhs) noexcept { std::swap(fd_, rhs.fd_); return *this; }
+        Socket(Socket const &) = delete;
+        Socket& operator= (Socket const &) = delete;
+        ~Socket() { if (fd_ >= 0) ::close(fd_); }
+
+        int fd() const noexcept { return fd_; }
+
+    private:
+        int fd_;
+    };
+
+    sockaddr_un address(std::string const &path) {
+        sockaddr_un ret;
+        std::memset(&ret, 0, sizeof ret);
+        ret.sun_family = AF_UNIX;
+        if (path.size() >= sizeof ret.sun_path)
+            throw std::runtime_error("socket path '" + path + "' is too long");
+        std::strcpy(ret.sun_path, path.c_str());
+        return ret;
+    }
+
+    bool sendAll(int fd, void const *data, std::size_t size) noexcept {
+        char const *p = static_cast<char const*>(data);
+        while (size) {
+            const ssize_t n = ::send(fd, p, size, MSG_NOSIGNAL);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool receiveAll(int fd, void *data, std::size_t size) noexcept {
+        char *p = static_cast<char*>(data);
+        while (size) {
+            const ssize_t n = ::recv(fd, p, size, 0);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            size -= n;
+        }
+        return true;
+    }
+
+    bool send(int fd, MessageType type, std::vector<char> const &payload) noexcept {
+        const std::uint32_t header[2] = { type, std::uint32_t(payload.size()) };
+        return sendAll(fd, header, sizeof header)
+            && sendAll(fd, payload.data(), payload.size());
+    }
+
+    bool receive(int fd, MessageType &type, std::vector<char> &payload) {
+        std::uint32_t header[2];
+        if (!receiveAll(fd, header, sizeof header) || header[1] > max_payload)
+            return false;
+        type = static_cast<MessageType>(header[0]);
+        payload.resize(header[1]);
+        return receiveAll(fd, payload.data(), payload.size());
+    }
+
+    // Appends whatever has arrived on 'fd' to 'inbox', without waiting for more. Returns
+    // false if the peer is gone.
+    bool receiveAvailable(int fd, std::vector<char> &inbox) {
+        for (;;) {
+            const std::size_t offset = inbox.size();
+            inbox.resize(offset + 64*1024);
+            const ssize_t n = ::recv(fd, &inbox[offset], 64*1024, MSG_DONTWAIT);
+            inbox.resize(offset + (n > 0 ? n : 0));
+            if (n > 0)
+                continue;
+            if (n < 0 && errno == EINTR)
+                continue;
+            return n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK);
+        }
+    }
+
+    // Takes the first message off 'inbox' if it is complete. Throws std::runtime_error if
+    // it is too long.
+    bool takeMessage(std::vector<char> &inbox, MessageType &type, std::vector<char> &payload) {
+        std::uint32_t header[2];
+        if (inbox.size() < sizeof header)
+            return false;
+        std::memcpy(header, inbox.data(), sizeof header);
+        if (header[1] > max_payload)
+            throw std::runtime_error("malformed message");
+        if (inbox.size() < sizeof header + header[1])
+            return false;
+        type = static_cast<MessageType>(header[0]);
+        payload.assign(inbox.begin() + sizeof header, inbox.begin() + sizeof header + header[1]);
+        inbox.erase(inbox.begin(), inbox.begin() + sizeof header + header[1]);
+        return true;
+    }
+
+    // Not vector::insert(), which GCC warns about (-Wnonnull) when 'payload' is empty.
+    void append(std::vector<char> &payload, void const *data, std::size_t size) {
+        if (size == 0)
+            return;
+        const std::size_t offset = payload.size();
+        payload.resize(offset + size);
+        std::memcpy(&payload[offset], data, size);
+    }
+
+    template <typename T>
+    void put(std::vector<char> &payload, T const &v) {
+        append(payload, &v, sizeof v);
+    }
+
+    template <typename T>
+    T get(std::vector<char> const &payload, std::size_t &offset) {
+        T ret;
+        if (offset + sizeof ret > payload.size())
+            throw std::runtime_error("malformed message");
+        std::memcpy(&ret, &payload[offset], sizeof ret);
+        offset += sizeof ret;
+        return ret;
+    }
+
+
+    struct Worker {
+        Socket socket;
+        std::vector<char> inbox;   // received, but not yet a complete message
+        bool ready = false;
+        int job = -1;
+        double since = 0;
+        std::uint32_t pid = 0;
+    };
+}
+
+
+std::vector<float> coordinate(std::string const &path, int width, int height,
+                              std::uint64_t sceneHash, CoordinatorPolicy const &policy)
+{
+    if (policy.samplesPerPixel < 1)
+        throw std::logic_error("CoordinatorPolicy::samplesPerPixel must be positive");
+
+    const std::vector<Tile> jobs = tiles(width, height, policy.tileSize, TileOrder::Hilbert);
+    std::vector<char> finished(jobs.size(), 0), reissued(jobs.size(), 0);
+    std::deque<int> pending;
+    for (int i=0, s=jobs.size(); i!=s; ++i)
+        pending.push_back(i);
+    int remaining = jobs.size();
+
+    std::vector<float> image(width*height*3, 0);
+
+    Socket listener(::socket(AF_UNIX, SOCK_STREAM, 0));
+    if (listener.fd() < 0)
+        throw error("coordinate: socket()");
+    const sockaddr_un addr = address(path);
+    ::unlink(path.c_str());
+    if (::bind(listener.fd(), reinterpret_cast<sockaddr const*>(&addr), sizeof addr) != 0)
+        throw error("coordinate: cannot bind to '" + path + "'");
+    if (::listen(listener.fd(), 64) != 0)
+        throw error("coordinate: listen()");
+    std::clog << "coordinator: waiting for workers on '" << path << "'" << std::endl;
+
+    std::deque<Worker> workers;
+
+    auto const drop = [&](Worker &w, char const *why) {
+        std::clog << "coordinator: dropping worker " << w.pid << " (" << why << ")" << std::endl;
+        if (w.job >= 0 && !finished[w.job])
+            pending.push_front(w.job);
+        w = Worker();
+    };
+
+    // Throws std::runtime_error for anything that the worker is dropped for.
+    auto const handle = [&](Worker &w, MessageType type, std::vector<char> const &payload) {
+        std::size_t offset = 0;
+        if (type == Hello && !w.ready) {   // once: pid and hash are not to change later
+            const auto hash = get<std::uint64_t>(payload, offset);
+            w.pid = get<std::uint32_t>(payload, offset);
+            if (hash != sceneHash) {
+                send(w.socket.fd(), Reject, {});
+                throw std::runtime_error("different scene");
+            }
+            w.ready = true;
+            std::clog << "coordinator: worker " << w.pid << " joined" << std::endl;
+        } else if (type == Result && w.ready && w.job >= 0) {
+            const auto id = get<std::uint32_t>(payload, offset);
+            if (id != std::uint32_t(w.job))
+                throw std::runtime_error("result for a tile not assigned to it");
+            Tile const &t = jobs.at(id);
+            if (payload.size() != offset + std::size_t(t.width()*t.height()) * 3 * sizeof(float))
+                throw std::runtime_error("malformed message");
+            if (!finished[id]) {
+                float const *xyz = reinterpret_cast<float const*>(&payload[offset]);
+                for (int y=t.y0; y!=t.y1; ++y)
+                    std::memcpy(&image[(y*width + t.x0) * 3],
+                                &xyz[(y - t.y0) * t.width() * 3],
+                                t.width() * 3 * sizeof(float));
+                finished[id] = 1;
+                --remaining;
+                std::clog << "coordinator: " << jobs.size()-remaining << '/' << jobs.size()
+                          << " tiles" << std::endl;
+            }
+            w.job = -1;
+        } else {
+            throw std::runtime_error("unexpected message");
+        }
+    };
+
+    std::vector<pollfd> fds;
+    std::vector<char> payload;
+    while (remaining) {
+        fds.clear();
+        fds.push_back(pollfd{listener.fd(), POLLIN, 0});
+        for (auto const &w : workers)
+            fds.push_back(pollfd{w.socket.fd(), short(w.socket.fd() >= 0 ? POLLIN : 0), 0});
+        if (::poll(fds.data(), fds.size(), 1000) < 0 && errno != EINTR)
+            throw error("coordinate: poll()");
+
+        if (fds[0].revents & POLLIN) {
+            Worker w;
+            w.socket = Socket(::accept(listener.fd(), nullptr, nullptr));
+            if (w.socket.fd() >= 0) {
+                // Nor must a worker that stops reading; our messages to it are small.
+                timeval timeout = {30, 0};
+                ::setsockopt(w.socket.fd(), SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof timeout);
+                workers.push_back(std::move(w));
+            }
+        }
+
+        for (std::size_t i=1; i<fds.size(); ++i) {
+            Worker &w = workers[i-1];
+            if (w.socket.fd() < 0 || !(fds[i].revents & (POLLIN | POLLHUP | POLLERR)))
+                continue;
+            // Only what has arrived, so that a worker in the middle of sending a large
+            // result, or one that stalled, does not hold up the others.
+            const bool connected = receiveAvailable(w.socket.fd(), w.inbox);
+            try {
+                MessageType type;
+                while (takeMessage(w.inbox, type, payload))
+                    handle(w, type, payload);
+            } catch (std::exception &e) {
+                drop(w, e.what());
+                continue;
+            }
+            if (!connected)
+                drop(w, "disconnected");
+        }
+
+        const double now = omp_get_wtime();
+        for (auto &w : workers) {
+            if (w.job >= 0 && !finished[w.job] && !reissued[w.job] && now - w.since > policy.slowTile) {
+                reissued[w.job] = 1;
+                pending.push_front(w.job);
+            }
+        }
+
+        for (auto &w : workers) {
+            if (!w.ready || w.job >= 0)
+                continue;
+            while (!pending.empty() && finished[pending.front()])
+                pending.pop_front();
+            if (pending.empty())
+                break;
+            const int id = pending.front();
+            pending.pop_front();
+
+            Tile const &t = jobs[id];
+            std::vector<char> job;
+            put(job, std::uint32_t(id));
+            put(job, std::int32_t(t.x0)); put(job, std::int32_t(t.y0));
+            put(job, std::int32_t(t.x1)); put(job, std::int32_t(t.y1));
+            put(job, std::uint32_t(policy.samplesPerPixel));
+            put(job, sceneHash);
+            w.job = id;
+            w.since = now;
+            if (!send(w.socket.fd(), Work, job))
+                drop(w, "disconnected");
+        }
+
+        while (!workers.empty() && workers.front().socket.fd() < 0)
+            workers.pop_front();
+    }
+
+    for (auto &w : workers) {
+        if (w.socket.fd() >= 0)
+            send(w.socket.fd(), Done, {});
+    }
+    ::unlink(path.c_str());
+    return image;
+}
+
+
+void work(std::string const &path, std::uint64_t sceneHash,
+          std::function<void(Job const &, std::vector<float> &)> const &render)
+{
+    const sockaddr_un addr = address(path);
+    Socket s;
+    for (int attempt=0; ; ++attempt) {
+        s = Socket(::socket(AF_UNIX, SOCK_STREAM, 0));
+        if (s.fd() < 0)
+            throw error("work: socket()");
+        if (::connect(s.fd(), reinterpret_cast<sockaddr const*>(&addr), sizeof addr) == 0)
+            break;
+        if (attempt == 50)
+            throw error("work: cannot connect to '" + path + "'");
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    }
+
+    std::vector<char> payload;
+    put(payload, sceneHash);
+    put(payload, std::uint32_t(::getpid()));
+    if (!send(s.fd(), Hello, payload))
+        throw error("work: cannot send to coordinator");
+
+    std::vector<float> xyz;
+    for (;;) {
+        MessageType type;
+        if (!receive(s.fd(), type, payload) || type == Done)
+            return;
+        if (type == Reject)
+            throw std::runtime_error("work: the coordinator renders a different scene");
+        if (type != Work)
+            throw std::runtime_error("work: unexpected message");
+
+        std::size_t offset = 0;
+        Job job;
+        job.id = get<std::uint32_t>(payload, offset);
+        job.tile.x0 = get<std::int32_t>(payload, offset);
+        job.tile.y0 = get<std::int32_t>(payload, offset);
+        job.tile.x1 = get<std::int32_t>(payload, offset);
+        job.tile.y1 = get<std::int32_t>(payload, offset);
+        job.samplesPerPixel = get<std::uint32_t>(payload, offset);
+        if (get<std::uint64_t>(payload, offset) != sceneHash)
+            throw std::runtime_error("work: job is of a different scene");
+
+        render(job, xyz);
+
+        payload.clear();
+        put(payload, job.id);
+        append(payload, xyz.data(), xyz.size() * sizeof xyz[0]);
+        if (!send(s.fd(), Result, payload))
+            return;
+    }
+}
+
+} } }
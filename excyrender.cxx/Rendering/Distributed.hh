@@ -0,0 +1,97 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef DISTRIBUTED_HH_INCLUDED_20130830
+#define DISTRIBUTED_HH_INCLUDED_20130830
+
+#include "real.hh"
+#include "Sampling/Sampler.hh"
+#include "Rendering/TileScheduler.hh"
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+// Rendering one frame with several processes: a coordinator hands out tiles over a Unix
+// domain socket to any number of workers, which render them with all their threads and
+// send back CIE XYZ as floats.
+//
+// Workers are checked to have the same scene hash before they get work. The coordinator
+// takes messages from all workers as they arrive, so a worker that sends slowly, or
+// stalls in the middle of a message, does not hold up the others. A tile whose
+// worker disconnects is handed out again; so is a tile that takes longer than
+// CoordinatorPolicy::slowTile, to whichever worker is idle first, and the first result
+// to arrive is kept. As samples only depend on pixel and sample index, it does not
+// matter which worker renders which tile: the image is the same as from one process.
+namespace excyrender { namespace Rendering { namespace Distributed {
+
+    struct Job {
+        std::uint32_t id;
+        Tile tile;
+        std::uint32_t samplesPerPixel;
+    };
+
+    struct CoordinatorPolicy {
+        int tileSize = 64;
+        int samplesPerPixel = 16;
+        double slowTile = 60;   // seconds until a tile is also given to another worker
+    };
+
+    // Listens on 'socket' until all tiles of the width x height frame are rendered, then
+    // tells the workers to quit. Returns XYZ per pixel. Throws std::runtime_error.
+    std::vector<float> coordinate(std::string const &socket, int width, int height,
+                                  std::uint64_t sceneHash, CoordinatorPolicy const &policy);
+
+    // Connects to the coordinator at 'socket' (retrying for a few seconds if it is not up
+    // yet) and calls render(job, xyz) for each job, where 'xyz' is to be filled with
+    // job.tile.width()*job.tile.height() XYZ triples. Returns when the coordinator is done
+    // or gone. Throws std::runtime_error, e.g. if the coordinator has another scene.
+    void work(std::string const &socket, std::uint64_t sceneHash,
+              std::function<void(Job const &, std::vector<float> &)> const &render);
+
+
+    // Renders a job with all threads of this process; 'camera' and 'integrate' are as for
+    // render_adaptive(). Sample i of a pixel is the same as in any other renderer.
+    template <typename Camera, typename Integrator>
+    void render_job(Job const &job, Sampling::Sequence sequence,
+                    Camera const &camera, Integrator const &integrate, std::vector<float> &xyz)
+    {
+        const Tile frame = job.tile;
+        const int width = frame.width();
+        xyz.assign(width * frame.height() * 3, 0);
+
+        TilePolicy tiling;
+        tiling.tileSize = 16;
+        tiling.progress = false;
+        render_tiles(width, frame.height(), tiling, sequence,
+            [&](Tile const &tile, ThreadContext &context) {
+                Sampling::Sampler &sampler = context.sampler;
+                for (int ty=tile.y0; ty!=tile.y1; ++ty) {
+                    for (int tx=tile.x0; tx!=tile.x1; ++tx) {
+                        const int x = frame.x0 + tx, y = frame.y0 + ty;
+                        sampler.startPixel(x, y);
+                        real X = 0, Y = 0, Z = 0;
+                        for (std::uint32_t i=0; i!=job.samplesPerPixel; ++i) {
+                            sampler.startSample(i);
+                            const real sx = x + sampler() - real(0.5),
+                                       sy = y + sampler() - real(0.5);
+                            const auto s = integrate(camera(sx, sy), sampler, context.arena).toXYZ();
+                            context.arena.reset();
+                            X += std::get<0>(s);
+                            Y += std::get<1>(s);
+                            Z += std::get<2>(s);
+                        }
+                        const real f = real(1) / job.samplesPerPixel;
+                        float *out = &xyz[(ty*width + tx) * 3];
+                        out[0] = X*f;
+                        out[1] = Y*f;
+                        out[2] = Z*f;
+                    }
+                }
+            });
+    }
+
+} } }
+
+#endif // DISTRIBUTED_HH_INCLUDED_20130830
@@ -0,0 +1,156 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "Rendering/Progressive.hh"
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace excyrender { namespace Rendering {
+
+namespace {
+    // Layout, in native byte order:
+    //   header, then samples (uint32 per pixel), then XYZ sums (3 reals per pixel).
+    const char magic[8] = {'E','X','C','Y','C','K','P','1'};
+
+    struct Header {
+        char magic[8];
+        std::uint32_t byteOrder;    // 0x01020304
+        std::uint32_t realSize;
+        std::uint64_t key;
+        std::int32_t width, height;
+        std::uint32_t sequence, seed, passes, reserved;
+    };
+
+    // Size of a checkpoint file of width x height pixels.
+    std::uint64_t fileSize(std::uint64_t width, std::uint64_t height) noexcept {
+        return sizeof(Header) + width * height * (sizeof(std::uint32_t) + 3 * sizeof(real));
+    }
+
+    template <typename T>
+    bool write(int fd, T const *data, std::size_t count) noexcept {
+        char const *p = reinterpret_cast<char const*>(data);
+        std::size_t left = sizeof(T) * count;
+        while (left) {
+            const ssize_t n = ::write(fd, p, left);
+            if (n < 0 && errno == EINTR)
+                continue;
+            if (n <= 0)
+                return false;
+            p += n;
+            left -= n;
+        }
+        return true;
+    }
+
+    template <typename T>
+    void read(std::istream &is, T *data, std::size_t count) {
+        is.read(reinterpret_cast<char*>(data), sizeof(T) * count);
+    }
+}
+
+
+void Checkpoint::save(std::string const &path) const {
+    const std::string tmp = path + ".tmp";
+    {
+        const int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+            throw std::runtime_error("Checkpoint::save: cannot open '" + tmp + "': " + std::strerror(errno));
+
+        Header h;
+        std::memcpy(h.magic, magic, sizeof magic);
+        h.byteOrder = 0x01020304;
+        h.realSize  = sizeof(real);
+        h.key       = key;
+        h.width     = buffer.width_;
+        h.height    = buffer.height_;
+        h.sequence  = static_cast<std::uint32_t>(sequence);
+        h.seed      = seed;
+        h.passes    = passes;
+        h.reserved  = 0;
+
+        // On disk before the rename, or a crash could leave a renamed but empty file.
+        bool written = write(fd, &h, 1)
+                    && write(fd, buffer.samples_.data(), buffer.samples_.size())
+                    && write(fd, buffer.xyz_.data(), buffer.xyz_.size())
+                    && ::fsync(fd) == 0;
+        int error = errno;
+        if (::close(fd) != 0 && written) {
+            written = false;
+            error = errno;
+        }
+        if (!written)
+            throw std::runtime_error("Checkpoint::save: cannot write '" + tmp + "': " + std::strerror(error));
+    }
+    if (std::rename(tmp.c_str(), path.c_str()) != 0)
+        throw std::runtime_error("Checkpoint::save: cannot rename '" + tmp + "' to '" + path + "'");
+
+    // The rename itself is durable once the directory is.
+    const std::string::size_type slash = path.rfind('/');
+    const std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+    const int dirfd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY);
+    if (dirfd < 0)
+        throw std::runtime_error("Checkpoint::save: cannot open '" + dir + "': " + std::strerror(errno));
+    const bool synced = ::fsync(dirfd) == 0;
+    const int error = errno;
+    ::close(dirfd);
+    if (!synced)
+        throw std::runtime_error("Checkpoint::save: cannot sync '" + dir + "': " + std::strerror(error));
+}
+
+
+bool Checkpoint::load(std::string const &path, int width, int height) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        return false;
+    is.seekg(0, std::ios::end);
+    const std::uint64_t size = is.tellg();
+    is.seekg(0);
+
+    Header h;
+    read(is, &h, 1);
+    if (!is || std::memcmp(h.magic, magic, sizeof magic) != 0)
+        throw std::runtime_error("Checkpoint::load: '" + path + "' is not a checkpoint");
+    if (h.byteOrder != 0x01020304 || h.realSize != sizeof(real))
+        throw std::runtime_error("Checkpoint::load: '" + path + "' was written by an incompatible build");
+    if (h.width < 0 || h.height < 0 || h.sequence > static_cast<std::uint32_t>(Sampling::Sequence::BlueNoise))
+        throw std::runtime_error("Checkpoint::load: '" + path + "' is corrupt");
+    // Before allocating for the header's size.
+    if (h.width != width || h.height != height)
+        throw std::runtime_error("Checkpoint::load: '" + path + "' is of another resolution");
+    if (size != fileSize(h.width, h.height))
+        throw std::runtime_error("Checkpoint::load: '" + path + "' is truncated or corrupt");
+
+    AccumulationBuffer b(h.width, h.height);
+    read(is, b.samples_.data(), b.samples_.size());
+    read(is, b.xyz_.data(), b.xyz_.size());
+    if (!is)
+        throw std::runtime_error("Checkpoint::load: '" + path + "' is truncated");
+
+    key      = h.key;
+    sequence = static_cast<Sampling::Sequence>(h.sequence);
+    seed     = h.seed;
+    passes   = h.passes;
+    buffer   = std::move(b);
+    return true;
+}
+
+
+std::uint64_t fingerprintFile(std::string const &path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is)
+        throw std::runtime_error("fingerprintFile: cannot read '" + path + "'");
+    std::uint64_t h = fingerprint("", 0);
+    char buffer[1<<16];
+    while (is.read(buffer, sizeof buffer) || is.gcount() > 0)
+        h = fingerprint(buffer, is.gcount(), h);
+    if (is.bad())
+        throw std::runtime_error("fingerprintFile: cannot read '" + path + "'");
+    return h;
+}
+
+} }
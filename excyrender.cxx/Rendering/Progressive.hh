@@ -0,0 +1,213 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef PROGRESSIVE_HH_INCLUDED_20130829
+#define PROGRESSIVE_HH_INCLUDED_20130829
+
+#include "real.hh"
+#include "Sampling/Sampler.hh"
+#include "Rendering/TileScheduler.hh"
+
+#include <atomic>
+#include <cstdint>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <tuple>
+#include <vector>
+#include <omp.h>
+
+namespace excyrender { namespace Rendering {
+
+    // Per pixel sums of CIE XYZ samples, and the number of samples summed.
+    class AccumulationBuffer final {
+    public:
+        AccumulationBuffer(int width = 0, int height = 0)
+            : width_(width), height_(height), xyz_(width*height*3, 0), samples_(width*height, 0)
+        {}
+
+        int width()  const noexcept { return width_; }
+        int height() const noexcept { return height_; }
+
+        void add(int pixel, std::tuple<real,real,real> const &xyz) noexcept {
+            xyz_[pixel*3+0] += std::get<0>(xyz);
+            xyz_[pixel*3+1] += std::get<1>(xyz);
+            xyz_[pixel*3+2] += std::get<2>(xyz);
+            ++samples_[pixel];
+        }
+
+        std::uint32_t samples(int pixel) const noexcept {
+            return samples_[pixel];
+        }
+
+        triple<real> mean(int pixel) const noexcept {
+            const real f = samples_[pixel] ? real(1) / samples_[pixel] : 0;
+            return make_triple(xyz_[pixel*3+0]*f, xyz_[pixel*3+1]*f, xyz_[pixel*3+2]*f);
+        }
+
+    private:
+        friend struct Checkpoint;
+
+        int width_, height_;
+        std::vector<real> xyz_;
+        std::vector<std::uint32_t> samples_;
+    };
+
+
+    // Everything needed to continue a progressive render: the accumulation buffer, and
+    // what determines the numbers of the remaining samples. The samplers are counter
+    // based, so their state is the sequence, the seed and, per pixel, the number of
+    // samples taken so far.
+    //
+    // 'key' identifies scene and settings; a checkpoint is only resumed by a render with
+    // the same key.
+    struct Checkpoint {
+        std::uint64_t key = 0;
+        Sampling::Sequence sequence = Sampling::Sequence::Independent;
+        std::uint32_t seed = 0;
+        std::uint32_t passes = 0;
+        AccumulationBuffer buffer;
+
+        // Writes to 'path' + ".tmp", syncs it, then renames over 'path' and syncs the
+        // directory, so that a process killed or a system crashing while saving leaves the
+        // previous checkpoint intact. Throws std::runtime_error.
+        void save(std::string const &path) const;
+
+        // Returns false if there is no file at 'path'. Throws std::runtime_error if the
+        // file is not a checkpoint of width x height pixels, or was written with a
+        // different 'real'.
+        bool load(std::string const &path, int width, int height);
+    };
+
+    // FNV-1a, to derive checkpoint keys from a description of scene and settings. Unlike
+    // std::hash, the result does not depend on the standard library. 'h' continues a
+    // previous fingerprint.
+    inline std::uint64_t fingerprint(char const *data, std::size_t size,
+                                     std::uint64_t h = UINT64_C(0xcbf29ce484222325)) noexcept
+    {
+        for (std::size_t i=0; i!=size; ++i) {
+            h ^= static_cast<unsigned char>(data[i]);
+            h *= UINT64_C(0x100000001b3);
+        }
+        return h;
+    }
+
+    inline std::uint64_t fingerprint(std::string const &s) noexcept {
+        return fingerprint(s.data(), s.size());
+    }
+
+    // fingerprint() of the contents of the file at 'path'. Throws std::runtime_error if it
+    // can not be read.
+    std::uint64_t fingerprintFile(std::string const &path);
+
+
+    struct ProgressivePolicy {
+        int samplesPerPixel = 64;         // in total
+        int samplesPerPass  = 1;
+        std::string checkpoint;           // file name; empty means no checkpoints
+        double checkpointInterval = 300;  // seconds between checkpoints
+        double timeBudget = 0;            // seconds; 0 means unlimited
+        std::atomic<bool> const *interrupt = nullptr;  // polled between passes
+        TilePolicy tiling;
+    };
+
+    struct ProgressiveReport {
+        int passes = 0;            // rendered by this call
+        bool resumed = false;
+        bool complete = false;     // false if stopped by time budget or interrupt
+        double seconds = 0;
+    };
+
+
+    // Renders 'width' x 'height' pixels in passes of samplesPerPass samples per pixel into
+    // 'state.buffer', until each pixel has samplesPerPixel samples. 'camera' and
+    // 'integrate' are as for render_adaptive().
+    //
+    // 'state' gives key, sequence and seed. If policy.checkpoint names an existing
+    // checkpoint of them, rendering continues from there. The state is saved between
+    // passes every checkpointInterval seconds, and whenever rendering stops. As the
+    // samples of a pixel are summed in the same order, whichever thread renders it and
+    // however often the render was resumed, the final image is bit for bit that of an
+    // uninterrupted render.
+    template <typename Camera, typename Integrator>
+    ProgressiveReport render_progressive(int width, int height, ProgressivePolicy const &policy,
+                                         Camera const &camera, Integrator const &integrate,
+                                         Checkpoint &state)
+    {
+        if (policy.samplesPerPixel < 1 || policy.samplesPerPass < 1)
+            throw std::logic_error("ProgressivePolicy: samplesPerPixel and samplesPerPass must be positive");
+
+        const double start = omp_get_wtime();
+        ProgressiveReport report;
+
+        const std::uint64_t key = state.key;
+        const Sampling::Sequence sequence = state.sequence;
+        const std::uint32_t seed = state.seed;
+        if (!policy.checkpoint.empty() && state.load(policy.checkpoint, width, height)) {
+            if (state.key != key || state.sequence != sequence || state.seed != seed)
+                throw std::runtime_error("checkpoint '" + policy.checkpoint + "' is of another scene or settings");
+            report.resumed = true;
+            std::clog << "resuming from '" << policy.checkpoint << "' after " << state.passes << " passes" << std::endl;
+        } else {
+            state.passes = 0;
+            state.buffer = AccumulationBuffer(width, height);
+        }
+
+        TilePolicy tiling = policy.tiling;
+        tiling.progress = false;
+        tiling.seed = state.seed;
+
+        double lastCheckpoint = omp_get_wtime();
+        auto const save = [&]() {
+            if (!policy.checkpoint.empty()) {
+                state.save(policy.checkpoint);
+                lastCheckpoint = omp_get_wtime();
+            }
+        };
+
+        for (;;) {
+            // Samples are added uniformly, so all pixels are at the same count.
+            const std::uint32_t taken = state.buffer.samples(0);
+            if (taken >= std::uint32_t(policy.samplesPerPixel)) {
+                report.complete = true;
+                break;
+            }
+            if ((policy.interrupt && *policy.interrupt)
+                || (policy.timeBudget > 0 && omp_get_wtime() - start >= policy.timeBudget))
+                break;
+
+            const std::uint32_t n = std::min<std::uint32_t>(policy.samplesPerPass, policy.samplesPerPixel - taken);
+            render_tiles(width, height, tiling, state.sequence,
+                [&](Tile const &tile, ThreadContext &context) {
+                    Sampling::Sampler &sampler = context.sampler;
+                    for (int y=tile.y0; y!=tile.y1; ++y) {
+                        for (int x=tile.x0; x!=tile.x1; ++x) {
+                            const int i = y*width + x;
+                            sampler.startPixel(x, y);
+                            for (std::uint32_t j=0; j!=n; ++j) {
+                                sampler.startSample(state.buffer.samples(i));
+                                const real sx = x + sampler() - real(0.5),
+                                           sy = y + sampler() - real(0.5);
+                                state.buffer.add(i, integrate(camera(sx, sy), sampler, context.arena).toXYZ());
+                                context.arena.reset();
+                            }
+                        }
+                    }
+                });
+            ++state.passes;
+            ++report.passes;
+            std::clog << "pass " << state.passes << ", " << state.buffer.samples(0) << '/'
+                      << policy.samplesPerPixel << " samples per pixel" << std::endl;
+
+            if (omp_get_wtime() - lastCheckpoint >= policy.checkpointInterval)
+                save();
+        }
+
+        save();
+        report.seconds = omp_get_wtime() - start;
+        return report;
+    }
+
+} }
+
+#endif // PROGRESSIVE_HH_INCLUDED_20130829
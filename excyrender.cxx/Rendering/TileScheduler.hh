@@ -0,0 +1,286 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TILESCHEDULER_HH_INCLUDED_20130828
+#define TILESCHEDULER_HH_INCLUDED_20130828
+
+#include "real.hh"
+#include "Statistics.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+#include <omp.h>
+
+namespace excyrender { namespace Rendering {
+
+    // Pixels [x0,x1) x [y0,y1).
+    struct Tile {
+        int x0, y0, x1, y1;
+
+        int width()  const noexcept { return x1 - x0; }
+        int height() const noexcept { return y1 - y0; }
+    };
+
+    enum class TileOrder {
+        Scanline,
+        Hilbert,   // neighbouring tiles are rendered close in time, which keeps caches warm
+        Spiral     // from the center outwards, so the interesting part shows up first
+    };
+
+
+    namespace detail {
+        // Position of (x,y) along the Hilbert curve that fills a n x n square, n a power of 2.
+        inline std::uint64_t hilbertIndex(std::uint32_t n, std::uint32_t x, std::uint32_t y) noexcept {
+            std::uint64_t d = 0;
+            for (std::uint32_t s=n/2; s>0; s/=2) {
+                const std::uint32_t rx = (x & s) > 0,
+                                    ry = (y & s) > 0;
+                d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+                if (ry == 0) {
+                    if (rx == 1) {
+                        x = s-1 - x;
+                        y = s-1 - y;
+                    }
+                    std::swap(x, y);
+                }
+            }
+            return d;
+        }
+    }
+
+    // Splits a width x height image into tiles of tileSize x tileSize (smaller at the
+    // right and bottom borders), in the given order.
+    inline std::vector<Tile> tiles(int width, int height, int tileSize, TileOrder order) {
+        if (width <= 0 || height <= 0 || tileSize <= 0)
+            throw std::logic_error("tiles(): width, height and tileSize must be positive");
+
+        const int tilesX = (width + tileSize-1) / tileSize,
+                  tilesY = (height + tileSize-1) / tileSize;
+        std::vector<Tile> ret;
+        ret.reserve(tilesX * tilesY);
+        for (int ty=0; ty!=tilesY; ++ty) {
+            for (int tx=0; tx!=tilesX; ++tx) {
+                ret.push_back(Tile{tx*tileSize, ty*tileSize,
+                                   std::min(width, (tx+1)*tileSize), std::min(height, (ty+1)*tileSize)});
+            }
+        }
+
+        switch (order) {
+        case TileOrder::Scanline:
+            break;
+        case TileOrder::Hilbert: {
+            std::uint32_t n = 1;
+            while (n < std::uint32_t(std::max(tilesX, tilesY)))
+                n *= 2;
+            std::stable_sort(ret.begin(), ret.end(), [&](Tile const &a, Tile const &b) {
+                return detail::hilbertIndex(n, a.x0/tileSize, a.y0/tileSize)
+                     < detail::hilbertIndex(n, b.x0/tileSize, b.y0/tileSize);
+            });
+            break;
+        }
+        case TileOrder::Spiral: {
+            // Rings of equal distance to the center tile, each walked by angle.
+            const real cx = (tilesX-1) * real(0.5), cy = (tilesY-1) * real(0.5);
+            auto const key = [&](Tile const &t) {
+                const real dx = t.x0/tileSize - cx, dy = t.y0/tileSize - cy;
+                return std::make_pair(std::floor(std::max(std::fabs(dx), std::fabs(dy))),
+                                      std::atan2(dy, dx));
+            };
+            std::stable_sort(ret.begin(), ret.end(), [&](Tile const &a, Tile const &b) {
+                return key(a) < key(b);
+            });
+            break;
+        }
+        }
+        return ret;
+    }
+
+
+    // Hands out tiles to a fixed set of threads. Each thread has its own queue, initially
+    // a share of the tiles in render order, which it works off from the front. A thread
+    // whose queue has run dry steals from the back of another thread's queue, i.e. the
+    // tiles that thread would have rendered last.
+    class TileScheduler final {
+    public:
+        TileScheduler(std::vector<Tile> tiles, int threads, TileOrder order)
+            : tiles_(std::move(tiles)), threads_(threads), queues_(new Queue[threads])
+        {
+            if (threads <= 0)
+                throw std::logic_error("TileScheduler: threads must be positive");
+            const int n = tiles_.size();
+            for (int i=0; i!=n; ++i) {
+                // A spiral is dealt round-robin, so that all threads start in the center;
+                // other orders in contiguous runs, so that each thread stays local.
+                const int t = order == TileOrder::Spiral ? i % threads
+                                                         : int(std::int64_t(i) * threads / n);
+                queues_[t].tiles.push_back(i);
+            }
+        }
+
+        // Next tile for 'thread', or nullptr when all tiles are taken.
+        Tile const* next(int thread) {
+            if (Tile const *t = pop(queues_[thread], false))
+                return t;
+            for (int i=1; i!=threads_; ++i) {
+                if (Tile const *t = pop(queues_[(thread+i) % threads_], true))
+                    return t;
+            }
+            return nullptr;
+        }
+
+        int size() const noexcept {
+            return tiles_.size();
+        }
+
+    private:
+        struct Queue {
+            std::mutex mutex;
+            std::deque<int> tiles;
+        };
+
+        Tile const* pop(Queue &q, bool back) {
+            std::lock_guard<std::mutex> lock(q.mutex);
+            if (q.tiles.empty())
+                return nullptr;
+            int i;
+            if (back) {
+                i = q.tiles.back();
+                q.tiles.pop_back();
+            } else {
+                i = q.tiles.front();
+                q.tiles.pop_front();
+            }
+            return &tiles_[i];
+        }
+
+        std::vector<Tile> tiles_;
+        int threads_;
+        std::unique_ptr<Queue[]> queues_;
+    };
+
+
+    // What a render thread owns for the duration of a frame.
+    struct ThreadContext {
+        ThreadContext(int thread, Sampling::Sequence sequence, std::uint32_t seed)
+            : thread(thread), sampler(0, 0, 0, sequence, seed)
+        {}
+
+        int thread;
+        Sampling::Sampler sampler;
+        MemoryArena arena;
+
+        // Statistics of the current tile, copied into the frame's once the tile is done.
+        // Pixels are rendered by one thread only, so no synchronisation is needed, and no
+        // cache lines are shared with other threads while rendering. Null if no
+        // statistics are collected.
+        Statistics::Counters* counters(int x, int y) noexcept {
+            if (statistics.empty())
+                return nullptr;
+            return &statistics[(y - tile.y0) * tile.width() + (x - tile.x0)];
+        }
+
+        Tile tile;
+        std::vector<Statistics::Counters> statistics;
+    };
+
+
+    struct TilePolicy {
+        int tileSize = 32;
+        TileOrder order = TileOrder::Hilbert;
+        int threads = 0;        // 0 means omp_get_max_threads()
+        bool progress = true;   // log finished tiles to std::clog about once a second
+        std::uint32_t seed = 0; // of the thread's samplers
+    };
+
+
+    // Renders a width x height frame tile by tile. 'render' is called as
+    // render(Tile const&, ThreadContext&), concurrently for different tiles.
+    //
+    // All threads live for the whole frame (one parallel region, no per-row or per-tile
+    // fork and join) and are fed by a TileScheduler. If 'statistics' is not null, its
+    // pixels receive each tile's ThreadContext::statistics, and its threads their sums;
+    // 'render' decides where to count, see ThreadContext::counters().
+    //
+    // If 'render' throws, the other threads finish their current tile and stop, and the
+    // first exception is rethrown.
+    template <typename Render>
+    void render_tiles(int width, int height, TilePolicy const &policy, Sampling::Sequence sequence,
+                      Render const &render, Statistics::Frame *statistics = nullptr)
+    {
+        const int threads = policy.threads > 0 ? policy.threads : omp_get_max_threads();
+        TileScheduler scheduler(tiles(width, height, policy.tileSize, policy.order),
+                                threads, policy.order);
+        if (statistics) {
+            statistics->width = width;
+            statistics->height = height;
+            statistics->pixels.assign(width*height, Statistics::Counters());
+            statistics->threads.assign(threads, Statistics::Counters());
+        }
+
+        std::atomic<int> done(0);
+        double lastLog = omp_get_wtime();
+
+        // An exception must not leave the parallel region. The first one is kept and
+        // rethrown after it; the other threads stop taking tiles.
+        std::exception_ptr error;
+        std::atomic<bool> failed(false);
+
+        #pragma omp parallel num_threads(threads)
+        {
+            try {
+                ThreadContext context(omp_get_thread_num(), sequence, policy.seed);
+
+                while (Tile const *tile = failed ? nullptr : scheduler.next(context.thread)) {
+                    context.tile = *tile;
+                    if (statistics)
+                        context.statistics.assign(tile->width() * tile->height(), Statistics::Counters());
+
+                    render(*tile, context);
+
+                    if (statistics) {
+                        for (int y=tile->y0; y!=tile->y1; ++y)
+                            std::copy_n(&context.statistics[(y - tile->y0) * tile->width()], tile->width(),
+                                        &statistics->pixels[y*width + tile->x0]);
+                        for (auto const &c : context.statistics)
+                            statistics->threads[context.thread] += c;
+                    }
+
+                    const int finished = ++done;
+                    if (policy.progress) {
+                        #pragma omp critical (excyrender_render_tiles_progress)
+                        {
+                            const double now = omp_get_wtime();
+                            if (now - lastLog > 1 || finished == scheduler.size()) {
+                                lastLog = now;
+                                std::clog << finished << '/' << scheduler.size() << " tiles" << std::endl;
+                            }
+                        }
+                    }
+                }
+            } catch (...) {
+                #pragma omp critical (excyrender_render_tiles_error)
+                {
+                    if (!error)
+                        error = std::current_exception();
+                }
+                failed = true;
+            }
+        }
+        if (error)
+            std::rethrow_exception(error);
+    }
+
+} }
+
+#endif // TILESCHEDULER_HH_INCLUDED_20130828
@@ -0,0 +1,122 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "BlueNoise.hh"
+#include <cmath>
+#include <vector>
+
+namespace excyrender { namespace Sampling { namespace BlueNoise {
+
+namespace {
+    const int size = mask_size,
+              area = mask_size*mask_size;
+
+    // Binary pattern on a torus, with the energy of each pixel being the gaussian
+    // weighted count of set pixels around it.
+    class Pattern {
+    public:
+        Pattern() : kernel_(area), energy_(area, 0), set_(area, false) {
+            const real sigma = 1.5;
+            for (int dy=0; dy!=size; ++dy) {
+                for (int dx=0; dx!=size; ++dx) {
+                    const int wx = std::min(dx, size-dx),
+                              wy = std::min(dy, size-dy);
+                    kernel_[dy*size+dx] = std::exp(-(wx*wx + wy*wy) / (2*sigma*sigma));
+                }
+            }
+        }
+
+        bool isSet(int p) const { return set_[p]; }
+
+        void set(int p, bool on) {
+            set_[p] = on;
+            const real sign = on ? 1 : -1;
+            const int px = p % size, py = p / size;
+            for (int y=0; y!=size; ++y) {
+                const int ky = ((y - py) + size) % size;
+                for (int x=0; x!=size; ++x) {
+                    const int kx = ((x - px) + size) % size;
+                    energy_[y*size+x] += sign * kernel_[ky*size+kx];
+                }
+            }
+        }
+
+        // Set pixel with the highest energy.
+        int tightestCluster() const {
+            int ret = -1;
+            for (int p=0; p!=area; ++p)
+                if (set_[p] && (ret<0 || energy_[p] > energy_[ret]))
+                    ret = p;
+            return ret;
+        }
+
+        // Unset pixel with the lowest energy.
+        int largestVoid() const {
+            int ret = -1;
+            for (int p=0; p!=area; ++p)
+                if (!set_[p] && (ret<0 || energy_[p] < energy_[ret]))
+                    ret = p;
+            return ret;
+        }
+
+    private:
+        std::vector<real> kernel_, energy_;
+        std::vector<bool> set_;
+    };
+
+    std::uint32_t hash(std::uint32_t x) {
+        x ^= x >> 16; x *= 0x7feb352du;
+        x ^= x >> 15; x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    std::vector<std::uint16_t> generate() {
+        // Initial binary pattern: a tenth of all pixels, randomly placed, then relaxed by
+        // moving the tightest cluster into the largest void until that is a no-op.
+        Pattern pattern;
+        const int initial = area / 10;
+        for (std::uint32_t i=0, placed=0; placed!=initial; ++i) {
+            const int p = hash(i) % area;
+            if (!pattern.isSet(p)) {
+                pattern.set(p, true);
+                ++placed;
+            }
+        }
+        for (;;) {
+            const int cluster = pattern.tightestCluster();
+            pattern.set(cluster, false);
+            const int void_ = pattern.largestVoid();
+            if (void_ == cluster) {
+                pattern.set(cluster, true);
+                break;
+            }
+            pattern.set(void_, true);
+        }
+
+        std::vector<std::uint16_t> ranks(area);
+
+        // Ranks below 'initial': remove tightest clusters from the prototype.
+        Pattern removal = pattern;
+        for (int r=initial-1; r>=0; --r) {
+            const int cluster = removal.tightestCluster();
+            removal.set(cluster, false);
+            ranks[cluster] = r;
+        }
+
+        // Remaining ranks: fill the largest voids.
+        for (int r=initial; r!=area; ++r) {
+            const int void_ = pattern.largestVoid();
+            pattern.set(void_, true);
+            ranks[void_] = r;
+        }
+        return ranks;
+    }
+}
+
+std::uint16_t const* mask() {
+    static const std::vector<std::uint16_t> ranks = generate();
+    return ranks.data();
+}
+
+} } }
@@ -0,0 +1,27 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef BLUENOISE_HH_INCLUDED_20130826
+#define BLUENOISE_HH_INCLUDED_20130826
+
+#include "real.hh"
+#include <cstdint>
+
+namespace excyrender { namespace Sampling { namespace BlueNoise {
+
+    static constexpr int mask_size = 64;
+
+    // A tileable mask_size x mask_size dither array: every rank 0..mask_size^2-1 appears
+    // once, and pixels of similar rank are spread evenly. Generated with Ulichney's
+    // void-and-cluster method upon first use.
+    std::uint16_t const* mask();
+
+    // Mask value at (x,y), wrapped around, in [0,1).
+    inline real value(std::uint32_t x, std::uint32_t y) {
+        return (mask()[(y % mask_size) * mask_size + (x % mask_size)] + real(0.5))
+               * (real(1) / (mask_size*mask_size));
+    }
+
+} } }
+
+#endif // BLUENOISE_HH_INCLUDED_20130826
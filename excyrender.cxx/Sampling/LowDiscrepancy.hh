@@ -0,0 +1,151 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef LOWDISCREPANCY_HH_INCLUDED_20130826
+#define LOWDISCREPANCY_HH_INCLUDED_20130826
+
+#include "real.hh"
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace excyrender { namespace Sampling { namespace LowDiscrepancy {
+
+    inline std::uint32_t reverseBits(std::uint32_t x) noexcept {
+        x = ((x >> 1) & 0x55555555u) | ((x & 0x55555555u) << 1);
+        x = ((x >> 2) & 0x33333333u) | ((x & 0x33333333u) << 2);
+        x = ((x >> 4) & 0x0f0f0f0fu) | ((x & 0x0f0f0f0fu) << 4);
+        x = ((x >> 8) & 0x00ff00ffu) | ((x & 0x00ff00ffu) << 8);
+        return (x >> 16) | (x << 16);
+    }
+
+    // Hash based Owen scrambling (Burley, "Practical Hash-based Owen Scrambling", 2020).
+    // Each bit is flipped depending only on the bits above it, so stratification of the
+    // input is preserved.
+    inline std::uint32_t owenScramble(std::uint32_t x, std::uint32_t seed) noexcept {
+        x = reverseBits(x);
+        x ^= x * 0x3d20adeau;
+        x += seed;
+        x *= (seed >> 16) | 1;
+        x ^= x * 0x05526c56u;
+        x ^= x * 0x53a22864u;
+        return reverseBits(x);
+    }
+
+    // The first two dimensions of the Sobol sequence, as 0.32 fixed point.
+    inline std::uint32_t sobol0(std::uint32_t index) noexcept {
+        return reverseBits(index);
+    }
+
+    inline std::uint32_t sobol1(std::uint32_t index) noexcept {
+        std::uint32_t r = 0;
+        for (std::uint32_t v = 1u << 31; index; index >>= 1, v ^= v >> 1) {
+            if (index & 1)
+                r ^= v;
+        }
+        return r;
+    }
+
+    // Owen scrambled Sobol. Dimensions are taken in pairs from the 2D Sobol sequence;
+    // each pair gets its own scramble and its own shuffle of the sample index, so that
+    // pairs are decorrelated from each other and there is no limit on the dimension.
+    inline std::uint32_t scrambledSobol(std::uint32_t index, std::uint32_t dimension,
+                                        std::uint32_t pairSeed) noexcept
+    {
+        const std::uint32_t i = owenScramble(index, pairSeed);
+        return (dimension & 1)
+             ? owenScramble(sobol1(i), pairSeed ^ 0xa511e9b3u)
+             : owenScramble(sobol0(i), pairSeed ^ 0x63d83595u);
+    }
+
+
+    static constexpr int halton_dimensions = 128;
+
+    inline std::uint32_t haltonBase(int dimension) noexcept {
+        static constexpr std::uint32_t primes[halton_dimensions] = {
+            2, 3, 5, 7, 11, 13, 17, 19, 23, 29, 31, 37, 41, 43, 47, 53,
+            59, 61, 67, 71, 73, 79, 83, 89, 97, 101, 103, 107, 109, 113, 127, 131,
+            137, 139, 149, 151, 157, 163, 167, 173, 179, 181, 191, 193, 197, 199, 211, 223,
+            227, 229, 233, 239, 241, 251, 257, 263, 269, 271, 277, 281, 283, 293, 307, 311,
+            313, 317, 331, 337, 347, 349, 353, 359, 367, 373, 379, 383, 389, 397, 401, 409,
+            419, 421, 431, 433, 439, 443, 449, 457, 461, 463, 467, 479, 487, 491, 499, 503,
+            509, 521, 523, 541, 547, 557, 563, 569, 571, 577, 587, 593, 599, 601, 607, 613,
+            617, 619, 631, 641, 643, 647, 653, 659, 661, 673, 677, 683, 691, 701, 709, 719,
+        };
+        return primes[dimension];
+    }
+
+    inline std::uint32_t hash(std::uint32_t x) noexcept {
+        x ^= x >> 16; x *= 0x7feb352du;
+        x ^= x >> 15; x *= 0x846ca68bu;
+        x ^= x >> 16;
+        return x;
+    }
+
+    // A pseudo-random permutation of [0,length), selected by 'seed'
+    // (A. Kensler, "Correlated Multi-Jittered Sampling", 2013).
+    inline std::uint32_t permute(std::uint32_t i, std::uint32_t length, std::uint32_t seed) noexcept {
+        std::uint32_t w = length - 1;
+        w |= w >> 1; w |= w >> 2; w |= w >> 4; w |= w >> 8; w |= w >> 16;
+        do {
+            i ^= seed; i *= 0xe170893du;
+            i ^= seed >> 16;
+            i ^= (i & w) >> 4;
+            i ^= seed >> 8; i *= 0x0929eb3fu;
+            i ^= seed >> 23;
+            i ^= (i & w) >> 1; i *= 1 | seed >> 27;
+            i *= 0x6935fa69u;
+            i ^= (i & w) >> 11; i *= 0x74dcb303u;
+            i ^= (i & w) >> 2; i *= 0x9e501cc3u;
+            i ^= (i & w) >> 2; i *= 0xc860a3dfu;
+            i &= w;
+            i ^= i >> 5;
+        } while (i >= length);
+        return (i + seed) % length;
+    }
+
+    // Radical inverse of 'index' in the base of Halton dimension 'dimension'
+    // (0 <= dimension < halton_dimensions), Owen scrambled: each digit is permuted by
+    // a permutation that depends on 'seed' and on all digits before it. Without
+    // scrambling, higher dimensions with their large, similar bases are strongly
+    // correlated for small sample counts.
+    inline real scrambledHalton(std::uint32_t index, int dimension, std::uint32_t seed) noexcept {
+        const std::uint32_t base = haltonBase(dimension);
+        const real invBase = real(1) / base;
+        real ret = 0, f = invBase;
+        std::uint32_t node = hash(seed ^ hash(dimension));
+        // Digits until they no longer matter at 32 bit precision.
+        for (real weight = 1; weight * 4294967296.0 > 1; weight *= invBase, f *= invBase) {
+            const std::uint32_t digit = index % base;
+            index /= base;
+            ret += permute(digit, base, node) * f;
+            node = hash(node + digit + 1);
+        }
+        return ret < 1 ? ret : std::nextafter(real(1), real(0));
+    }
+
+    // x as fixed point fraction in [0,1), from as many of its top bits as 'real' holds
+    // exactly. With more, the product can round up to 1: for float, 0xFFFFFFFF * 2^-32
+    // does.
+    template <typename UInt>
+    inline real fixedToReal(UInt x) noexcept {
+        constexpr int bits = 8 * sizeof(UInt),
+                      kept = std::numeric_limits<real>::digits < bits ? std::numeric_limits<real>::digits : bits;
+        return real(x >> (bits - kept)) * (real(1) / real(std::uint64_t(1) << kept));
+    }
+
+    // 0.32 fixed point to [0,1).
+    inline real toReal(std::uint32_t x) noexcept {
+        return fixedToReal(x);
+    }
+
+    // Fractional part of a+b, for a,b in [0,1); a+b can round to 2.
+    inline real rotate(real a, real b) noexcept {
+        const real s = a + b,
+                   r = s < 1 ? s : s - 1;
+        return r < 1 ? r : std::nextafter(real(1), real(0));
+    }
+
+} } }
+
+#endif // LOWDISCREPANCY_HH_INCLUDED_20130826
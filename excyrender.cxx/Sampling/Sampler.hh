@@ -0,0 +1,143 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SAMPLER_HH_INCLUDED_20130825
+#define SAMPLER_HH_INCLUDED_20130825
+
+#include "real.hh"
+#include "Sampling/LowDiscrepancy.hh"
+#include "Sampling/BlueNoise.hh"
+#include <cstdint>
+
+namespace excyrender { namespace Sampling {
+
+    enum class Sequence {
+        // Uncorrelated numbers; plain Monte Carlo.
+        Independent,
+        // Owen scrambled Sobol, scrambled differently for each pixel.
+        Sobol,
+        // Owen scrambled Halton, scrambled differently for each pixel. Dimensions from
+        // LowDiscrepancy::halton_dimensions on are Independent.
+        Halton,
+        // Owen scrambled Sobol, scrambled the same for all pixels but shifted per pixel by
+        // a blue noise mask, so that the remaining error looks like blue noise.
+        BlueNoise
+    };
+
+
+    // Dimension layout of a camera sample, so that each decision of a path always draws
+    // from the same dimension: 0 and 1 are the image plane, then each path vertex has
+    // vertex_dimensions, with the BSDF sample at +bsdf_dimension, Russian roulette at
+    // +roulette_dimension and light samples pairwise from +light_dimension on. Light
+    // samples that do not fit share dimensions with the next vertex; estimates stay
+    // unbiased, but lose some stratification.
+    static constexpr std::uint32_t image_dimension    = 0,
+                                   vertex_dimensions  = 16,
+                                   bsdf_dimension     = 0,
+                                   roulette_dimension = 2,
+                                   light_dimension    = 4;
+
+    constexpr std::uint32_t vertexDimension(int vertex) noexcept {
+        return 2 + vertex*vertex_dimensions;
+    }
+
+
+    // Source of the numbers of one camera sample.
+    //
+    // Numbers are not drawn from a stateful generator but computed from (seed, pixel,
+    // sample, dimension), where the dimension counts up with every number taken unless
+    // set explicitly. The state is a few integers, and a render is reproducible no
+    // matter which thread renders which pixel, or in which order.
+    class Sampler final {
+    public:
+        Sampler(std::uint32_t x, std::uint32_t y, std::uint32_t sample,
+                Sequence sequence = Sequence::Independent, std::uint32_t seed = 0) noexcept
+            : sequence_(sequence), seed_(seed), x_(x), y_(y), sample_(sample),
+              pixelSeed_(static_cast<std::uint32_t>(hash(seed, x, y, 0) >> 32))
+        {}
+
+        // Moves on to another pixel, so that one sampler can serve a whole thread.
+        void startPixel(std::uint32_t x, std::uint32_t y, std::uint32_t sample = 0) noexcept {
+            x_ = x;
+            y_ = y;
+            pixelSeed_ = static_cast<std::uint32_t>(hash(seed_, x, y, 0) >> 32);
+            startSample(sample);
+        }
+
+        // Moves on to another sample of the same pixel, starting at dimension 0.
+        void startSample(std::uint32_t sample) noexcept {
+            sample_ = sample;
+            dimension_ = 0;
+        }
+
+        // Next number in [0,1).
+        real operator() () noexcept {
+            return get(dimension_++);
+        }
+
+        std::uint32_t dimension() const noexcept {
+            return dimension_;
+        }
+
+        void setDimension(std::uint32_t dimension) noexcept {
+            dimension_ = dimension;
+        }
+
+        Sequence sequence() const noexcept { return sequence_; }
+        std::uint32_t x() const noexcept { return x_; }
+        std::uint32_t y() const noexcept { return y_; }
+        std::uint32_t sample() const noexcept { return sample_; }
+
+    private:
+        real get(std::uint32_t d) const noexcept {
+            using namespace LowDiscrepancy;
+            switch (sequence_) {
+            case Sequence::Independent:
+                break;
+            case Sequence::Sobol:
+                return toReal(scrambledSobol(sample_, d, pairSeed(pixelSeed_, d)));
+            case Sequence::Halton:
+                if (d < halton_dimensions)
+                    return scrambledHalton(sample_, d, pixelSeed_);
+                break;
+            case Sequence::BlueNoise:
+                return rotate(toReal(scrambledSobol(sample_, d, pairSeed(seed_, d))),
+                              BlueNoise::value(x_ + 13*d, y_ + 41*d));
+            }
+            return toReal53(hash(seed_, x_, y_, sample_ ^ (std::uint64_t(d) << 32)));
+        }
+
+        // SplitMix64 finaliser.
+        static std::uint64_t mix(std::uint64_t z) noexcept {
+            z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+            z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+            return z ^ (z >> 31);
+        }
+
+        static std::uint64_t hash(std::uint32_t seed, std::uint32_t x, std::uint32_t y,
+                                  std::uint64_t v) noexcept
+        {
+            const std::uint64_t golden = UINT64_C(0x9e3779b97f4a7c15);
+            std::uint64_t h = mix(seed + golden);
+            h = mix(h ^ (x + golden));
+            h = mix(h ^ (y + golden));
+            h = mix(h ^ (v + golden));
+            return h;
+        }
+
+        static std::uint32_t pairSeed(std::uint32_t seed, std::uint32_t d) noexcept {
+            return static_cast<std::uint32_t>(mix((std::uint64_t(seed) << 32) | (d >> 1)) >> 32);
+        }
+
+        static real toReal53(std::uint64_t h) noexcept {
+            // 53 bits, or 24 for float: exactly representable, so strictly less than 1.
+            return LowDiscrepancy::fixedToReal(h);
+        }
+
+        Sequence sequence_;
+        std::uint32_t seed_, x_, y_, sample_, pixelSeed_, dimension_ = 0;
+    };
+
+} }
+
+#endif // SAMPLER_HH_INCLUDED_20130825
@@ -0,0 +1,84 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef SCENE_HH_INCLUDED_20130822
+#define SCENE_HH_INCLUDED_20130822
+
+#include "Primitives/Primitive.hh"
+#include "Photometry/Material/Material.hh"
+#include "Photometry/Lighting.hh"
+#include "Photometry/Spectrum.hh"
+#include "Geometry/Direction.hh"
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <vector>
+
+namespace excyrender {
+
+    // Owns everything a render refers to: materials, the primitive, light sources and
+    // the background.
+    //
+    // Primitives and hit records only keep plain Material pointers, so that no reference
+    // count is touched per ray. Those pointers are valid for as long as the scene lives.
+    class Scene final {
+    public:
+        typedef std::function<Photometry::Spectrum(Geometry::Direction const &)> Background;
+
+        Scene()
+            : background_([](Geometry::Direction const &) {
+                              return Photometry::Spectrum::Black(400,800,8);
+                          })
+        {}
+
+        Scene(Scene const &)            = delete;
+        Scene& operator=(Scene const &) = delete;
+
+        Photometry::Material::Material const*
+            add(std::shared_ptr<const Photometry::Material::Material> material)
+        {
+            if (!material)
+                throw std::logic_error("Scene::add(Material): material must not be null");
+            materials_.push_back(material);
+            return material.get();
+        }
+
+        void add(std::shared_ptr<Photometry::LightSource> light) {
+            if (!light)
+                throw std::logic_error("Scene::add(LightSource): light source must not be null");
+            lightSources_.push_back(light);
+        }
+
+        void setPrimitive(std::shared_ptr<const Primitives::Primitive> primitive) {
+            if (!primitive)
+                throw std::logic_error("Scene::setPrimitive(): primitive must not be null");
+            primitive_ = primitive;
+        }
+
+        void setBackground(Background background) {
+            background_ = background;
+        }
+
+        Primitives::Primitive const& primitive() const {
+            if (!primitive_)
+                throw std::logic_error("Scene::primitive(): no primitive has been set");
+            return *primitive_;
+        }
+
+        std::vector<std::shared_ptr<Photometry::LightSource>> const& lightSources() const noexcept {
+            return lightSources_;
+        }
+
+        Photometry::Spectrum background(Geometry::Direction const &d) const {
+            return background_(d);
+        }
+
+    private:
+        std::vector<std::shared_ptr<const Photometry::Material::Material>> materials_;
+        std::vector<std::shared_ptr<Photometry::LightSource>> lightSources_;
+        std::shared_ptr<const Primitives::Primitive> primitive_;
+        Background background_;
+    };
+}
+
+#endif // SCENE_HH_INCLUDED_20130822
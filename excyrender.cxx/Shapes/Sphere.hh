@@ -22,6 +22,16 @@ namespace excyrender { namespace Shapes {
         }
 
         optional<DifferentialGeometry> intersect(Geometry::Ray const &ray) const noexcept{
+            using namespace Geometry;
+            const real dd = nearest(ray);
+            if (dd < 0) return optional<DifferentialGeometry>();
+            const Point poi = ray(dd);
+            const Vector p = poi - center;
+            return DifferentialGeometry{dd, poi, Normal::Normalize(p), 0, 0, Vector{-p.z, 0, p.x}};
+        }
+
+        // Distance to the hit intersect() would return, -1 if there is none.
+        real nearest(Geometry::Ray const &ray) const noexcept {
             using namespace Geometry;
             const Vector diff = ray.origin - center;
             const real d0 = dot(diff, static_cast<Vector>(ray.direction)),
@@ -29,25 +39,21 @@ namespace excyrender { namespace Shapes {
                        d2 = dot(ray.direction, ray.direction),
                        d3 = len_sq(diff),
                        discriminant = d1 - d2*(d3 - radius*radius);
-            if (discriminant<0) return optional<DifferentialGeometry>();
+            if (discriminant<0) return -1;
 
             const real solA = -d0 - sqrt(discriminant),
                        solB = -d0 + sqrt(discriminant);
 
             if (solA > 0) {
                 const real dd = solA / d2;
-                const Point poi = ray(dd);
-                const Vector p = poi - center;
                 if (dd>epsilon)
-                    return DifferentialGeometry{dd, poi, Normal::Normalize(p), 0, 0, Vector{-p.z, 0, p.x}};
+                    return dd;
             } else if (solB > 0) {
                 const real dd = solB / d2;
-                const Point poi = ray(dd);
-                const Vector p = poi - center;
                 if (dd>epsilon)
-                    return DifferentialGeometry{dd, poi, Normal::Normalize(p), 0, 0, Vector{-p.z, 0, p.x}};
+                    return dd;
             }
-            return optional<DifferentialGeometry>();
+            return -1;
         }
 
         bool occludes(Geometry::Point const &start, Geometry::Point const &end) const noexcept {
@@ -2,7 +2,10 @@
 // GNU General Public License, Version 3 (a.k.a. GPLv3).
 // See COPYING in the root-folder of the excygen project folder.
 #include "Terrain2d.hh"
-#include "Shapes/Triangle.hh"
+#include "detail/BIH/RecursiveTraverser.hh"
+#include "detail/BIH/Builder.hh"
+#include <iostream>
+#include <vector>
 
 namespace excyrender { namespace Shapes {
 
@@ -14,61 +17,65 @@ Terrain2d::Terrain2d(Geometry::Rectangle const &target_,
     if (resolution <= 0)
         throw std::logic_error("Terrain2d: resolution must be >= 1");
 
-    Shapes::BoundingIntervalHierarchyBuilder builder;
-
-    const Geometry::Point2d
-           sd {source_.width() / resolution, source_.height() / resolution },
-           td {target_.width() / resolution, target_.height() / resolution };
-
+    // Vertices are computed once, so that cells sharing them agree to the last bit; else
+    // even a watertight test lets rays through.
     std::cerr << "tesselating terrain ..." << std::endl;
-    for (int iz=0; iz!=resolution; ++iz) {
+    const int stride = resolution+1;
+    std::vector<Geometry::Point> grid;
+    grid.reserve(stride * stride);
+    for (int iz=0; iz<=resolution; ++iz) {
         const real v = iz / real(resolution);
-        for (int ix=0; ix!=resolution; ++ix) {
+        for (int ix=0; ix<=resolution; ++ix) {
             const real u = ix / real(resolution);
-
             const Geometry::Point2d source = source_(u,v),
                                     target = target_(u,v);
-            const real Ah = height_(source.x,      source.y+sd.y),
-                       Bh = height_(source.x+sd.x, source.y+sd.y),
-                       Ch = height_(source.x,      source.y),
-                       Dh = height_(source.x+sd.x, source.y);
-
-            const Geometry::Point A {target.x,      Ah, target.y+td.y},
-                                  B {target.x+td.x, Bh, target.y+td.y},
-                                  C {target.x,      Ch, target.y},
-                                  D {target.x+td.x, Dh, target.y};
+            grid.push_back({target.x, height_(source.x, source.y), target.y});
+        }
+    }
 
-            builder.add(shared_ptr<Triangle>(new Triangle(A,B,C)));
-            builder.add(shared_ptr<Triangle>(new Triangle(C,B,D)));
+    // Each block takes the two triangles of a few cells in a row, so that it stays compact.
+    const int cellsPerBlock = Block::lanes / 2;
+    for (int iz=0; iz!=resolution; ++iz) {
+        for (int bx=0; bx<resolution; bx+=cellsPerBlock) {
+            Block block;
+            for (int ix=bx; ix!=std::min(bx+cellsPerBlock, resolution); ++ix) {
+                Geometry::Point const &A = grid[(iz+1)*stride + ix],
+                                      &B = grid[(iz+1)*stride + ix+1],
+                                      &C = grid[iz*stride + ix],
+                                      &D = grid[iz*stride + ix+1];
+                block.add(A,B,C);
+                block.add(C,B,D);
+            }
+            bih.objects.push_back(block);
         }
     }
 
     std::cerr << "building terrain bih ..." << std::endl;
-    bih = builder.finalize(20);
+    detail::BIH::build(bih, 20);
 }
 
 
 optional<DifferentialGeometry> Terrain2d::intersect(Geometry::Ray const &ray) const noexcept
 {
-    return bih->intersect(ray);
+    return detail::BIH::recursive_intersect(bih, ray);
 }
 
 
 bool Terrain2d::occludes(Geometry::Point const &A, Geometry::Point const &B) const noexcept
 {
-    return bih->occludes(A,B);
+    return detail::BIH::recursive_occludes(bih, A, B);
 }
 
 
 bool Terrain2d::occludes(Geometry::Point const &A, Geometry::Direction const &B) const noexcept
 {
-    return bih->occludes(A,B);
+    return detail::BIH::recursive_occludes(bih, A, B);
 }
 
 
 AABB Terrain2d::aabb() const noexcept
 {
-    return bih->aabb();
+    return bih.aabb;
 }
 
 
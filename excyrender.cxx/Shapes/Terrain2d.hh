@@ -7,14 +7,20 @@
 #include "memory.hh"
 #include "FiniteShape.hh"
 #include "Geometry/Rectangle.hh"
-#include "Shapes/BoundingIntervalHierarchy.hh"
+#include "Shapes/TriangleBlock.hh"
 #include "Nature/HeightFunction.hh"
+#include "detail/BIH/Data.hh"
 
 namespace excyrender { namespace Shapes {
 
+    // A height field, as triangles in blocks of a few neighbouring grid cells, tested
+    // watertight so that no ray slips between cells.
     class Terrain2d final : public FiniteShape
     {
     public:
+        // As many lanes as fit into 32 bytes: 4 doubles or 8 floats.
+        typedef TriangleBlock<32 / sizeof(real), TriangleTest::Watertight> Block;
+
         Terrain2d() = delete;
 
         Terrain2d(Geometry::Rectangle const &target,
@@ -28,7 +34,7 @@ namespace excyrender { namespace Shapes {
         AABB aabb() const noexcept ;
 
     private:
-        shared_ptr<BoundingIntervalHierarchy> bih;
+        detail::BIH::Data<Block> bih;
     };
 
 } }
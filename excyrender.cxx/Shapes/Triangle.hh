@@ -32,11 +32,17 @@ namespace excyrender { namespace Shapes {
                 return DifferentialGeometry(
                             t, ray(t),
                             dot(static_cast<Direction>(normal),ray.direction)>0?-normal:normal,
-                            u, v, dpdu);
+                            u, v, dpdu, C-A);
             }
             return optional<DifferentialGeometry>();
         }
 
+        // Distance to the hit intersect() would return, -1 if there is none.
+        real nearest(Geometry::Ray const &ray) const noexcept {
+            const auto t = intersect_(ray.origin, ray.direction);
+            return t > epsilon ? t : -1;
+        }
+
 
         bool occludes(Geometry::Point const &start, Geometry::Point const &end) const noexcept {
             return intersect_(start, Geometry::Direction::Normalize(end-start));
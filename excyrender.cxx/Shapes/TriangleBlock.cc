@@ -0,0 +1,59 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+// The watertight test relies on the edge function of an edge shared by two triangles,
+// and the sheared vertices it is made of, coming out to the same bits in both. That is
+// what IEEE arithmetic gives, but not what the compiler does with -ffast-math, or when it
+// fuses some multiply-adds but not others: this file is to be built without -ffast-math
+// and with -ffp-contract=off (see SConstruct). It is the only reason why the test is not
+// in the header.
+
+#ifdef __FAST_MATH__
+#error "Shapes/TriangleBlock.cc must be built without -ffast-math"
+#endif
+
+#include "Shapes/TriangleBlock.hh"
+
+namespace excyrender { namespace Shapes {
+
+template <int N, TriangleTest Test>
+void TriangleBlock<N,Test>::testWatertight(Geometry::Ray const &ray, real *t, real *u, real *v) const noexcept {
+    using namespace Geometry::Simd;
+    const real o[3] = {ray.origin.x, ray.origin.y, ray.origin.z},
+               d[3] = {ray.direction.x(), ray.direction.y(), ray.direction.z()};
+    // Permute so that z is the dominant axis, keeping the winding.
+    int kz = std::fabs(d[0]) > std::fabs(d[1]) ? 0 : 1;
+    if (std::fabs(d[2]) > std::fabs(d[kz]))
+        kz = 2;
+    int kx = kz == 2 ? 0 : kz+1, ky = kx == 2 ? 0 : kx+1;
+    if (d[kz] < 0)
+        std::swap(kx, ky);
+    const real Sx = d[kx] / d[kz], Sy = d[ky] / d[kz], Sz = 1 / d[kz];
+
+    // Vertices relative to the origin, sheared onto the ray.
+    typedef Real<N> R;
+    const R az = R::Load(v_[0][kz]) - o[kz], bz = R::Load(v_[1][kz]) - o[kz], cz = R::Load(v_[2][kz]) - o[kz],
+            ax = (R::Load(v_[0][kx]) - o[kx]) - Sx*az, ay = (R::Load(v_[0][ky]) - o[ky]) - Sy*az,
+            bx = (R::Load(v_[1][kx]) - o[kx]) - Sx*bz, by = (R::Load(v_[1][ky]) - o[ky]) - Sy*bz,
+            cx = (R::Load(v_[2][kx]) - o[kx]) - Sx*cz, cy = (R::Load(v_[2][ky]) - o[ky]) - Sy*cz,
+            U = cx*by - cy*bx,
+            V = ax*cy - ay*cx,
+            W = bx*ay - by*ax,
+            det = U + V + W,
+            inv = real(1) / select(det == real(0), R(1), det),
+            tt = (U*az + V*bz + W*cz) * Sz * inv;
+    const Mask<N> inside = !(((U < real(0)) | (V < real(0)) | (W < real(0)))
+                           & ((U > real(0)) | (V > real(0)) | (W > real(0)))),
+                  hit = inside & (det != real(0)) & (tt > epsilon);
+    select(hit, tt, R(real_max)).store(t);
+    (V * inv).store(u);
+    (W * inv).store(v);
+}
+
+template void TriangleBlock<4, TriangleTest::Watertight>::testWatertight(
+    Geometry::Ray const &, real *, real *, real *) const noexcept;
+template void TriangleBlock<8, TriangleTest::Watertight>::testWatertight(
+    Geometry::Ray const &, real *, real *, real *) const noexcept;
+
+} }
@@ -0,0 +1,201 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TRIANGLEBLOCK_HH_INCLUDED_20130904
+#define TRIANGLEBLOCK_HH_INCLUDED_20130904
+
+#include "AABB.hh"
+#include "DifferentialGeometry.hh"
+#include "optional.hh"
+#include "Geometry/Point.hh"
+#include "Geometry/Vector.hh"
+#include "Geometry/Normal.hh"
+#include "Geometry/Ray.hh"
+#include "Geometry/Simd/Vector.hh"
+#include <cmath>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+namespace excyrender { namespace Shapes {
+
+    enum class TriangleTest {
+        // Möller-Trumbore on edges computed when the block is built.
+        Precomputed,
+        // Woop, Benthin, Wald: "Watertight Ray/Triangle Intersection" (JCGT 2013). A ray
+        // that meets an edge or vertex shared by triangles hits at least one of them.
+        Watertight
+    };
+
+    // Up to N triangles in structure-of-arrays layout, tested against a ray at once, lane
+    // by lane in Geometry::Simd. N is 4 or 8, for as many reals as fit into a SIMD
+    // register or two.
+    //
+    // Intersections are as those of Triangle: (u,v) are barycentric with respect to B
+    // and C, dpdu = B-A and dpdv = C-A, and the normal faces the ray.
+    template <int N, TriangleTest Test>
+    class TriangleBlock final {
+    public:
+        static constexpr int lanes = N;
+
+        TriangleBlock() noexcept : count_(0) {
+            for (int k=0; k!=3; ++k)
+                for (int i=0; i!=N; ++i)
+                    v_[0][k][i] = v_[1][k][i] = v_[2][k][i] = n_[k][i] = 0;
+        }
+
+        int size() const noexcept { return count_; }
+        bool full() const noexcept { return count_ == N; }
+
+        void add(Geometry::Point const &A, Geometry::Point const &B, Geometry::Point const &C) {
+            if (full())
+                throw std::logic_error("TriangleBlock::add() called on a full block");
+            const Geometry::Vector e1 = B-A, e2 = C-A;
+            const Geometry::Normal n = Geometry::Normal::Normalize(cross(e1, e2));
+            const Geometry::Vector p[3] = {
+                static_cast<Geometry::Vector>(A),
+                Test == TriangleTest::Precomputed ? e1 : static_cast<Geometry::Vector>(B),
+                Test == TriangleTest::Precomputed ? e2 : static_cast<Geometry::Vector>(C)
+            };
+            for (int j=0; j!=3; ++j) {
+                v_[j][0][count_] = p[j].x;
+                v_[j][1][count_] = p[j].y;
+                v_[j][2][count_] = p[j].z;
+            }
+            n_[0][count_] = n.x();
+            n_[1][count_] = n.y();
+            n_[2][count_] = n.z();
+            ++count_;
+        }
+
+        optional<DifferentialGeometry> intersect(Geometry::Ray const &ray) const noexcept {
+            using namespace Geometry;
+            real t[N], u[N], v[N];
+            test(ray, t, u, v);
+            int nearest = -1;
+            real tn = real_max;
+            for (int i=0; i!=count_; ++i) {
+                if (t[i] < tn) {
+                    tn = t[i];
+                    nearest = i;
+                }
+            }
+            if (nearest < 0)
+                return optional<DifferentialGeometry>();
+
+            const int i = nearest;
+            const Vector A {v_[0][0][i], v_[0][1][i], v_[0][2][i]},
+                         P {v_[1][0][i], v_[1][1][i], v_[1][2][i]},
+                         Q {v_[2][0][i], v_[2][1][i], v_[2][2][i]},
+                         dpdu = Test == TriangleTest::Precomputed ? P : P-A,
+                         dpdv = Test == TriangleTest::Precomputed ? Q : Q-A;
+            const Normal n(n_[0][i], n_[1][i], n_[2][i]);
+            return DifferentialGeometry(tn, ray(tn),
+                                        dot(static_cast<Direction>(n), ray.direction)>0 ? -n : n,
+                                        u[i], v[i], dpdu, dpdv);
+        }
+
+        bool occludes(Geometry::Point const &start, Geometry::Direction const &direction) const noexcept {
+            real t[N], u[N], v[N];
+            test(Geometry::Ray(start, direction), t, u, v);
+            for (int i=0; i!=count_; ++i)
+                if (t[i] < real_max)
+                    return true;
+            return false;
+        }
+
+        AABB aabb() const noexcept {
+            Geometry::Point lo(real_max, real_max, real_max), hi(-real_max, -real_max, -real_max);
+            for (int i=0; i!=count_; ++i) {
+                for (int j=0; j!=3; ++j) {
+                    const real x = vertex(j, 0, i), y = vertex(j, 1, i), z = vertex(j, 2, i);
+                    lo = {min(lo.x, x), min(lo.y, y), min(lo.z, z)};
+                    hi = {max(hi.x, x), max(hi.y, y), max(hi.z, z)};
+                }
+            }
+            // A + (B-A) need not be B exactly; widened by what reconstructing a vertex can
+            // round away, relative to the largest coordinate on the axis.
+            if (Test == TriangleTest::Precomputed && count_) {
+                auto const pad = [](real a, real b) {
+                    return rounding_error * (1 + max(std::fabs(a), std::fabs(b)));
+                };
+                const real px = pad(lo.x, hi.x), py = pad(lo.y, hi.y), pz = pad(lo.z, hi.z);
+                lo = {lo.x - px, lo.y - py, lo.z - pz};
+                hi = {hi.x + px, hi.y + py, hi.z + pz};
+            }
+            return {lo, hi};
+        }
+
+    private:
+        // Per vertex, axis and lane: A, B-A, C-A for Precomputed, A, B, C for Watertight.
+        real v_[3][3][N];
+        real n_[3][N];
+        int count_;
+
+        real vertex(int j, int axis, int i) const noexcept {
+            return Test == TriangleTest::Precomputed && j != 0
+                 ? v_[0][axis][i] + v_[j][axis][i]
+                 : v_[j][axis][i];
+        }
+
+        // t is real_max where a lane misses.
+        void test(Geometry::Ray const &ray, real *t, real *u, real *v) const noexcept {
+            test(ray, t, u, v, std::integral_constant<TriangleTest, Test>());
+        }
+
+        void test(Geometry::Ray const &ray, real *t, real *u, real *v,
+                  std::integral_constant<TriangleTest, TriangleTest::Precomputed>) const noexcept
+        {
+            testPrecomputed(ray, t, u, v);
+        }
+
+        void test(Geometry::Ray const &ray, real *t, real *u, real *v,
+                  std::integral_constant<TriangleTest, TriangleTest::Watertight>) const noexcept
+        {
+            testWatertight(ray, t, u, v);
+        }
+
+        void testPrecomputed(Geometry::Ray const &ray, real *t, real *u, real *v) const noexcept {
+            using namespace Geometry::Simd;
+            const Vector<N> a = load(0), e1 = load(1), e2 = load(2);
+            const Direction<N> d(ray.direction);
+            const Vector<N> p = cross(d, e2),
+                            s = Vector<N>(static_cast<Geometry::Vector>(ray.origin)) - a,
+                            q = cross(s, e1);
+            const Real<N> det = dot(e1, p),
+                          inv = real(1) / select(fabs(det) < epsilon, Real<N>(1), det),
+                          uu = dot(s, p) * inv,
+                          vv = dot(d, q) * inv,
+                          tt = dot(e2, q) * inv;
+            const Mask<N> hit = (fabs(det) >= epsilon) & (uu >= real(0)) & (vv >= real(0))
+                              & (uu+vv <= real(1)) & (tt > epsilon);
+            select(hit, tt, Real<N>(real_max)).store(t);
+            uu.store(u);
+            vv.store(v);
+        }
+
+        Geometry::Simd::Vector<N> load(int j) const noexcept {
+            typedef Geometry::Simd::Real<N> R;
+            return {R::Load(v_[j][0]), R::Load(v_[j][1]), R::Load(v_[j][2])};
+        }
+
+        // In TriangleBlock.cc, for N of 4 and 8; see there.
+        void testWatertight(Geometry::Ray const &ray, real *t, real *u, real *v) const noexcept;
+    };
+
+
+    template <int N, TriangleTest Test>
+    inline optional<DifferentialGeometry> intersect(TriangleBlock<N,Test> const &b, Geometry::Ray const &r) noexcept
+    {
+        return b.intersect(r);
+    }
+
+    template <int N, TriangleTest Test>
+    inline AABB aabb(TriangleBlock<N,Test> const &b) noexcept
+    {
+        return b.aabb();
+    }
+
+} }
+
+#endif // TRIANGLEBLOCK_HH_INCLUDED_20130904
@@ -0,0 +1,161 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "TriangleMesh.hh"
+#include "detail/BIH/RecursiveTraverser.hh"
+#include "detail/BIH/Builder.hh"
+#include <iostream>
+#include <stdexcept>
+
+namespace excyrender { namespace Shapes {
+
+TriangleMesh::TriangleMesh(MeshBuffers buffers)
+    : buffers_(std::move(buffers))
+{
+    const std::size_t n = buffers_.positions.size();
+    if (buffers_.indices.empty() || buffers_.indices.size() % 3)
+        throw std::logic_error("TriangleMesh: number of indices must be a non-zero multiple of 3");
+    if (!buffers_.normals.empty() && buffers_.normals.size() != n)
+        throw std::logic_error("TriangleMesh: need one normal per position, or none");
+    if (!buffers_.uvs.empty() && buffers_.uvs.size() != n)
+        throw std::logic_error("TriangleMesh: need one uv per position, or none");
+    for (auto i : buffers_.indices)
+        if (i >= n)
+            throw std::logic_error("TriangleMesh: index out of range");
+
+    std::cerr << "building mesh bih (" << triangles() << " triangles) ..." << std::endl;
+    bih_.objects.resize(triangles());
+    for (std::uint32_t i=0; i!=bih_.objects.size(); ++i)
+        bih_.objects[i] = i;
+    detail::BIH::build(bih_, 24, triangles_());
+}
+
+
+optional<DifferentialGeometry> TriangleMesh::intersect(Geometry::Ray const &ray) const noexcept
+{
+    const auto hit = detail::BIH::recursive_intersect(bih_, triangles_(), ray);
+    if (!hit)
+        return optional<DifferentialGeometry>();
+    return differentialGeometry(ray, *hit);
+}
+
+
+bool TriangleMesh::occludes(Geometry::Point const &A, Geometry::Point const &B) const noexcept
+{
+    return detail::BIH::recursive_occludes(bih_, triangles_(), A, B);
+}
+
+
+bool TriangleMesh::occludes(Geometry::Point const &A, Geometry::Direction const &B) const noexcept
+{
+    return detail::BIH::recursive_occludes(bih_, triangles_(), A, B);
+}
+
+
+AABB TriangleMesh::aabb() const noexcept
+{
+    return bih_.aabb;
+}
+
+
+AABB TriangleMesh::Triangles::aabb(std::uint32_t triangle) const noexcept
+{
+    std::uint32_t const *i = &buffers->indices[3*triangle];
+    Geometry::Point const &A = buffers->positions[i[0]],
+                          &B = buffers->positions[i[1]],
+                          &C = buffers->positions[i[2]];
+    const auto u = minmax({A.x, B.x, C.x}),
+               v = minmax({A.y, B.y, C.y}),
+               w = minmax({A.z, B.z, C.z});
+    return {Geometry::Point{u.first, v.first, w.first},
+            Geometry::Point{u.second, v.second, w.second}};
+}
+
+
+// Möller-Trumbore, as in Triangle, but without the epsilon on the determinant, which would
+// drop the small triangles of scanned meshes.
+optional<TriangleMesh::Hit> TriangleMesh::Triangles::intersect(std::uint32_t triangle,
+                                                               Geometry::Ray const &ray) const noexcept
+{
+    using Geometry::Vector;
+    std::uint32_t const *i = &buffers->indices[3*triangle];
+    Geometry::Point const &A = buffers->positions[i[0]];
+    const Vector e1 = buffers->positions[i[1]] - A,
+                 e2 = buffers->positions[i[2]] - A,
+                 d = static_cast<Vector>(ray.direction);
+    const Vector P = cross(d, e2);
+    const real det = dot(e1, P);
+    if (det == 0)
+        return optional<Hit>();
+    const real inv_det = 1 / det;
+    const Vector T = ray.origin - A;
+    const real u = dot(T, P) * inv_det;
+    if (u < 0 || u > 1)
+        return optional<Hit>();
+    const Vector Q = cross(T, e1);
+    const real v = dot(d, Q) * inv_det;
+    if (v < 0 || u+v > 1)
+        return optional<Hit>();
+    const real t = dot(e2, Q) * inv_det;
+    if (t <= epsilon)
+        return optional<Hit>();
+    return Hit{t, triangle, u, v};
+}
+
+
+DifferentialGeometry TriangleMesh::differentialGeometry(Geometry::Ray const &ray, Hit const &hit) const noexcept
+{
+    using namespace Geometry;
+    std::uint32_t const *i = &buffers_.indices[3*hit.triangle];
+    const real b0 = 1 - hit.b1 - hit.b2;
+    Point const &A = buffers_.positions[i[0]];
+    const Vector e1 = buffers_.positions[i[1]] - A,
+                 e2 = buffers_.positions[i[2]] - A;
+
+    const Normal geometric = Normal::Normalize(cross(e1, e2));
+    const bool back = dot(static_cast<Direction>(geometric), ray.direction) > 0;
+
+    Normal nn = back ? -geometric : geometric;
+    if (!buffers_.normals.empty()) {
+        const Vector shading = b0      * buffers_.normals[i[0]]
+                             + hit.b1 * buffers_.normals[i[1]]
+                             + hit.b2 * buffers_.normals[i[2]];
+        if (len_sq(shading) > 0) {
+            const Normal s = Normal::Normalize(shading);
+            nn = dot(s, nn) < 0 ? -s : s;
+        }
+    }
+
+    // (u,v) and the change of position along them. Without uvs, (u,v) are barycentric.
+    real u = hit.b1, v = hit.b2;
+    Vector dpdu = e1, dpdv = e2;
+    if (!buffers_.uvs.empty()) {
+        Point2d const &a = buffers_.uvs[i[0]], &b = buffers_.uvs[i[1]], &c = buffers_.uvs[i[2]];
+        u = b0*a.x + hit.b1*b.x + hit.b2*c.x;
+        v = b0*a.y + hit.b1*b.y + hit.b2*c.y;
+        const real du1 = b.x-a.x, dv1 = b.y-a.y,
+                   du2 = c.x-a.x, dv2 = c.y-a.y,
+                   det = du1*dv2 - dv1*du2;
+        if (det != 0) {
+            const real inv_det = 1 / det;
+            dpdu = ( dv2*e1 - dv1*e2) * inv_det;
+            dpdv = (-du2*e1 + du1*e2) * inv_det;
+        }
+    }
+
+    // Shading frames (see worldToLocal()) want dpdu in the tangent plane of nn; dpdv goes
+    // there as well, see computeDifferentials().
+    const Vector n = static_cast<Vector>(nn),
+                 tangent = dpdu - n * dot(n, dpdu);
+    if (len_sq(tangent) > 0)
+        dpdu = tangent;
+    else
+        dpdu = createOrthogonal(n);
+    dpdv = dpdv - n * dot(n, dpdv);
+
+    DifferentialGeometry dg(hit.t, ray(hit.t), nn, u, v, dpdu, dpdv);
+    dg.ng = back ? -geometric : geometric;
+    return dg;
+}
+
+} }
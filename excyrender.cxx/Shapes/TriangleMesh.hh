@@ -0,0 +1,78 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TRIANGLEMESH_HH_INCLUDED_20130908
+#define TRIANGLEMESH_HH_INCLUDED_20130908
+
+#include "Shapes/FiniteShape.hh"
+#include "Geometry/Point.hh"
+#include "Geometry/Point2d.hh"
+#include "Geometry/Vector.hh"
+#include "detail/BIH/Data.hh"
+#include <cstdint>
+#include <vector>
+
+namespace excyrender { namespace Shapes {
+
+    // Vertex attributes shared by the triangles of a mesh. 'normals' and 'uvs' are either
+    // empty or one per position; 'indices' has three per triangle.
+    struct MeshBuffers {
+        std::vector<Geometry::Point> positions;
+        std::vector<Geometry::Vector> normals;
+        std::vector<Geometry::Point2d> uvs;
+        std::vector<std::uint32_t> indices;
+    };
+
+
+    // Triangles indexing into shared vertex buffers, in a BIH over triangle indices: four
+    // bytes per triangle on top of the buffers, and no object per triangle. See
+    // MeshFormat::readMesh() for reading PLY and OBJ files.
+    //
+    // Normals are interpolated where there are vertex normals, and (u,v) are taken from
+    // the vertex UVs where there are any; else, as for Triangle, (u,v) are barycentric
+    // with respect to the second and third vertex.
+    class TriangleMesh final : public FiniteShape {
+    public:
+        // Throws std::logic_error if an index is out of range, or if there are normals or
+        // uvs but not one per position.
+        explicit TriangleMesh(MeshBuffers buffers);
+
+        optional<DifferentialGeometry> intersect(Geometry::Ray const &ray) const noexcept;
+        bool occludes(Geometry::Point const &, Geometry::Point const &) const noexcept;
+        bool occludes(Geometry::Point const &, Geometry::Direction const &) const noexcept;
+        AABB aabb() const noexcept;
+
+        std::size_t vertices() const noexcept { return buffers_.positions.size(); }
+        std::size_t triangles() const noexcept { return buffers_.indices.size() / 3; }
+        MeshBuffers const &buffers() const noexcept { return buffers_; }
+
+        // Nearest hit so far, whose DifferentialGeometry is only made once it is known to
+        // be the nearest of all.
+        struct Hit {
+            real t;
+            std::uint32_t triangle;
+            real b1, b2;    // barycentric coordinates of the second and third vertex
+        };
+
+    private:
+        // How the BIH gets at triangles by index.
+        struct Triangles {
+            MeshBuffers const *buffers;
+            AABB aabb(std::uint32_t triangle) const noexcept;
+            optional<Hit> intersect(std::uint32_t triangle, Geometry::Ray const &ray) const noexcept;
+        };
+
+        MeshBuffers buffers_;
+        detail::BIH::Data<std::uint32_t> bih_;
+
+        Triangles triangles_() const noexcept { return Triangles{&buffers_}; }
+        DifferentialGeometry differentialGeometry(Geometry::Ray const &ray, Hit const &hit) const noexcept;
+    };
+
+    inline real distance(TriangleMesh::Hit const &hit) noexcept {
+        return hit.t;
+    }
+
+} }
+
+#endif // TRIANGLEMESH_HH_INCLUDED_20130908
@@ -0,0 +1,70 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+
+#include "Statistics.hh"
+#include <ostream>
+
+namespace excyrender { namespace Statistics {
+
+Counters *current = 0;
+
+
+Counters Frame::total() const noexcept {
+    Counters ret;
+    for (auto const &t : threads)
+        ret += t;
+    return ret;
+}
+
+
+namespace {
+    char const *rayTypeNames[rayTypes] = {"camera", "bounce", "shadow"};
+    char const *phaseNames[phases] = {"scene", "render", "output"};
+
+    void writeCounters(std::ostream &os, Counters const &c, char const *indent) {
+        std::uint64_t rays = 0, hits = 0;
+        os << "{\n" << indent << "  \"rays\": {";
+        for (int i=0; i!=rayTypes; ++i) {
+            os << (i ? ", " : "") << '"' << rayTypeNames[i] << "\": " << c.rays[i];
+            rays += c.rays[i];
+        }
+        os << "},\n" << indent << "  \"hits\": {";
+        for (int i=0; i!=rayTypes; ++i) {
+            os << (i ? ", " : "") << '"' << rayTypeNames[i] << "\": " << c.hits[i];
+            hits += c.hits[i];
+        }
+        os << "},\n"
+           << indent << "  \"hitRatio\": " << (rays ? double(hits) / rays : 0) << ",\n"
+           << indent << "  \"nodes\": " << c.nodes << ",\n"
+           << indent << "  \"tests\": " << c.tests << ",\n"
+           << indent << "  \"nodesPerRay\": " << (rays ? double(c.nodes) / rays : 0) << ",\n"
+           << indent << "  \"testsPerRay\": " << (rays ? double(c.tests) / rays : 0) << ",\n"
+           << indent << "  \"seconds\": " << c.seconds << ",\n"
+           << indent << "  \"raysPerSecond\": " << (c.seconds > 0 ? rays / c.seconds : 0) << "\n"
+           << indent << "}";
+    }
+}
+
+
+void writeJson(std::ostream &os, Frame const &frame) {
+    os << "{\n"
+       << "  \"width\": " << frame.width << ",\n"
+       << "  \"height\": " << frame.height << ",\n"
+       << "  \"phases\": {";
+    for (int i=0; i!=phases; ++i)
+        os << (i ? ", " : "") << '"' << phaseNames[i] << "\": " << frame.seconds[i];
+    os << "},\n"
+       << "  \"total\": ";
+    writeCounters(os, frame.total(), "  ");
+    os << ",\n"
+       << "  \"threads\": [";
+    for (std::size_t i=0; i!=frame.threads.size(); ++i) {
+        os << (i ? ",\n    " : "\n    ");
+        writeCounters(os, frame.threads[i], "    ");
+    }
+    os << "\n  ]\n"
+       << "}\n";
+}
+
+} }
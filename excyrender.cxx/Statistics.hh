@@ -0,0 +1,115 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef STATISTICS_HH_INCLUDED_20130911
+#define STATISTICS_HH_INCLUDED_20130911
+
+#include <cstdint>
+#include <iosfwd>
+#include <vector>
+
+// Counts of what rendering does, per pixel and per thread, to find out where time goes.
+//
+// Counting is compiled in only with EXCYRENDER_STATISTICS defined (scons
+// excygen-stats). Without, 'enabled' is false and the count functions are empty, so
+// that the hot paths are the same as if they were not there.
+//
+// Counts go to the Counters 'current' points to, which is per thread. Usually it points
+// to the pixel being rendered, see Rendering::render_tiles(). While it is null, nothing
+// is counted.
+namespace excyrender { namespace Statistics {
+
+#ifdef EXCYRENDER_STATISTICS
+    constexpr bool enabled = true;
+#else
+    constexpr bool enabled = false;
+#endif
+
+    enum class RayType {
+        Camera,
+        Bounce,
+        Shadow
+    };
+    constexpr int rayTypes = 3;
+
+    struct Counters {
+        // Rays by RayType, and how many of them hit something (for shadow rays: were
+        // occluded).
+        std::uint64_t rays[rayTypes] = {0, 0, 0},
+                      hits[rayTypes] = {0, 0, 0};
+        // Nodes of acceleration structures visited, and objects in their leaves tested,
+        // over all levels: a BIH leaf holding a Terrain2d counts once, and so does each
+        // node and block of the terrain's own BIH that is visited then.
+        std::uint64_t nodes = 0,
+                      tests = 0;
+        // Time spent rendering.
+        double seconds = 0;
+
+        Counters& operator+= (Counters const &rhs) noexcept {
+            for (int i=0; i!=rayTypes; ++i) {
+                rays[i] += rhs.rays[i];
+                hits[i] += rhs.hits[i];
+            }
+            nodes += rhs.nodes;
+            tests += rhs.tests;
+            seconds += rhs.seconds;
+            return *this;
+        }
+    };
+
+    extern Counters *current;
+    #pragma omp threadprivate(current)
+
+
+    inline void ray(RayType type, bool hit) noexcept {
+#ifdef EXCYRENDER_STATISTICS
+        if (current) {
+            ++current->rays[int(type)];
+            current->hits[int(type)] += hit;
+        }
+#else
+        (void)type; (void)hit;
+#endif
+    }
+
+    inline void node() noexcept {
+#ifdef EXCYRENDER_STATISTICS
+        if (current)
+            ++current->nodes;
+#endif
+    }
+
+    inline void tests(std::uint64_t count) noexcept {
+#ifdef EXCYRENDER_STATISTICS
+        if (current)
+            current->tests += count;
+#else
+        (void)count;
+#endif
+    }
+
+
+    // Phases of a run, timed as a whole.
+    enum class Phase {
+        Scene,    // loading and building the scene
+        Render,
+        Output
+    };
+    constexpr int phases = 3;
+
+    // Everything counted for one frame.
+    struct Frame {
+        int width = 0, height = 0;
+        // width*height, row by row, and one per render thread.
+        std::vector<Counters> pixels, threads;
+        double seconds[phases] = {0, 0, 0};
+
+        Counters total() const noexcept;
+    };
+
+    // Totals, per thread counts and phase times of 'frame' as a JSON object. The pixels
+    // are left out.
+    void writeJson(std::ostream &os, Frame const &frame);
+} }
+
+#endif // STATISTICS_HH_INCLUDED_20130911
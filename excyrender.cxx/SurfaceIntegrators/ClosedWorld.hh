@@ -0,0 +1,112 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef CLOSEDWORLD_HH_INCLUDED_20130911
+#define CLOSEDWORLD_HH_INCLUDED_20130911
+
+#include "Scene.hh"
+#include "MemoryArena.hh"
+#include "Primitives/ShapeStore.hh"
+#include "Photometry/BSDF/ClosedBSDF.hh"
+#include "Geometry/Ray.hh"
+#include "detail/Variant.hh"
+#include "optional.hh"
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <typeinfo>
+#include <vector>
+
+namespace excyrender { namespace SurfaceIntegrators {
+
+    template <typename Materials, typename BxDFs> class ClosedWorld;
+
+    // As OpenWorld, but for a scene whose primitive is a ShapeStore, whose materials are
+    // all of the types Materials, and whose BSDFs are made of BxDFs of the types BxDFs:
+    //
+    //     typedef ClosedWorld<detail::Types<Material::Lambertian>,
+    //                         detail::Types<Surface::Lambertian, Surface::SpecularReflect>> World;
+    //     BasicIterativePath<World> integrator(policy, scene);
+    //
+    // Shapes are tested without virtual calls (see ShapeStore), materials are chosen by
+    // their id from a table of variants, and BSDFs are Surface::ClosedBSDFs by value, so
+    // that the compiler sees the actual types and can inline them. Each material type must
+    // have a 'template <typename ClosedBSDF> ClosedBSDF closedBsdf(DifferentialGeometry
+    // const&) const'.
+    //
+    // Light sources stay virtual; they are given the BSDF as a Surface::BSDF.
+    template <typename ...Materials, typename ...BxDFs>
+    class ClosedWorld<excyrender::detail::Types<Materials...>, excyrender::detail::Types<BxDFs...>> {
+    public:
+        typedef Primitives::ShapeStore::IdIntersection Intersection;
+        typedef Photometry::Surface::ClosedBSDF<BxDFs...> BSDF;
+
+        // 'scene' must outlive the world. Throws std::logic_error if the primitive of
+        // 'scene' is not a ShapeStore, or if it has a material not in Materials.
+        explicit ClosedWorld(Scene const &scene)
+            : scene(scene), store(shapeStore(scene))
+        {
+            for (auto material : store.materials())
+                materials.push_back(closedMaterial<Materials...>(material));
+        }
+
+        optional<Intersection> intersect(Geometry::Ray const &ray) const noexcept {
+            return store.intersectWithId(ray);
+        }
+
+        // Needs no arena; it is there to match OpenWorld.
+        BSDF bsdf(Intersection const &i, MemoryArena &) const noexcept {
+            return materials[i.material].visit(MakeBSDF{i.dg});
+        }
+
+        Photometry::Spectrum directLighting(BSDF const &bsdf,
+                                            Intersection const &i,
+                                            Geometry::Direction const &wo) const noexcept
+        {
+            const auto open = bsdf.open();
+            Photometry::Spectrum sum = Photometry::Spectrum::Black(400, 800, 8);
+            for (auto const &light : scene.lightSources())
+                sum += light->lightFrom(wo, open, store, i.dg.poi, i.dg.nn);
+            return sum;
+        }
+
+    private:
+        typedef excyrender::detail::Variant<Materials const*...> material_type;
+
+        static Primitives::ShapeStore const& shapeStore(Scene const &scene) {
+            auto store = dynamic_cast<Primitives::ShapeStore const*>(&scene.primitive());
+            if (!store)
+                throw std::logic_error("ClosedWorld: the primitive of the scene must be a ShapeStore");
+            return *store;
+        }
+
+        // Types must match exactly; a type derived from one of Materials could behave
+        // differently.
+        template <typename M, typename ...Ms>
+        static material_type closedMaterial(Photometry::Material::Material const *material) {
+            if (typeid(*material) == typeid(M))
+                return material_type(static_cast<M const*>(material));
+            return closedMaterial<Ms...>(material);
+        }
+        template <typename ...Ms>
+        static typename std::enable_if<sizeof...(Ms)==0, material_type>::type
+        closedMaterial(Photometry::Material::Material const *material) {
+            throw std::logic_error(std::string("ClosedWorld: material of type '")
+                                   + typeid(*material).name() + "' is not in the list of materials");
+        }
+
+        struct MakeBSDF {
+            DifferentialGeometry const &dg;
+            template <typename M> BSDF operator() (M const *material) const noexcept {
+                return material->template closedBsdf<BSDF>(dg);
+            }
+        };
+
+        Scene const &scene;
+        Primitives::ShapeStore const &store;
+        std::vector<material_type> materials;
+    };
+
+} }
+
+#endif // CLOSEDWORLD_HH_INCLUDED_20130911
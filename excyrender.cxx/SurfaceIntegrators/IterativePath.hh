@@ -0,0 +1,175 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef ITERATIVEPATH_HH_INCLUDED_20130823
+#define ITERATIVEPATH_HH_INCLUDED_20130823
+
+#include "Scene.hh"
+#include "SurfaceIntegrators/World.hh"
+#include "Geometry/Ray.hh"
+#include "Intersection.hh"
+#include "Photometry/Lighting.hh"
+#include "Photometry/BSDF/BSDF.hh"
+#include "DifferentialGeometry.hh"
+#include "Statistics.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include <algorithm>
+#include <stdexcept>
+
+namespace excyrender { namespace SurfaceIntegrators {
+
+    // Controls how deep paths go and how many there are.
+    struct PathPolicy {
+        // Paths never exceed this many vertices.
+        int maxDepth = 5;
+
+        // From this vertex on, paths are terminated by Russian roulette. The survival
+        // probability is the largest bin of the path throughput, clamped to
+        // [minSurvival, maxSurvival]; survivors are reweighted, so the estimate stays
+        // unbiased. A rouletteDepth >= maxDepth disables roulette.
+        int rouletteDepth = 3;
+        real minSurvival  = real(0.05),
+             maxSurvival  = real(0.95);
+
+        // Number of BSDF continuations traced from the first vertex. Values above 1 spend
+        // more of the budget on indirect light without repeating the camera ray and its
+        // direct lighting.
+        int splits = 1;
+    };
+
+    inline void validate(PathPolicy const &policy) {
+        if (policy.splits < 1)
+            throw std::logic_error("PathPolicy::splits must be 1 or greater");
+        if (policy.minSurvival <= 0 || policy.minSurvival > policy.maxSurvival || policy.maxSurvival > 1)
+            throw std::logic_error("PathPolicy survival probabilities must satisfy "
+                                   "0 < minSurvival <= maxSurvival <= 1");
+    }
+
+    // Russian roulette before a path proceeds to vertex 'depth'. Reweights 'throughput'
+    // of survivors.
+    inline bool survives(PathPolicy const &policy, int depth, Photometry::Spectrum &throughput,
+                         Sampling::Sampler &sampler)
+    {
+        if (depth < policy.rouletteDepth)
+            return true;
+        const real survival = std::min(policy.maxSurvival,
+                                       std::max(policy.minSurvival, throughput.max()));
+        if (sampler() >= survival)
+            return false;
+        throughput /= survival;
+        return true;
+    }
+
+
+    // Same estimator as Path, but iterative: a running throughput and radiance replace
+    // recursion, and paths can be terminated early.
+    //
+    // With roulette disabled and splits == 1, it is the same estimator as Path.
+    //
+    // 'World' is OpenWorld, or a ClosedWorld for scenes of few known types.
+    template <typename World = OpenWorld>
+    class BasicIterativePath {
+    public:
+        // 'scene' must outlive the integrator.
+        BasicIterativePath (PathPolicy const &policy, Scene const &scene)
+            : policy(policy), scene(scene), world(scene)
+        {
+            validate(policy);
+        }
+
+        // BSDFs are built in 'arena'; the caller resets it after each camera sample.
+        Photometry::Spectrum operator() (Geometry::RayDifferential const &ray, Sampling::Sampler &sampler,
+                                         MemoryArena &arena) const
+        {
+            using namespace Photometry;
+            using namespace Surface;
+            using namespace Geometry;
+            using std::tuple; using std::get;
+
+            if (policy.maxDepth <= 0)
+                return Spectrum::Black(400,800,8);
+
+            auto i = world.intersect(ray);
+            Statistics::ray(Statistics::RayType::Camera, !!i);
+            if (!i)
+                return scene.background(ray.direction);
+            computeDifferentials(i->dg, ray);
+
+            const auto wo = -ray.direction;
+            auto const &bsdf = world.bsdf(*i, arena);
+
+            Spectrum L = world.directLighting(bsdf, *i, wo);
+            for (int s=0; s!=policy.splits; ++s) {
+                // Each split has its own range of vertex dimensions.
+                const auto dimension = Sampling::vertexDimension(s*policy.maxDepth);
+                sampler.setDimension(dimension + Sampling::bsdf_dimension);
+                const tuple<Direction, Spectrum, real> smp =
+                    bsdf.sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, sampler);
+                const auto r_pdf = get<2>(smp);
+                if (r_pdf <= 0)
+                    continue;
+                const auto wi = get<0>(smp);
+                auto throughput = get<1>(smp)
+                                * (dot(static_cast<Normal>(wi), i->dg.nn) / (r_pdf * policy.splits));
+                sampler.setDimension(dimension + Sampling::roulette_dimension);
+                if (survives(policy, 1, throughput, sampler))
+                    L += trace(Ray(offsetOrigin(i->dg, wi), wi), throughput, s, sampler, arena);
+            }
+            return L;
+        }
+
+    private:
+        // Continues a path at its second vertex.
+        Photometry::Spectrum trace (Geometry::Ray ray, Photometry::Spectrum throughput, int split,
+                                    Sampling::Sampler &sampler, MemoryArena &arena) const
+        {
+            using namespace Photometry;
+            using namespace Surface;
+            using namespace Geometry;
+            using std::tuple; using std::get;
+
+            Spectrum L = Spectrum::Black(400,800,8);
+            for (int depth=1; depth<policy.maxDepth; ++depth) {
+                const auto dimension = Sampling::vertexDimension(split*policy.maxDepth + depth);
+                const auto i = world.intersect(ray);
+                Statistics::ray(Statistics::RayType::Bounce, !!i);
+                if (!i) {
+                    L += throughput * scene.background(ray.direction);
+                    break;
+                }
+
+                const auto wo = -ray.direction;
+                auto const &bsdf = world.bsdf(*i, arena);
+                L += throughput * world.directLighting(bsdf, *i, wo);
+
+                if (depth+1 == policy.maxDepth)
+                    break;
+
+                sampler.setDimension(dimension + Sampling::bsdf_dimension);
+                const tuple<Direction, Spectrum, real> s =
+                    bsdf.sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, sampler);
+                const auto r_pdf = get<2>(s);
+                if (r_pdf <= 0)
+                    break;
+                const auto wi = get<0>(s);
+                throughput *= get<1>(s) * (dot(static_cast<Normal>(wi), i->dg.nn) / r_pdf);
+                sampler.setDimension(dimension + Sampling::roulette_dimension);
+                if (!survives(policy, depth+1, throughput, sampler))
+                    break;
+
+                ray = Ray(offsetOrigin(i->dg, wi), wi);
+            }
+            return L;
+        }
+
+    private:
+        PathPolicy policy;
+        Scene const &scene;
+        World world;
+    };
+
+    typedef BasicIterativePath<> IterativePath;
+} }
+
+#endif // ITERATIVEPATH_HH_INCLUDED_20130823
@@ -0,0 +1,185 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef MISPATH_HH_INCLUDED_20130824
+#define MISPATH_HH_INCLUDED_20130824
+
+#include "SurfaceIntegrators/IterativePath.hh"
+#include "Scene.hh"
+#include "Geometry/Ray.hh"
+#include "Intersection.hh"
+#include "Photometry/Lighting.hh"
+#include "Photometry/BSDF/BSDF.hh"
+#include "DifferentialGeometry.hh"
+#include "Statistics.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include <algorithm>
+
+namespace excyrender { namespace SurfaceIntegrators {
+
+    // Weight of a sample taken with density 'fPdf', when the same direction could also
+    // have been taken by a second strategy with density 'gPdf'. One sample per strategy.
+    inline real powerHeuristic(real fPdf, real gPdf) noexcept {
+        const real f = fPdf*fPdf, g = gPdf*gPdf;
+        return f+g > 0 ? f / (f+g) : 0;
+    }
+
+
+    // Path tracer with next event estimation: at every vertex, each light source and the
+    // background are sampled explicitly, and the BSDF sampled continuation only picks up
+    // background light where it is not already covered by light sampling. Light and BSDF
+    // samples of the background are combined with the power heuristic. Delta lights are
+    // only reachable by light sampling and get full weight.
+    //
+    // Depth, roulette and splitting are as in IterativePath.
+    class MISPath {
+    public:
+        // 'scene' must outlive the integrator.
+        MISPath (PathPolicy const &policy, Scene const &scene)
+            : policy(policy), scene(scene), primitive(scene.primitive()),
+              environment([&scene](Geometry::Direction const &d) { return scene.background(d); })
+        {
+            validate(policy);
+        }
+
+        // BSDFs are built in 'arena'; the caller resets it after each camera sample.
+        Photometry::Spectrum operator() (Geometry::RayDifferential const &ray, Sampling::Sampler &sampler,
+                                         MemoryArena &arena) const
+        {
+            using namespace Photometry;
+            using namespace Surface;
+            using namespace Geometry;
+            using std::tuple; using std::get;
+
+            if (policy.maxDepth <= 0)
+                return Spectrum::Black(400,800,8);
+
+            auto i = primitive.intersect(ray);
+            Statistics::ray(Statistics::RayType::Camera, !!i);
+            if (!i)
+                return scene.background(ray.direction);
+            computeDifferentials(i->dg, ray);
+
+            const auto wo = -ray.direction;
+            auto const &bsdf = i->material->bsdf(i->dg, arena);
+
+            Spectrum L = sampleLights(bsdf, *i, wo, Sampling::vertexDimension(0), sampler);
+            if (policy.maxDepth == 1)
+                return L;
+
+            for (int s=0; s!=policy.splits; ++s) {
+                // Each split has its own range of vertex dimensions.
+                const auto dimension = Sampling::vertexDimension(s*policy.maxDepth);
+                sampler.setDimension(dimension + Sampling::bsdf_dimension);
+                const tuple<Direction, Spectrum, real> smp =
+                    bsdf.sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, sampler);
+                const auto r_pdf = get<2>(smp);
+                if (r_pdf <= 0)
+                    continue;
+                const auto wi = get<0>(smp);
+                auto throughput = get<1>(smp)
+                                * (dot(static_cast<Normal>(wi), i->dg.nn) / (r_pdf * policy.splits));
+                sampler.setDimension(dimension + Sampling::roulette_dimension);
+                if (survives(policy, 1, throughput, sampler))
+                    L += trace(Ray(offsetOrigin(i->dg, wi), wi), throughput, s, i->dg, bsdf.pdf(i->dg, wo, wi),
+                               sampler, arena);
+            }
+            return L;
+        }
+
+    private:
+        // Continues a path at its second vertex. 'prevDg' and 'prevPdf' describe the
+        // vertex 'ray' leaves from and the BSDF density of ray.direction there (0 if
+        // specular).
+        Photometry::Spectrum trace (Geometry::Ray ray, Photometry::Spectrum throughput, int split,
+                                    DifferentialGeometry prevDg, real prevPdf,
+                                    Sampling::Sampler &sampler, MemoryArena &arena) const
+        {
+            using namespace Photometry;
+            using namespace Surface;
+            using namespace Geometry;
+            using std::tuple; using std::get;
+
+            Spectrum L = Spectrum::Black(400,800,8);
+            for (int depth=1; depth<policy.maxDepth; ++depth) {
+                const auto dimension = Sampling::vertexDimension(split*policy.maxDepth + depth);
+                const auto i = primitive.intersect(ray);
+                Statistics::ray(Statistics::RayType::Bounce, !!i);
+                if (!i) {
+                    const real w = prevPdf > 0
+                                 ? powerHeuristic(prevPdf, environment.pdf(prevDg, ray.direction))
+                                 : 1;
+                    L += throughput * environment(ray.direction) * w;
+                    break;
+                }
+
+                const auto wo = -ray.direction;
+                auto const &bsdf = i->material->bsdf(i->dg, arena);
+                L += throughput * sampleLights(bsdf, *i, wo, dimension, sampler);
+
+                if (depth+1 == policy.maxDepth)
+                    break;
+
+                sampler.setDimension(dimension + Sampling::bsdf_dimension);
+                const tuple<Direction, Spectrum, real> s =
+                    bsdf.sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, sampler);
+                const auto r_pdf = get<2>(s);
+                if (r_pdf <= 0)
+                    break;
+                const auto wi = get<0>(s);
+                throughput *= get<1>(s) * (dot(static_cast<Normal>(wi), i->dg.nn) / r_pdf);
+                sampler.setDimension(dimension + Sampling::roulette_dimension);
+                if (!survives(policy, depth+1, throughput, sampler))
+                    break;
+
+                prevPdf = bsdf.pdf(i->dg, wo, wi);
+                prevDg = i->dg;
+                ray = Ray(offsetOrigin(i->dg, wi), wi);
+            }
+            return L;
+        }
+
+        // One light sample per light source and one of the background. 'dimension' is
+        // the first sampler dimension of the vertex.
+        Photometry::Spectrum sampleLights (Photometry::Surface::BSDF const &bsdf,
+                                           Intersection const &i,
+                                           Geometry::Direction const &wo,
+                                           std::uint32_t dimension,
+                                           Sampling::Sampler &sampler) const
+        {
+            Photometry::Spectrum L = Photometry::Spectrum::Black(400,800,8);
+            sampler.setDimension(dimension + Sampling::light_dimension);
+            for (auto const &light : scene.lightSources())
+                L += estimate(*light, bsdf, i, wo, sampler);
+            L += estimate(environment, bsdf, i, wo, sampler);
+            return L;
+        }
+
+        Photometry::Spectrum estimate (Photometry::LightSource const &light,
+                                       Photometry::Surface::BSDF const &bsdf,
+                                       Intersection const &i,
+                                       Geometry::Direction const &wo,
+                                       Sampling::Sampler &sampler) const
+        {
+            using namespace Geometry;
+            const real u0 = sampler(), u1 = sampler();
+            const auto s = light.sample(i.dg, u0, u1);
+            const real cosTheta = dot(static_cast<Direction>(i.dg.nn), s.wi);
+            if (s.pdf <= 0 || cosTheta <= 0)
+                return Photometry::Spectrum::Black(400,800,8);
+            if (occluded(primitive, offsetOrigin(i.dg, s.wi), s))
+                return Photometry::Spectrum::Black(400,800,8);
+            const real w = s.delta ? 1 : powerHeuristic(s.pdf, bsdf.pdf(i.dg, wo, s.wi));
+            return bsdf.f(i.dg, wo, s.wi) * s.Li * (cosTheta * w / s.pdf);
+        }
+
+    private:
+        PathPolicy policy;
+        Scene const &scene;
+        Primitives::Primitive const &primitive;
+        Photometry::Environment environment;
+    };
+} }
+
+#endif // MISPATH_HH_INCLUDED_20130824
@@ -4,32 +4,36 @@
 #ifndef PATH_HH_INCLUDED_20130719
 #define PATH_HH_INCLUDED_20130719
 
-#include "Primitives/Primitive.hh"
+#include "Scene.hh"
 #include "Geometry/Ray.hh"
 #include "Intersection.hh"
 #include "Photometry/Lighting.hh"
 #include "Photometry/BSDF/BSDF.hh"
 #include "DifferentialGeometry.hh"
-#include "DebugPixel.hh"
+#include "Statistics.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
 
 namespace excyrender { namespace SurfaceIntegrators {
 
     class Path {
     public:
-        Path (int maxDepth, Primitives::Primitive const &prim,
-              std::vector<std::shared_ptr<Photometry::LightSource>> ls,
-              std::function<Photometry::Spectrum(Geometry::Direction const &)> background)
-            : maxDepth(maxDepth), primitive(prim), lightSources(ls), background(background)
+        // 'scene' must outlive the integrator.
+        Path (int maxDepth, Scene const &scene)
+            : maxDepth(maxDepth), scene(scene), primitive(scene.primitive())
         {
         }
 
-        Photometry::Spectrum operator() (Geometry::Ray const &ray, std::function<real()> rng) const
+        // BSDFs are built in 'arena'; the caller resets it after each camera sample.
+        Photometry::Spectrum operator() (Geometry::RayDifferential const &ray, Sampling::Sampler &sampler,
+                                         MemoryArena &arena) const
         {
-            return integrate(0, ray, rng);
+            return integrate(0, ray, sampler, arena);
         }
 
     private:
-        Photometry::Spectrum integrate (int currDepth, Geometry::Ray const &ray, std::function<real()> rng) const
+        Photometry::Spectrum integrate (int currDepth, Geometry::RayDifferential const &ray, Sampling::Sampler &sampler,
+                                        MemoryArena &arena) const
         {
             using namespace Photometry;
             using namespace Surface;
@@ -39,33 +43,35 @@ namespace excyrender { namespace SurfaceIntegrators {
             if (currDepth >= maxDepth)
                 return Spectrum::Black(400,800,8);
 
-            const auto i = primitive.intersect(ray);
+            auto i = primitive.intersect(ray);
+            Statistics::ray(currDepth ? Statistics::RayType::Bounce : Statistics::RayType::Camera, !!i);
             if (!i)
-                return background(ray.direction);
+                return scene.background(ray.direction);
+            computeDifferentials(i->dg, ray);
 
             const auto wo = -ray.direction;
 
+            auto const &bsdf = i->material->bsdf(i->dg, arena);
+            sampler.setDimension(Sampling::vertexDimension(currDepth) + Sampling::bsdf_dimension);
             const tuple<Direction, Spectrum, real> s =
-                i->material->bsdf(i->dg).sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, rng);
+                bsdf.sample_f(optional<BxDF::Distribution>(), optional<BxDF::ReflectionClass>(), i->dg, wo, sampler);
             const auto wi     = get<0>(s);
             const auto r_surf = get<1>(s);
             const auto r_pdf  = get<2>(s);
 
-            current_debug = 0;
-            const auto r_incoming = integrate(currDepth+1, Ray(i->dg.poi,wi), rng);
+            const auto r_incoming = integrate(currDepth+1, Ray(offsetOrigin(i->dg, wi), wi), sampler, arena);
             const auto reflection = (r_pdf<=0)
                                     ? (Spectrum::Black(400,800,8))
                                     : (r_surf * r_incoming * (dot(static_cast<Normal>(wi), i->dg.nn)/r_pdf));
 
-            const auto direct = directLighting (lightSources, primitive, *i, wo);
+            const auto direct = directLighting (scene.lightSources(), primitive, bsdf, *i, wo);
             return direct + reflection;
         }
 
     private:
         int maxDepth;
+        Scene const &scene;
         Primitives::Primitive const &primitive;
-        std::vector<std::shared_ptr<Photometry::LightSource>> lightSources;
-        std::function<Photometry::Spectrum(Geometry::Direction const &)> background;
     };
 } }
 
@@ -0,0 +1,52 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef WORLD_HH_INCLUDED_20130911
+#define WORLD_HH_INCLUDED_20130911
+
+#include "Scene.hh"
+#include "Intersection.hh"
+#include "MemoryArena.hh"
+#include "Photometry/Lighting.hh"
+#include "Photometry/BSDF/BSDF.hh"
+#include "Geometry/Ray.hh"
+#include "optional.hh"
+
+namespace excyrender { namespace SurfaceIntegrators {
+
+    // How integrators like BasicIterativePath get at intersections, BSDFs and direct
+    // light. This one works for any scene, through the virtual interfaces of
+    // Primitive, Material and BxDF; see ClosedWorld for the alternative.
+    class OpenWorld {
+    public:
+        typedef excyrender::Intersection Intersection;
+
+        // 'scene' must outlive the world.
+        explicit OpenWorld(Scene const &scene)
+            : scene(scene), primitive(scene.primitive())
+        {}
+
+        optional<Intersection> intersect(Geometry::Ray const &ray) const noexcept {
+            return primitive.intersect(ray);
+        }
+
+        // Built in 'arena'.
+        Photometry::Surface::BSDF const& bsdf(Intersection const &i, MemoryArena &arena) const noexcept {
+            return i.material->bsdf(i.dg, arena);
+        }
+
+        Photometry::Spectrum directLighting(Photometry::Surface::BSDF const &bsdf,
+                                            Intersection const &i,
+                                            Geometry::Direction const &wo) const noexcept
+        {
+            return Photometry::directLighting(scene.lightSources(), primitive, bsdf, i, wo);
+        }
+
+    private:
+        Scene const &scene;
+        Primitives::Primitive const &primitive;
+    };
+
+} }
+
+#endif // WORLD_HH_INCLUDED_20130911
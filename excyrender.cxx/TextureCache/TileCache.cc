@@ -0,0 +1,94 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "TextureCache/TileCache.hh"
+
+#include <algorithm>
+#include <sys/mman.h>
+
+namespace excyrender { namespace TextureCache {
+
+TileCache& TileCache::global() {
+    static TileCache cache(std::size_t(2) << 30);
+    return cache;
+}
+
+void TileCache::setBudget(std::size_t bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    budget_ = bytes;
+    evict(0);
+}
+
+std::size_t TileCache::budget() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return budget_;
+}
+
+TileCacheStats TileCache::stats() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void TileCache::reserve(std::size_t count) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    ring_.reserve(reserved_ + count);
+    reserved_ += count;
+}
+
+void TileCache::release(TileSlot *slots, std::size_t count) noexcept {
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (std::size_t i=0; i!=count; ++i) {
+        if (slots[i].resident.load(std::memory_order_relaxed)) {
+            unlink(slots[i]);
+            stats_.resident -= slots[i].bytes;
+        }
+    }
+    reserved_ -= count;
+}
+
+void TileCache::pageIn(TileSlot &slot) noexcept {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (slot.resident.load(std::memory_order_relaxed))
+            return;
+        evict(slot.bytes);
+        slot.ring = ring_.size();
+        ring_.push_back(&slot);   // within the capacity from reserve()
+        slot.referenced.store(true, std::memory_order_relaxed);
+        slot.resident.store(true, std::memory_order_relaxed);
+        stats_.resident += slot.bytes;
+        stats_.peak = std::max(stats_.peak, stats_.resident);
+        ++stats_.misses;
+    }
+    // One read for the whole tile instead of a fault per page.
+    ::madvise(const_cast<void*>(slot.data), slot.bytes, MADV_WILLNEED);
+}
+
+// Makes room for 'bytes' more. The caller holds the lock.
+void TileCache::evict(std::size_t bytes) noexcept {
+    while (!ring_.empty() && stats_.resident + bytes > budget_) {
+        if (hand_ >= ring_.size())
+            hand_ = 0;
+        TileSlot &s = *ring_[hand_];
+        if (s.referenced.load(std::memory_order_relaxed)) {
+            s.referenced.store(false, std::memory_order_relaxed);
+            ++hand_;
+            continue;
+        }
+        unlink(s);
+        stats_.resident -= s.bytes;
+        ++stats_.evictions;
+        ::madvise(const_cast<void*>(s.data), s.bytes, MADV_DONTNEED);
+    }
+}
+
+// Takes the slot out of the ring, by moving the last one into its place.
+void TileCache::unlink(TileSlot &slot) noexcept {
+    TileSlot *last = ring_.back();
+    ring_[slot.ring] = last;
+    last->ring = slot.ring;
+    ring_.pop_back();
+    slot.resident.store(false, std::memory_order_relaxed);
+}
+
+} }
@@ -0,0 +1,87 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TILECACHE_HH_INCLUDED_20130902
+#define TILECACHE_HH_INCLUDED_20130902
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace excyrender { namespace TextureCache {
+
+    // A tile of a memory mapped texture, as seen by the cache.
+    struct TileSlot {
+        void const *data = nullptr;     // page aligned
+        std::size_t bytes = 0;          // a multiple of the page size
+        std::atomic<bool> resident {false};
+        std::atomic<bool> referenced {false};
+        std::size_t ring = 0;           // index in TileCache::ring_ while resident
+
+        TileSlot() = default;
+        TileSlot(TileSlot const &) = delete;
+        TileSlot& operator= (TileSlot const &) = delete;
+    };
+
+    struct TileCacheStats {
+        std::uint64_t misses = 0, evictions = 0;
+        std::size_t resident = 0, peak = 0;   // bytes
+    };
+
+    // Keeps the tiles of memory mapped textures that are in use under a memory budget
+    // shared by all textures. Tiles are paged in by the kernel when first read; the
+    // cache counts them, and when over budget gives the least recently used ones back
+    // with madvise(MADV_DONTNEED). Recency is approximated with the clock algorithm, so
+    // that a hit is a relaxed atomic load, and no lock.
+    //
+    // Evicting a tile another thread is still reading from is harmless: its pages are
+    // read from the file again.
+    class TileCache final {
+    public:
+        explicit TileCache(std::size_t budget) : budget_(budget) {}
+        TileCache(TileCache const &) = delete;
+        TileCache& operator= (TileCache const &) = delete;
+
+        // The cache textures use unless given another one. Its budget is 2 GiB.
+        static TileCache& global();
+
+        void setBudget(std::size_t bytes);
+        std::size_t budget() const;
+        TileCacheStats stats() const;
+
+        // To be called before reading from the slot's data.
+        void touch(TileSlot &slot) noexcept {
+            if (slot.resident.load(std::memory_order_relaxed)) {
+                if (!slot.referenced.load(std::memory_order_relaxed))
+                    slot.referenced.store(true, std::memory_order_relaxed);
+                return;
+            }
+            pageIn(slot);
+        }
+
+        // Makes room for 'count' more slots, so that touch() never allocates. To be called
+        // once per texture, before its slots are touched. Throws std::bad_alloc.
+        void reserve(std::size_t count);
+
+        // Forgets the slots, e.g. before their texture is unmapped, and the room reserved
+        // for them.
+        void release(TileSlot *slots, std::size_t count) noexcept;
+
+    private:
+        void pageIn(TileSlot &slot) noexcept;
+        void evict(std::size_t bytes) noexcept;
+        void unlink(TileSlot &slot) noexcept;
+
+        mutable std::mutex mutex_;
+        std::size_t budget_;
+        std::vector<TileSlot*> ring_;   // capacity for all reserved slots
+        std::size_t reserved_ = 0;
+        std::size_t hand_ = 0;
+        TileCacheStats stats_;
+    };
+
+} }
+
+#endif // TILECACHE_HH_INCLUDED_20130902
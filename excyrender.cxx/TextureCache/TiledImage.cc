@@ -0,0 +1,225 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#include "TextureCache/TiledImage.hh"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace excyrender { namespace TextureCache {
+
+namespace {
+    const char magic[8] = {'E','X','C','Y','T','E','X','1'};
+    const std::uint32_t byteOrder = 0x01020304;
+    // Linux maps up to 64 KiB of cached pages around a faulting one; tiles aligned to
+    // that are paged in and out without their neighbours.
+    const std::size_t alignment = 65536;
+    // Keeps a tile, 4096^2 texels of 8 bytes, well within size_t, and a corrupt file from
+    // overflowing the offsets computed from it.
+    const std::uint32_t maxTileSize = 4096;
+
+    std::size_t align(std::size_t n) noexcept {
+        return (n + alignment-1) / alignment * alignment;
+    }
+
+    std::size_t bytesPerTexel(TexelFormat format) {
+        switch (format) {
+        case TexelFormat::U8:   return 4;
+        case TexelFormat::U16:  return 8;
+        case TexelFormat::Half: return 8;
+        }
+        throw std::runtime_error("unknown texel format");
+    }
+
+    std::size_t headerSize(std::size_t levels) noexcept {
+        return sizeof magic + 4*4 + levels * (4+4+8);
+    }
+
+    template <typename T>
+    void put(std::vector<char> &out, T const &v) {
+        char const *p = reinterpret_cast<char const*>(&v);
+        out.insert(out.end(), p, p + sizeof v);
+    }
+
+    template <typename T>
+    T get(char const *data, std::size_t &offset) {
+        T ret;
+        std::memcpy(&ret, data + offset, sizeof ret);
+        offset += sizeof ret;
+        return ret;
+    }
+
+    template <typename T>
+    T quantize(real v, real max) noexcept {
+        return T(std::min(std::max(v, real(0)), real(1)) * max + real(0.5));
+    }
+}
+
+
+void write(std::string const &path, unsigned int width, unsigned int height,
+           std::vector<Photometry::RGB> const &rgb, TexelFormat format, unsigned int tileSize)
+{
+    if (width == 0 || height == 0 || tileSize == 0 || tileSize > maxTileSize)
+        throw std::logic_error("TextureCache::write: width, height and tileSize must be positive, tileSize at most 4096");
+    if (rgb.size() != std::size_t(width) * height)
+        throw std::runtime_error("TextureCache::write: width*height is inequal to number of pixels passed");
+
+    struct Level {
+        unsigned int width, height;
+        std::vector<Photometry::RGB> texels;
+    };
+    std::vector<Level> levels;
+    levels.push_back(Level{width, height, rgb});
+    while (levels.back().width > 1 || levels.back().height > 1) {
+        Level const &prev = levels.back();
+        Level next;
+        next.texels = detail::mip::downsample(prev.texels, prev.width, prev.height,
+                                              next.width, next.height);
+        levels.push_back(std::move(next));
+    }
+
+    const std::size_t texel = bytesPerTexel(format),
+                      tileBytes = align(std::size_t(tileSize) * tileSize * texel);
+    std::vector<char> header(magic, magic + sizeof magic);
+    put(header, byteOrder);
+    put(header, std::uint32_t(format));
+    put(header, std::uint32_t(tileSize));
+    put(header, std::uint32_t(levels.size()));
+    std::uint64_t offset = align(headerSize(levels.size()));
+    for (auto const &l : levels) {
+        put(header, std::uint32_t(l.width));
+        put(header, std::uint32_t(l.height));
+        put(header, offset);
+        offset += (std::uint64_t(l.width) + tileSize-1) / tileSize
+                * ((std::uint64_t(l.height) + tileSize-1) / tileSize) * tileBytes;
+    }
+    header.resize(align(header.size()), 0);
+
+    std::ofstream f(path, std::ios::binary);
+    if (!f)
+        throw std::runtime_error("TextureCache::write: cannot open '" + path + "'");
+    f.write(header.data(), header.size());
+
+    std::vector<char> tile(tileBytes);
+    for (auto const &l : levels) {
+        for (unsigned int ty=0; ty<l.height; ty+=tileSize) {
+            for (unsigned int tx=0; tx<l.width; tx+=tileSize) {
+                std::fill(tile.begin(), tile.end(), 0);
+                const unsigned int w = std::min(tileSize, l.width - tx),
+                                   h = std::min(tileSize, l.height - ty);
+                for (unsigned int y=0; y!=h; ++y) {
+                    for (unsigned int x=0; x!=w; ++x) {
+                        Photometry::RGB const &c = l.texels[(ty+y)*l.width + tx+x];
+                        const real v[3] = {c.r, c.g, c.b};
+                        const std::size_t i = (y*tileSize + x) * 4;
+                        for (int k=0; k!=3; ++k) {
+                            switch (format) {
+                            case TexelFormat::U8:
+                                reinterpret_cast<std::uint8_t*>(tile.data())[i+k] = quantize<std::uint8_t>(v[k], 255);
+                                break;
+                            case TexelFormat::U16:
+                                reinterpret_cast<std::uint16_t*>(tile.data())[i+k] = quantize<std::uint16_t>(v[k], 65535);
+                                break;
+                            case TexelFormat::Half:
+                                reinterpret_cast<std::uint16_t*>(tile.data())[i+k] = detail::toHalf(v[k]);
+                                break;
+                            }
+                        }
+                    }
+                }
+                f.write(tile.data(), tile.size());
+            }
+        }
+    }
+    if (!f)
+        throw std::runtime_error("TextureCache::write: cannot write '" + path + "'");
+}
+
+
+TiledImage::TiledImage(std::string const &path, detail::ImageWrap wrap, TileCache &cache)
+    : cache_(cache), wrap_(wrap), map_(MAP_FAILED), size_(0), slotCount_(0)
+{
+    auto const fail = [&](std::string const &what) {
+        if (map_ != MAP_FAILED)
+            ::munmap(map_, size_);
+        return std::runtime_error("TiledImage: '" + path + "' " + what);
+    };
+
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+        throw fail(std::string("cannot be opened: ") + std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) == 0 && st.st_size > 0) {
+        size_ = st.st_size;
+        map_ = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    }
+    ::close(fd);
+    if (map_ == MAP_FAILED)
+        throw fail("cannot be mapped");
+
+    char const *data = static_cast<char const*>(map_);
+    if (size_ < headerSize(0) || std::memcmp(data, magic, sizeof magic) != 0)
+        throw fail("is not a tiled texture");
+    std::size_t offset = sizeof magic;
+    if (get<std::uint32_t>(data, offset) != byteOrder)
+        throw fail("has another byte order");
+    format_ = static_cast<TexelFormat>(get<std::uint32_t>(data, offset));
+    tileSize_ = get<std::uint32_t>(data, offset);
+    const std::uint32_t levels = get<std::uint32_t>(data, offset);
+    if (format_ != TexelFormat::U8 && format_ != TexelFormat::U16 && format_ != TexelFormat::Half)
+        throw fail("has an unknown texel format");
+    if (tileSize_ == 0 || tileSize_ > maxTileSize || levels == 0 || levels > 64 || size_ < headerSize(levels))
+        throw fail("is corrupt");
+
+    // The tiles of a level must lie within the file; compared by division, as the
+    // product of tile count and size can overflow for corrupt sizes.
+    const std::uint64_t tileBytes = align(std::size_t(tileSize_) * tileSize_ * bytesPerTexel(format_));
+    std::vector<std::uint64_t> firstTile;
+    for (std::uint32_t i=0; i!=levels; ++i) {
+        Level l;
+        l.width = get<std::uint32_t>(data, offset);
+        l.height = get<std::uint32_t>(data, offset);
+        l.tilesX = (std::uint64_t(l.width) + tileSize_-1) / tileSize_;
+        l.firstSlot = slotCount_;
+        const std::uint64_t first = get<std::uint64_t>(data, offset),
+                            tiles = std::uint64_t(l.tilesX) * ((std::uint64_t(l.height) + tileSize_-1) / tileSize_);
+        if (l.width == 0 || l.height == 0 || first % alignment || first > size_
+            || tiles > (size_ - first) / tileBytes)
+            throw fail("is corrupt");
+        slotCount_ += tiles;
+        levels_.push_back(l);
+        firstTile.push_back(first);
+    }
+
+    try {
+        slots_.reset(new TileSlot[slotCount_]);
+        cache_.reserve(slotCount_);
+    } catch (...) {
+        ::munmap(map_, size_);
+        throw;
+    }
+    for (std::uint32_t i=0; i!=levels; ++i) {
+        Level const &l = levels_[i];
+        const std::size_t tiles = (i+1 != levels ? levels_[i+1].firstSlot : slotCount_) - l.firstSlot;
+        for (std::size_t t=0; t!=tiles; ++t) {
+            TileSlot &slot = slots_[l.firstSlot + t];
+            slot.data = data + firstTile[i] + t*tileBytes;
+            slot.bytes = tileBytes;
+        }
+    }
+}
+
+TiledImage::~TiledImage() {
+    cache_.release(slots_.get(), slotCount_);
+    ::munmap(map_, size_);
+}
+
+} }
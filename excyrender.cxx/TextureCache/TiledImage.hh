@@ -0,0 +1,116 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef TILEDIMAGE_HH_INCLUDED_20130902
+#define TILEDIMAGE_HH_INCLUDED_20130902
+
+#include "real.hh"
+#include "Photometry/RGB.hh"
+#include "detail/MipFilter.hh"
+#include "detail/Half.hh"
+#include "TextureCache/TileCache.hh"
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace excyrender { namespace TextureCache {
+
+    enum class TexelFormat : std::uint32_t {
+        U8 = 1,     // 4 bytes per texel, [0,1]
+        U16 = 2,    // 8 bytes per texel, [0,1]
+        Half = 3    // 8 bytes per texel, high dynamic range
+    };
+
+    // Writes the mip pyramid of a width x height image to 'path', in tiles of
+    // tileSize x tileSize texels, tileSize at most 4096. Values are clamped to [0,1] for
+    // U8 and U16. Throws std::runtime_error.
+    //
+    // The file is (native byte order, checked when mapped):
+    //
+    //   char[8] "EXCYTEX1", uint32 0x01020304, format, tileSize, levels
+    //   per level: uint32 width, height, uint64 offset of its first tile
+    //   per level, the tiles row by row, each tileSize^2 RGBX texels padded to 64 KiB
+    //
+    // X is unused, for texels of 4 or 8 bytes and 128x128 tiles of exactly 64 or 128 KiB.
+    void write(std::string const &path, unsigned int width, unsigned int height,
+               std::vector<Photometry::RGB> const &rgb, TexelFormat format,
+               unsigned int tileSize = 128);
+
+
+    // A file written by write(), mapped into memory. Tiles are read on demand, and their
+    // memory is governed by 'cache'. Lookups are thread-safe.
+    class TiledImage final {
+    public:
+        // Throws std::runtime_error if 'path' cannot be mapped or is not such a file.
+        explicit TiledImage(std::string const &path,
+                            detail::ImageWrap wrap = detail::ImageWrap::Black,
+                            TileCache &cache = TileCache::global());
+        ~TiledImage();
+        TiledImage(TiledImage const &) = delete;
+        TiledImage& operator= (TiledImage const &) = delete;
+
+        TexelFormat format() const noexcept { return format_; }
+        unsigned int width()  const noexcept { return levels_[0].width; }
+        unsigned int height() const noexcept { return levels_[0].height; }
+
+        // See detail::mip::filtered().
+        Photometry::RGB filtered (real s, real t, real dsdx, real dtdx, real dsdy, real dtdy,
+                                  detail::ImageFilter filter = detail::ImageFilter::EWA) const
+        {
+            return detail::mip::filtered(*this, s, t, dsdx, dtdx, dsdy, dtdy, filter);
+        }
+
+        // Mip pyramid access, for detail::mip.
+        int levels() const noexcept { return levels_.size(); }
+        unsigned int levelWidth (int level)  const noexcept { return levels_[level].width; }
+        unsigned int levelHeight (int level) const noexcept { return levels_[level].height; }
+
+        Photometry::RGB texel (int level, int x, int y) const noexcept {
+            Level const &l = levels_[level];
+            if (!detail::wrapTexel(wrap_, x, y, l.width, l.height))
+                return Photometry::RGB();
+            const unsigned int tx = x / tileSize_, ty = y / tileSize_;
+            TileSlot &slot = slots_[l.firstSlot + ty*l.tilesX + tx];
+            cache_.touch(slot);
+            const std::size_t i = ((y - ty*tileSize_) * tileSize_ + (x - tx*tileSize_)) * 4;
+            switch (format_) {
+            case TexelFormat::U8: {
+                std::uint8_t const *p = static_cast<std::uint8_t const*>(slot.data) + i;
+                const real f = real(1) / 255;
+                return Photometry::RGB(p[0]*f, p[1]*f, p[2]*f);
+            }
+            case TexelFormat::U16: {
+                std::uint16_t const *p = static_cast<std::uint16_t const*>(slot.data) + i;
+                const real f = real(1) / 65535;
+                return Photometry::RGB(p[0]*f, p[1]*f, p[2]*f);
+            }
+            case TexelFormat::Half: {
+                std::uint16_t const *p = static_cast<std::uint16_t const*>(slot.data) + i;
+                return Photometry::RGB(detail::fromHalf(p[0]), detail::fromHalf(p[1]), detail::fromHalf(p[2]));
+            }
+            }
+            return Photometry::RGB();
+        }
+
+    private:
+        struct Level {
+            unsigned int width, height, tilesX;
+            std::size_t firstSlot;
+        };
+
+        TileCache &cache_;
+        detail::ImageWrap wrap_;
+        TexelFormat format_;
+        unsigned int tileSize_;
+        std::vector<Level> levels_;
+        void *map_;
+        std::size_t size_;
+        std::unique_ptr<TileSlot[]> slots_;
+        std::size_t slotCount_;
+    };
+
+} }
+
+#endif // TILEDIMAGE_HH_INCLUDED_20130902
@@ -5,15 +5,19 @@
 #define BUILDER_HH_INCLUDED_20130723
 
 #include "Data.hh"
+#include <iostream>
 
 namespace excyrender { namespace detail { namespace BIH {
 
     namespace detail {
-        template <typename T>
+        template <typename T, typename Objects>
         class Builder
         {
             typedef typename std::vector<T>::iterator iterator;
+            Objects const &objects;
         public:
+            explicit Builder(Objects const &objects) : objects(objects) {}
+
             void build(Data<T> &data, int max_depth)
             {
                 data.aabb = exact_aabb(data.objects.begin(), data.objects.end());
@@ -28,11 +32,11 @@ namespace excyrender { namespace detail { namespace BIH {
 
         private:
 
-            static AABB exact_aabb(iterator it, iterator end) {
+            AABB exact_aabb(iterator it, iterator end) const {
                 Geometry::Point Max(-real_max, -real_max, -real_max),
                         Min(real_max, real_max, real_max);
                 for ( ; it!=end; ++it) {
-                    const auto bb = aabb(*it);
+                    const auto bb = objects.aabb(*it);
                     Max.x = max(Max.x, right(bb));
                     Max.y = max(Max.y, top(bb));
                     Max.z = max(Max.z, back(bb));
@@ -53,24 +57,24 @@ namespace excyrender { namespace detail { namespace BIH {
                 return make_tuple(Min, Max);
             }*/
 
-            static real max_bound(iterator it, iterator end, int axis) {
+            real max_bound(iterator it, iterator end, int axis) const {
                 real Max = -real_max;
                 for (; it!=end; ++it)
-                    Max = max(Max, aabb(*it).max()[axis]);
+                    Max = max(Max, objects.aabb(*it).max()[axis]);
                 return Max;
             }
 
-            static real min_bound(iterator it, iterator end, int axis) {
+            real min_bound(iterator it, iterator end, int axis) const {
                 real Min = real_max;
                 for (; it!=end; ++it)
-                    Min = min(Min, aabb(*it).min()[axis]);
+                    Min = min(Min, objects.aabb(*it).min()[axis]);
                 return Min;
             }
 
-            static void build_node(const iterator first, const iterator last, AABB const &node_bb,
-                                   int r,
-                                   std::vector<Node> &nodes,
-                                   std::vector<typename Data<T>::object_group> &groups)
+            void build_node(const iterator first, const iterator last, AABB const &node_bb,
+                            int r,
+                            std::vector<Node> &nodes,
+                            std::vector<typename Data<T>::object_group> &groups) const
             {
                 using namespace Geometry;
 
@@ -92,7 +96,7 @@ namespace excyrender { namespace detail { namespace BIH {
                     // Find pivot object.
                     const real split_plane = center(node_bb, axis);
                     const auto pivot = std::partition (first, last, [&](T const &obj) {
-                            return center(aabb(obj))[axis] < split_plane; });
+                            return center(objects.aabb(obj))[axis] < split_plane; });
 
                     // Children bounding boxes, children, and current node finalization.
                     const auto children_bb = split(node_bb, axis);
@@ -108,11 +112,16 @@ namespace excyrender { namespace detail { namespace BIH {
         };
     }
 
-    template <typename T>
-    void build (Data<T> &data, int max_rec) {
+    template <typename T, typename Objects>
+    void build (Data<T> &data, int max_rec, Objects const &objects) {
         std::cerr << "building bih (" << data.objects.size() << " objects, "
                   << "T=" << typeid(T).name() << ")" << std::endl;
-        detail::Builder<T>().build(data, max_rec);
+        detail::Builder<T, Objects>(objects).build(data, max_rec);
+    }
+
+    template <typename T>
+    void build (Data<T> &data, int max_rec) {
+        build(data, max_rec, FreeFunctions<T>());
     }
 
 } } }
@@ -6,6 +6,7 @@
 
 #include "AABB.hh"
 #include "Node.hh"
+#include "Geometry/Ray.hh"
 #include <vector>
 
 namespace excyrender { namespace detail { namespace BIH {
@@ -25,6 +26,36 @@ namespace excyrender { namespace detail { namespace BIH {
         //using intersection_type = decltype(intersect(*((T*)(nullptr)), *(Geometry::Ray*(nullptr))));
     };
 
+
+    namespace detail {
+        // Outside of FreeFunctions, whose members would hide the free functions.
+        template <typename T>
+        inline AABB aabb_(T const &o) noexcept {
+            return aabb(o);
+        }
+
+        template <typename T>
+        inline auto intersect_(T const &o, Geometry::Ray const &ray) noexcept -> decltype(intersect(o, ray)) {
+            return intersect(o, ray);
+        }
+    }
+
+    // How build() and the traversers get at the bounding box and the intersection of an
+    // object. By default, through the free functions aabb(T) and intersect(T,Ray). Objects
+    // that make no sense on their own, as indices into a mesh, come with their own.
+    template <typename T>
+    struct FreeFunctions {
+        AABB aabb(T const &o) const noexcept {
+            return detail::aabb_(o);
+        }
+
+        auto intersect(T const &o, Geometry::Ray const &ray) const noexcept
+            -> decltype(detail::intersect_(o, ray))
+        {
+            return detail::intersect_(o, ray);
+        }
+    };
+
 } } }
 
 #endif
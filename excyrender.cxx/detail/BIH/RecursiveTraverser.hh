@@ -7,31 +7,24 @@
 #include "Node.hh"
 #include "Data.hh"
 #include "Geometry/Ray.hh"
+#include "Statistics.hh"
+#include <utility>
 
 namespace excyrender { namespace detail { namespace BIH {
 
-    namespace detail {
-        template <typename T>
-        struct RecursiveTraverserTraits {
-            using intersection_type = decltype(intersect(*((T*)nullptr),
-                                               *((Geometry::Ray*)nullptr)));
-
-            // "Import" some global functions to circumvent ADL-issues within RecursiveTraverser.
-            // Note how intersect has a suffix here.
-            static intersection_type intersect_(T const &o, Geometry::Ray const &ray) noexcept {
-                return intersect(o, ray);
-            }
-        };
-    }
-
-    template <typename T>
+    template <typename T, typename Objects = FreeFunctions<T>>
     class RecursiveTraverser {
         const Data<T> &data;
+        const Objects objects;
 
     public:
-        typedef typename detail::RecursiveTraverserTraits<T>::intersection_type intersection_type;
+        typedef decltype(std::declval<Objects const&>().intersect(std::declval<T const&>(),
+                                                                  std::declval<Geometry::Ray const&>()))
+                intersection_type;
 
-        RecursiveTraverser(Data<T> const &data) : data(data) {}
+        RecursiveTraverser(Data<T> const &data, Objects const &objects = Objects())
+            : data(data), objects(objects)
+        {}
 
         intersection_type intersect(Geometry::Ray const &ray) const noexcept
         {
@@ -61,25 +54,32 @@ namespace excyrender { namespace detail { namespace BIH {
         }
 
     private:
+        static intersection_type const& nearer(intersection_type const &a,
+                                               intersection_type const &b) noexcept
+        {
+            return b && (!a || distance(*b) < distance(*a)) ? b : a;
+        }
+
         intersection_type
          traverse_rec(Node const* node, Geometry::Ray const &ray, real A, real B, int &steps) const noexcept
         {
-            if (A > B) {
-
+            // A node flat on its axis, like one for a wall, has A == B but for rounding.
+            if (A > B * (1 + rounding_error)) {
                 return intersection_type();
             }
             ++steps;
+            Statistics::node();
 
             if (node->leaf())
             {
                 intersection_type nearest;
                 typename Data<T>::object_group g = data.object_groups[node->index()];
+                Statistics::tests(get<1>(g) - get<0>(g));
+                // Not clipped to [A,B]: a surface lying in a split plane is hit at the
+                // plane's t, give or take rounding, and half the time just outside.
                 for (auto it=get<0>(g), end=get<1>(g); it!=end; ++it) {
-                    if (auto tmp = detail::RecursiveTraverserTraits<T>::intersect_(*it, ray)) {
-                        const auto t = distance(*tmp);
-                        if (t<A || t>B)
-                            continue;
-                        if (!nearest || t < distance(*nearest)) {
+                    if (auto tmp = objects.intersect(*it, ray)) {
+                        if (!nearest || distance(*tmp) < distance(*nearest)) {
                             nearest = tmp;
                         }
                     }
@@ -97,15 +97,13 @@ namespace excyrender { namespace detail { namespace BIH {
                     if (a) B = min(B, distance(*a));
                     auto b = traverse_rec(node+node->index(), ray, max(t2,A), B, steps);
 
-                    if (b) return b; // We adjusted B for the far node, so any far-hit must be nearer than near-hit.
-                    return a;
+                    return nearer(a, b);
                 } else {
                     auto a = traverse_rec(node+node->index(), ray, A, min(t2,B), steps);
                     if (a) B = min(B, distance(*a));
                     auto b = traverse_rec(node+1, ray, max(t1,A), B, steps);
 
-                    if (b) return b; // We adjusted B for the far node, so any far-hit must be nearer than near-hit.
-                    return a;
+                    return nearer(a, b);
                 }
             }
             return intersection_type();
@@ -143,6 +141,39 @@ namespace excyrender { namespace detail { namespace BIH {
         return RecursiveTraverser<T>(data).occludes(a, b);
     }
 
+    // The same, for objects reached through 'objects' (see FreeFunctions).
+    template <typename T, typename Objects>
+    inline
+    typename RecursiveTraverser<T,Objects>::intersection_type
+      recursive_intersect(Data<T> const &data, Objects const &objects, Geometry::Ray const &ray) noexcept
+    {
+        return RecursiveTraverser<T,Objects>(data, objects).intersect(ray);
+    }
+
+    template <typename T, typename Objects>
+    inline
+    typename RecursiveTraverser<T,Objects>::intersection_type
+      recursive_intersect(Data<T> const &data, Objects const &objects, Geometry::Ray const &ray, int &steps) noexcept
+    {
+        return RecursiveTraverser<T,Objects>(data, objects).intersect(ray, steps);
+    }
+
+    template <typename T, typename Objects>
+    inline
+    bool recursive_occludes(Data<T> const &data, Objects const &objects,
+                            Geometry::Point const &a, Geometry::Point const &b) noexcept
+    {
+        return RecursiveTraverser<T,Objects>(data, objects).occludes(a, b);
+    }
+
+    template <typename T, typename Objects>
+    inline
+    bool recursive_occludes(Data<T> const &data, Objects const &objects,
+                            Geometry::Point const &a, Geometry::Direction const &b) noexcept
+    {
+        return RecursiveTraverser<T,Objects>(data, objects).occludes(a, b);
+    }
+
 
 } } }
 
@@ -0,0 +1,71 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef HALF_HH_INCLUDED_20130902
+#define HALF_HH_INCLUDED_20130902
+
+#include <cstdint>
+#include <cstring>
+
+namespace excyrender { namespace detail {
+
+    // IEEE 754 binary16, as in OpenEXR. Rounds to nearest even; values beyond the range
+    // become infinity, NaN stays NaN.
+    inline std::uint16_t toHalf (float f) noexcept {
+        std::uint32_t x;
+        std::memcpy(&x, &f, sizeof x);
+        const std::uint32_t sign = (x >> 16) & 0x8000,
+                            exponent = (x >> 23) & 0xff;
+        std::uint32_t mantissa = x & 0x7fffff;
+
+        if (exponent == 0xff)
+            return sign | 0x7c00 | (mantissa ? 0x200 : 0);
+        const int e = int(exponent) - 127 + 15;
+        if (e >= 0x1f)
+            return sign | 0x7c00;
+        if (e <= 0) {
+            if (e < -10)
+                return sign;
+            // Denormal: shift the mantissa, with its implicit 1, into place.
+            mantissa |= 0x800000;
+            const int shift = 14 - e;
+            std::uint32_t h = mantissa >> shift;
+            const std::uint32_t rest = mantissa & ((1u << shift) - 1),
+                                half = 1u << (shift - 1);
+            if (rest > half || (rest == half && (h & 1)))
+                ++h;
+            return sign | h;
+        }
+        std::uint32_t h = (std::uint32_t(e) << 10) | (mantissa >> 13);
+        const std::uint32_t rest = mantissa & 0x1fff;
+        if (rest > 0x1000 || (rest == 0x1000 && (h & 1)))
+            ++h;  // may carry into the exponent, up to infinity, which is right
+        return sign | h;
+    }
+
+    inline float fromHalf (std::uint16_t h) noexcept {
+        const std::uint32_t sign = std::uint32_t(h & 0x8000) << 16,
+                            exponent = (h >> 10) & 0x1f;
+        std::uint32_t mantissa = h & 0x3ff, x;
+        if (exponent == 0x1f) {
+            x = sign | 0x7f800000 | (mantissa << 13);
+        } else if (exponent) {
+            x = sign | ((exponent + 127 - 15) << 23) | (mantissa << 13);
+        } else if (mantissa) {
+            int e = 127 - 15 + 1;
+            while (!(mantissa & 0x400)) {
+                mantissa <<= 1;
+                --e;
+            }
+            x = sign | (std::uint32_t(e) << 23) | ((mantissa & 0x3ff) << 13);
+        } else {
+            x = sign;
+        }
+        float f;
+        std::memcpy(&f, &x, sizeof f);
+        return f;
+    }
+
+} }
+
+#endif // HALF_HH_INCLUDED_20130902
@@ -23,25 +23,28 @@
 
 #include "real.hh"
 #include "Photometry/RGB.hh"
+#include "detail/MipFilter.hh"
 #include <SDL/SDL.h>
 #include <SDL/SDL_image.h>
+#include <algorithm>
 #include <cmath>
 #include <vector>
 
 namespace excyrender { namespace detail {
 
-enum class ImageWrap {
-    Wrap,
-    Black,
-    Clamp
-};
-
 class Image {
         std::vector<Photometry::RGB> h;
         std::vector<real> alpha_;
         unsigned int width_, height_;
         ImageWrap wrap;
 
+        // Levels 1.. of the mip pyramid; level 0 is 'h'.
+        struct Level {
+                unsigned int width, height;
+                std::vector<Photometry::RGB> texels;
+        };
+        std::vector<Level> mips_;
+
         static Uint32 getPixel (SDL_Surface *s, unsigned int x, unsigned int y) {
                 switch (s->format->BytesPerPixel) {
                 case 1: return ((Uint8*)s->pixels)[x + y*s->pitch];
@@ -117,6 +120,7 @@ public:
 
                         }
                         SDL_FreeSurface(image);
+                        buildPyramid();
                         return true;
                 }
                 return false;
@@ -136,21 +140,7 @@ public:
 
 
         Photometry::RGB at (int x, int y) const {
-                if ((x<0) | (x>=(int)width_) | (y<0) | (y>=(int)height_)) {
-                        switch (wrap) {
-                        case ImageWrap::Black:
-                            return Photometry::RGB();
-                        case ImageWrap::Wrap:
-                            x = wrap_num(x, width_);
-                            y = wrap_num(y, height_);
-                            break;
-                        case ImageWrap::Clamp:
-                            x = clamp_num(x, width_);
-                            y = clamp_num(y, height_);
-                            break;
-                        }
-                }
-                return h[y*width_ + x];
+                return texel(0, x, y);
         }
 
         real alpha_at (int x, int y) const {
@@ -223,74 +213,60 @@ public:
                         +v*((1-u)*at(a,d) + u*at(c,d)) ;
         }
 
-private:
-        static Photometry::RGB cubic (Photometry::RGB v0,
-                            Photometry::RGB v1,
-                            Photometry::RGB v2,
-                            Photometry::RGB v3,
-                            real x) {
-            const Photometry::RGB
-                    P = (v3 - v2) - (v0 - v1),
-                    Q = (v0 - v1) - P,
-                    R = v2 - v0,
-                    S = v1
-                    ;
-            return P*x*x*x + Q*x*x + R*x + S;
-        }
 public:
 
         Photometry::RGB cubic (real x, real y) const {
-                // as per http://freespace.virgin.net/hugo.elias/models/m_perlin.htm
-                const real
-                        wx = x * (width_-1),
-                        wy = y * (height_-1);
-                const int
-                        x0 = -1 + (int)(wx),
-                        y0 = -1 + (int)(wy),
-                        x1 = (int)(wx),
-                        y1 = (int)(wy),
-                        x2 = 1 + (int)(wx),
-                        y2 = 1 + (int)(wy),
-                        x3 = 2 + (int)(wx),
-                        y3 = 2 + (int)(wy)
-                        ;
-                const real
-                        u = wx - x1,
-                        v = wy - y1
-                        ;
-                const Photometry::RGB
-                        a0 = at(x0, y0),
-                        a1 = at(x1, y0),
-                        a2 = at(x2, y0),
-                        a3 = at(x3, y0),
-
-                        b0 = at(x0, y1),
-                        b1 = at(x1, y1),
-                        b2 = at(x2, y1),
-                        b3 = at(x3, y1),
-
-                        c0 = at(x0, y2),
-                        c1 = at(x1, y2),
-                        c2 = at(x2, y2),
-                        c3 = at(x3, y2),
-
-                        d0 = at(x0, y3),
-                        d1 = at(x1, y3),
-                        d2 = at(x2, y3),
-                        d3 = at(x3, y3),
-
-                        a = cubic(a0, a1, a2, a3, u),
-                        b = cubic(b0, b1, b2, b3, u),
-                        c = cubic(c0, c1, c2, c3, u),
-                        d = cubic(d0, d1, d2, d3, u),
-                        h = cubic(a, b, c, d, v)
-                        ;
-                return h;
+                return mip::cubicAt(*this, x * (width_-1), y * (height_-1));
+        }
+
+        // See mip::filtered(). Unlike cubic() and lerp(), texel centers are at
+        // (i+0.5)/width.
+        Photometry::RGB filtered (real s, real t,
+                                  real dsdx, real dtdx, real dsdy, real dtdy,
+                                  ImageFilter filter = ImageFilter::EWA) const
+        {
+                return mip::filtered(*this, s, t, dsdx, dtdx, dsdy, dtdy, filter);
+        }
+
+        // Number of mip levels, including the image itself.
+        int levels() const {
+                return 1 + mips_.size();
         }
 
         Photometry::RGB nearest (real x, real y) const {
                 return at((int)(0.5 + x * (width_-1)), (int)(0.5 + y * (height_-1)));
         }
+
+        // Mip pyramid access, for mip::.
+        Photometry::RGB texel (int level, int x, int y) const {
+                std::vector<Photometry::RGB> const &texels = level ? mips_[level-1].texels : h;
+                const int w = level ? mips_[level-1].width : width_,
+                          ht = level ? mips_[level-1].height : height_;
+                if (!wrapTexel(wrap, x, y, w, ht))
+                        return Photometry::RGB();
+                return texels[y*w + x];
+        }
+
+        unsigned int levelWidth (int level) const {
+                return level ? mips_[level-1].width : width_;
+        }
+        unsigned int levelHeight (int level) const {
+                return level ? mips_[level-1].height : height_;
+        }
+
+private:
+        void buildPyramid () {
+                mips_.clear();
+                unsigned int w = width_, ht = height_;
+                while (w > 1 || ht > 1) {
+                        Level l;
+                        l.texels = mip::downsample(mips_.empty() ? h : mips_.back().texels,
+                                                   w, ht, l.width, l.height);
+                        w = l.width;
+                        ht = l.height;
+                        mips_.push_back(std::move(l));
+                }
+        }
 };
 
 } }
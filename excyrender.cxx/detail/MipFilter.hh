@@ -0,0 +1,253 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef MIPFILTER_HH_INCLUDED_20130901
+#define MIPFILTER_HH_INCLUDED_20130901
+
+#include "real.hh"
+#include "Photometry/RGB.hh"
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace excyrender { namespace detail {
+
+    enum class ImageWrap {
+        Wrap,
+        Black,
+        Clamp
+    };
+
+    // How mip::filtered() averages over footprints larger than a texel.
+    enum class ImageFilter {
+        Trilinear,  // isotropic, sized by the longer axis of the footprint: blurry at grazing angles
+        EWA         // elliptically weighted average: anisotropic, up to 8:1
+    };
+
+    // Moves (x,y) into a w x h image. Returns false if the texel is black.
+    inline bool wrapTexel (ImageWrap wrap, int &x, int &y, int w, int h) noexcept {
+        if ((x<0) | (x>=w) | (y<0) | (y>=h)) {
+            switch (wrap) {
+            case ImageWrap::Black:
+                return false;
+            case ImageWrap::Wrap:
+                x = x<0 ? (x + w * (-x / w + 1)) % w : x % w;
+                y = y<0 ? (y + h * (-y / h + 1)) % h : y % h;
+                break;
+            case ImageWrap::Clamp:
+                x = x < 0 ? 0 : x >= w ? w-1 : x;
+                y = y < 0 ? 0 : y >= h ? h-1 : y;
+                break;
+            }
+        }
+        return true;
+    }
+
+
+    // Lookups in a mip pyramid 'Image', which has
+    //
+    //   Photometry::RGB texel(int level, int x, int y) const;   // wrapped
+    //   unsigned int levelWidth(int level) const, levelHeight(int level) const;
+    //   int levels() const;
+    //
+    // (s,t) are such that texel centers of a level are at ((i+0.5)/width, (j+0.5)/height),
+    // so that s in [0,1) covers the image exactly once.
+    namespace mip {
+
+        inline real sq (real x) noexcept { return x*x; }
+
+        // Next level of a pyramid: half the size, rounded down but at least 1, each texel
+        // the box filtered average of the 2x2 (3 at odd borders) texels it covers.
+        template <typename T>
+        std::vector<T> downsample (std::vector<T> const &src, unsigned int w, unsigned int h,
+                                   unsigned int &dw, unsigned int &dh)
+        {
+            dw = std::max(1u, w/2);
+            dh = std::max(1u, h/2);
+            std::vector<T> dst(dw * dh);
+            for (unsigned int y=0; y!=dh; ++y) {
+                const unsigned int y0 = y*h/dh, y1 = (y+1)*h/dh;
+                for (unsigned int x=0; x!=dw; ++x) {
+                    const unsigned int x0 = x*w/dw, x1 = (x+1)*w/dw;
+                    T sum = T();
+                    for (unsigned int v=y0; v!=y1; ++v)
+                        for (unsigned int u=x0; u!=x1; ++u)
+                            sum += src[v*w + u];
+                    dst[y*dw + x] = sum * (real(1) / ((x1-x0) * (y1-y0)));
+                }
+            }
+            return dst;
+        }
+
+        inline Photometry::RGB cubic (Photometry::RGB v0, Photometry::RGB v1,
+                                      Photometry::RGB v2, Photometry::RGB v3, real x) noexcept
+        {
+            const Photometry::RGB
+                    P = (v3 - v2) - (v0 - v1),
+                    Q = (v0 - v1) - P,
+                    R = v2 - v0,
+                    S = v1;
+            return P*x*x*x + Q*x*x + R*x + S;
+        }
+
+        // (wx,wy) in texels of level 0.
+        template <typename Image>
+        Photometry::RGB cubicAt (Image const &img, real wx, real wy) {
+            // as per http://freespace.virgin.net/hugo.elias/models/m_perlin.htm
+            const int x1 = (int)std::floor(wx), y1 = (int)std::floor(wy),
+                      x0 = x1 - 1, y0 = y1 - 1,
+                      x2 = x1 + 1, y2 = y1 + 1,
+                      x3 = x1 + 2, y3 = y1 + 2;
+            const real u = wx - x1,
+                       v = wy - y1;
+            auto const row = [&](int y) {
+                return cubic(img.texel(0,x0,y), img.texel(0,x1,y), img.texel(0,x2,y), img.texel(0,x3,y), u);
+            };
+            return cubic(row(y0), row(y1), row(y2), row(y3), v);
+        }
+
+        template <typename Image>
+        Photometry::RGB bilinear (Image const &img, int level, real s, real t) {
+            const real wx = s * img.levelWidth(level) - real(0.5),
+                       wy = t * img.levelHeight(level) - real(0.5);
+            const int x = (int)std::floor(wx),
+                      y = (int)std::floor(wy);
+            const real u = wx - x,
+                       v = wy - y;
+            return (1-v)*((1-u)*img.texel(level,x,y)   + u*img.texel(level,x+1,y))
+                    + v*((1-u)*img.texel(level,x,y+1) + u*img.texel(level,x+1,y+1));
+        }
+
+        // 'size' is the footprint width in (s,t) units.
+        template <typename Image>
+        Photometry::RGB trilinear (Image const &img, real s, real t, real size) {
+            const real lod = std::log2(size * std::max(img.levelWidth(0), img.levelHeight(0)));
+            const int last = img.levels() - 1;
+            if (!(lod > 0))
+                return bilinear(img, 0, s, t);
+            if (lod >= last)
+                return bilinear(img, last, s, t);
+            const int l = (int)lod;
+            const real f = lod - l;
+            return (1-f)*bilinear(img, l, s, t) + f*bilinear(img, l+1, s, t);
+        }
+
+        // Longest axis of an EWA footprint over its shortest, and the largest half extent
+        // in texels this gives at the level chosen by the shortest (under 2 texels there,
+        // plus 1 for the texel itself).
+        constexpr real ewaMaxAnisotropy = 8,
+                       ewaMaxRadius = 2*ewaMaxAnisotropy + 2;
+
+        template <typename Image>
+        Photometry::RGB ewaAt (Image const &img, int level, real s, real t,
+                               real ds0, real dt0, real ds1, real dt1)
+        {
+            const real w = img.levelWidth(level), h = img.levelHeight(level),
+                       x = s*w - real(0.5),
+                       y = t*h - real(0.5);
+            ds0 *= w; dt0 *= h;
+            ds1 *= w; dt1 *= h;
+
+            // Implicit ellipse A*s^2 + B*s*t + C*t^2 = 1 through the axes; the +1 keeps
+            // it at least a texel wide.
+            real A = dt0*dt0 + dt1*dt1 + 1,
+                 B = -2 * (ds0*dt0 + ds1*dt1),
+                 C = ds0*ds0 + ds1*ds1 + 1;
+            const real invF = 1 / (A*C - B*B*real(0.25));
+            A *= invF;
+            B *= invF;
+            C *= invF;
+
+            const real det = -B*B + 4*A*C,
+                       invDet = 1 / det,
+                       uSqrt = std::sqrt(det * C),
+                       vSqrt = std::sqrt(A * det);
+            // Half extents of the bounding box, clamped to what ewa() can ask for before
+            // they become ints; degenerate (infinite, NaN) ellipses get no weights and
+            // fall back to bilinear below.
+            auto const bound = [](real r) { return r <= ewaMaxRadius ? r : ewaMaxRadius; };
+            const real ru = bound(2 * invDet * uSqrt),
+                       rv = bound(2 * invDet * vSqrt);
+            const int x0 = (int)std::ceil (x - ru),
+                      x1 = (int)std::floor(x + ru),
+                      y0 = (int)std::ceil (y - rv),
+                      y1 = (int)std::floor(y + rv);
+
+            const real alpha = 2, cutoff = std::exp(-alpha);
+            Photometry::RGB sum;
+            real weights = 0;
+            for (int iy=y0; iy<=y1; ++iy) {
+                const real dy = iy - y;
+                for (int ix=x0; ix<=x1; ++ix) {
+                    const real dx = ix - x,
+                               r2 = A*dx*dx + B*dx*dy + C*dy*dy;
+                    if (r2 < 1) {
+                        const real weight = std::exp(-alpha * r2) - cutoff;
+                        sum += img.texel(level, ix, iy) * weight;
+                        weights += weight;
+                    }
+                }
+            }
+            return weights > 0 ? sum * (1 / weights) : bilinear(img, level, s, t);
+        }
+
+        // Elliptically weighted average with a Gaussian, as in PBRT (Heckbert 1989). The
+        // level is chosen by the minor axis, which is lengthened where needed to keep the
+        // number of texels bounded.
+        template <typename Image>
+        Photometry::RGB ewa (Image const &img, real s, real t,
+                             real ds0, real dt0, real ds1, real dt1)
+        {
+            if (sq(ds0) + sq(dt0) < sq(ds1) + sq(dt1)) {
+                std::swap(ds0, ds1);
+                std::swap(dt0, dt1);
+            }
+            const real major = std::sqrt(sq(ds0) + sq(dt0));
+            real minor = std::sqrt(sq(ds1) + sq(dt1));
+            if (minor * ewaMaxAnisotropy < major && minor > 0) {
+                const real scale = major / (minor * ewaMaxAnisotropy);
+                ds1 *= scale;
+                dt1 *= scale;
+                minor *= scale;
+            }
+            if (minor == 0)
+                return bilinear(img, 0, s, t);
+
+            const real lod = std::max(real(0), std::log2(minor * std::max(img.levelWidth(0), img.levelHeight(0))));
+            const int last = img.levels() - 1;
+            // Beyond the coarsest level, the ellipse would cost its area in texels.
+            if (!(lod < last))
+                return bilinear(img, last, s, t);
+            const int l = (int)lod;
+            const real f = lod - l;
+            if (f == 0)
+                return ewaAt(img, l, s, t, ds0, dt0, ds1, dt1);
+            return (1-f)*ewaAt(img, l, s, t, ds0, dt0, ds1, dt1)
+                    + f*ewaAt(img, l+1, s, t, ds0, dt0, ds1, dt1);
+        }
+
+        // Lookup at (s,t) over the parallelogram spanned by (dsdx,dtdx) and (dsdy,dtdy),
+        // the change of (s,t) over one pixel. Footprints up to a texel (and unknown ones,
+        // i.e. zero) are magnified bicubically, larger ones are filtered from the pyramid.
+        template <typename Image>
+        Photometry::RGB filtered (Image const &img, real s, real t,
+                                  real dsdx, real dtdx, real dsdy, real dtdy,
+                                  ImageFilter filter)
+        {
+            const real w = img.levelWidth(0), h = img.levelHeight(0),
+                       lx = std::sqrt(sq(dsdx*w) + sq(dtdx*h)),
+                       ly = std::sqrt(sq(dsdy*w) + sq(dtdy*h));
+            if (!(std::max(lx, ly) > 1))
+                return cubicAt(img, s*w - real(0.5), t*h - real(0.5));
+            if (filter == ImageFilter::Trilinear) {
+                const real size = 2 * std::max(std::max(std::fabs(dsdx), std::fabs(dtdx)),
+                                               std::max(std::fabs(dsdy), std::fabs(dtdy)));
+                return trilinear(img, s, t, size);
+            }
+            return ewa(img, s, t, dsdx, dtdx, dsdy, dtdy);
+        }
+    }
+
+} }
+
+#endif // MIPFILTER_HH_INCLUDED_20130901
@@ -0,0 +1,114 @@
+// (C) 2013 Sebastian Mach (1983), this file is published under the terms of the
+// GNU General Public License, Version 3 (a.k.a. GPLv3).
+// See COPYING in the root-folder of the excygen project folder.
+#ifndef VARIANT_HH_INCLUDED_20130910
+#define VARIANT_HH_INCLUDED_20130910
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace excyrender { namespace detail {
+
+    // A list of types, as template argument.
+    template <typename ...Ts> struct Types {};
+
+    namespace variant {
+        template <typename T, typename ...Ts> struct IndexOf;
+        template <typename T> struct IndexOf<T> { static constexpr int value = -1; };
+        template <typename T, typename ...Ts> struct IndexOf<T, T, Ts...> { static constexpr int value = 0; };
+        template <typename T, typename U, typename ...Ts> struct IndexOf<T, U, Ts...> {
+            static constexpr int value = IndexOf<T, Ts...>::value < 0 ? -1 : 1 + IndexOf<T, Ts...>::value;
+        };
+
+        template <typename ...Ts> struct Max;
+        template <> struct Max<> {
+            static constexpr std::size_t size = 1, align = 1;
+        };
+        template <typename T, typename ...Ts> struct Max<T, Ts...> {
+            static constexpr std::size_t size = sizeof(T) > Max<Ts...>::size ? sizeof(T) : Max<Ts...>::size,
+                                         align = alignof(T) > Max<Ts...>::align ? alignof(T) : Max<Ts...>::align;
+        };
+
+        // An if per type, on constant indices, which compilers make a jump table of. The
+        // last type needs no test.
+        template <int I, typename ...Ts> struct Dispatch;
+        template <int I, typename T> struct Dispatch<I, T> {
+            template <typename F>
+            static auto apply(int, void const *p, F &&f) -> decltype(f(std::declval<T const&>())) {
+                return f(*static_cast<T const*>(p));
+            }
+        };
+        template <int I, typename T, typename ...Ts> struct Dispatch<I, T, Ts...> {
+            template <typename F>
+            static auto apply(int index, void const *p, F &&f) -> decltype(f(std::declval<T const&>())) {
+                if (index == I)
+                    return f(*static_cast<T const*>(p));
+                return Dispatch<I+1, Ts...>::apply(index, p, std::forward<F>(f));
+            }
+        };
+
+        struct Destroy {
+            template <typename T> void operator() (T const &v) const noexcept { v.~T(); }
+        };
+        struct CopyTo {
+            void *p;
+            template <typename T> void operator() (T const &v) const { new (p) T(v); }
+        };
+    }
+
+
+    // One value of any of the types Ts, and which one it is: a closed set of types,
+    // dispatched without virtual calls. visit() calls a function object with the value, as
+    // its actual type; each call can be inlined.
+    template <typename ...Ts>
+    class Variant final {
+    public:
+        template <typename T, typename = typename std::enable_if<(variant::IndexOf<T, Ts...>::value >= 0)>::type>
+        Variant(T const &value) : index_(variant::IndexOf<T, Ts...>::value) {
+            new (&storage_) T(value);
+        }
+
+        Variant(Variant const &rhs) : index_(rhs.index_) {
+            rhs.visit(variant::CopyTo{&storage_});
+        }
+
+        Variant& operator= (Variant const &rhs) {
+            if (this != &rhs) {
+                visit(variant::Destroy());
+                index_ = rhs.index_;
+                rhs.visit(variant::CopyTo{&storage_});
+            }
+            return *this;
+        }
+
+        ~Variant() {
+            visit(variant::Destroy());
+        }
+
+        // Position of the type of the value in Ts.
+        int index() const noexcept {
+            return index_;
+        }
+
+        // The value if it is a T, else null.
+        template <typename T>
+        T const* get() const noexcept {
+            return index_ == variant::IndexOf<T, Ts...>::value ? reinterpret_cast<T const*>(&storage_) : nullptr;
+        }
+
+        // f(value). All overloads of f must return the same type.
+        template <typename F>
+        auto visit(F &&f) const -> decltype(variant::Dispatch<0, Ts...>::apply(0, nullptr, std::forward<F>(f))) {
+            return variant::Dispatch<0, Ts...>::apply(index_, &storage_, std::forward<F>(f));
+        }
+
+    private:
+        typename std::aligned_storage<variant::Max<Ts...>::size, variant::Max<Ts...>::align>::type storage_;
+        int index_;
+    };
+
+} }
+
+#endif // VARIANT_HH_INCLUDED_20130910
@@ -4,17 +4,22 @@
 
 #include "Photometry/RGB.hh"
 #include "ImageFormat/PPM.hh"
+#include "ImageFormat/TileWriter.hh"
 #include "Geometry/Ray.hh"
 #include "Geometry/Direction.hh"
 #include "Photometry/CIEMatchingCurves.hh"
 #include "Photometry/ColorSpace.hh"
 
 #include "SurfaceIntegrators/Path.hh"
+#include "SurfaceIntegrators/IterativePath.hh"
+#include "Scene.hh"
 
 #include "Shapes/Sphere.hh"
 #include "Shapes/Plane.hh"
 #include "Shapes/Triangle.hh"
 #include "Shapes/Terrain2d.hh"
+#include "Shapes/TriangleMesh.hh"
+#include "MeshFormat/ReadMesh.hh"
 #include "Primitives/PrimitiveList.hh"
 #include "Primitives/PrimitiveFromShape.hh"
 #include "Primitives/PrimitiveFromFiniteShape.hh"
@@ -29,91 +34,150 @@
 #include "Photometry/Texture/AddTexture.hh"
 #include "Photometry/Texture/LerpTexture.hh"
 #include "Photometry/Texture/ImageTexture.hh"
+#include "TextureCache/TiledImage.hh"
 
 #include "Primitives/BoundingIntervalHierarchy.hh"
-#include "DebugPixel.hh"
+#include "Statistics.hh"
+#include "MemoryArena.hh"
+#include "Sampling/Sampler.hh"
+#include "Rendering/Adaptive.hh"
+#include "Rendering/TileScheduler.hh"
+#include "Rendering/AOV.hh"
+#include "Rendering/Progressive.hh"
+#include "Rendering/Distributed.hh"
 
 #include "Scripting/Et1.hh"
 
+#include <atomic>
+#include <csignal>
+#include <fstream>
 #include <iostream>
+#include <sstream>
+#include <string>
 #include <functional>
 #include <vector>
 #include <memory>
-#include <ctime>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <omp.h>
 
 namespace excyrender {
 
-    class RNG {
-    public:
-        RNG(uint_fast32_t seed)
-            : data(new data_t{mt19937(seed),
-                              uniform_real_distribution(0,real(1))})
-        {
-        }
-
-        real operator() () {
-            return data->d(data->mt);
-        }
-
-    private:
-        struct data_t {
-            mt19937 mt;
-            uniform_real_distribution d;
-        };
-        std::shared_ptr<data_t> data;
-    };
-
+    // 'camera' and 'integrate' are as for Rendering::render_adaptive().
+    //
+    // Each of 'pixels', 'writer' and 'statistics' may be null. Tiles go to 'writer' as soon
+    // as they are done, so with only a writer, the frame is never held in memory.
+    template <typename Camera, typename Integrator>
     void raytrace (int width, int height, int samples_per_pixel,
-                   std::function<Photometry::Spectrum(Geometry::Ray const &, std::function<float()>)> integrate,
-                   std::vector<Photometry::RGB> &pixels,
-                   std::vector<DebugPixel> &debug)
+                   Sampling::Sequence sequence,
+                   Camera const &camera,
+                   Integrator const &integrate,
+                   std::vector<Photometry::RGB> *pixels,
+                   ImageFormat::TileWriter *writer,
+                   Statistics::Frame *statistics)
     {
         using namespace Geometry;
         using namespace Photometry;
 
-        auto tick_log = clock();
-
-        for (auto y=0; y!=height; ++y) {
-            #pragma omp parallel for
-            for (auto x=0; x<width; ++x) {
-                /*DebugPixel *cd =*/
-                current_debug = &debug[y*width+x];
-
-                RNG rng(7*y*width+3*x);
+        Rendering::TilePolicy tiling;
+        if (writer)
+            tiling.tileSize = writer->tileSize();
+
+        Rendering::render_tiles(width, height, tiling, sequence,
+            [&](Rendering::Tile const &tile, Rendering::ThreadContext &context) {
+                Sampling::Sampler &sampler = context.sampler;
+                MemoryArena &arena = context.arena;
+                std::vector<float> rgb;
+                if (writer)
+                    rgb.reserve(tile.width() * tile.height() * 3);
+
+                for (auto y=tile.y0; y!=tile.y1; ++y) {
+                    for (auto x=tile.x0; x!=tile.x1; ++x) {
+                        Statistics::current = context.counters(x, y);
+                        const double start = Statistics::current ? omp_get_wtime() : 0;
+
+                        sampler.startPixel(x, y);
+
+                        Spectrum sum = Spectrum::Black(400,800,8);
+                        for (auto i=0; i!=samples_per_pixel; ++i) {
+                            sampler.startSample(i);
+                            const real sx = x + sampler() - real(0.5),
+                                       sy = y + sampler() - real(0.5);
+                            sum += integrate(camera(sx, sy), sampler, arena) * (real(1) / samples_per_pixel);
+                            arena.reset();
+                        }
+                        if (Statistics::current) {
+                            Statistics::current->seconds = omp_get_wtime() - start;
+                            Statistics::current = nullptr;
+                        }
+
+                        const auto XYZ = sum.toXYZ();
+                        const auto RGB = Photometry::ColorSpace::XYZ_to_sRGB(XYZ);
+                        if (pixels)
+                            (*pixels)[y*width+x] = Photometry::RGB(get<0>(RGB), get<1>(RGB), get<2>(RGB));
+                        if (writer) {
+                            rgb.push_back(get<0>(RGB));
+                            rgb.push_back(get<1>(RGB));
+                            rgb.push_back(get<2>(RGB));
+                        }
+                    }
+                }
 
-                Spectrum sum = Spectrum::Black(400,800,8);
-                for (auto i=0; i!=samples_per_pixel; ++i) {
-                    const auto u = (x + rng()-real(0.5)) / real(width),
-                               v = 1 - (y + rng()-real(0.5)) / real(height);
-                    const auto ray = Ray{Point{0,0.5,0}, Geometry::direction(u-0.5, v-0.5, 0.8)};
-                    sum += integrate(ray, rng) * (real(1) / samples_per_pixel);
-                    current_debug = 0;
+                if (writer) {
+                    #pragma omp critical (excyrender_raytrace_writer)
+                    writer->write(tile.x0, tile.y0, tile.width(), tile.height(), rgb.data());
                 }
+            },
+            statistics);
+    }
+}
 
-                const auto XYZ = sum.toXYZ();
-                const auto RGB = Photometry::ColorSpace::XYZ_to_sRGB(XYZ);
-                pixels[y*width+x] = Photometry::RGB(get<0>(RGB), get<1>(RGB), get<2>(RGB));
 
-                /*#pragma omp critical
-                std::cout << (int)cd->traversal0 << ":";*/
-            }
+#include "Primitives/BoundingIntervalHierarchy.hh"
 
-            /*#pragma omp critical
-            std::cout << "\n";*/
+namespace {
+    std::atomic<bool> interrupted(false);
 
-            auto curr = clock();
-            if (curr - tick_log > CLOCKS_PER_SEC) {
-                tick_log = curr;
-                std::clog << y << '/' << height << std::endl;
-            }
-        }
+    extern "C" void interrupt(int) {
+        interrupted = true;
     }
 }
 
-
-#include "Primitives/BoundingIntervalHierarchy.hh"
-
-int main () {
+// Usage: excygen [-o file] [-mesh file] [-stats file] [-aov] [seconds [target-error]]
+//        excygen [-o file] [-mesh file] -c checkpoint [samples-per-pixel [checkpoint-interval]]
+//        excygen [-o file] [-mesh file] -coordinator socket [samples-per-pixel]
+//        excygen [-mesh file] -worker socket
+//        excygen -texture image tiled-texture [u8|u16|half]
+//
+// The image goes to 'file' (binary PPM, PFM or tiled OpenEXR, by extension), or as
+// ASCII PPM to stdout.
+//
+// -mesh adds a PLY or OBJ mesh to the terrain, in a gray Lambertian material.
+//
+// -stats writes counts of rays, BIH nodes and intersection tests, and times, as JSON to
+// 'file' (see Statistics.hh). Needs a build with statistics (scons excygen-stats), and a
+// render with a fixed number of samples per pixel.
+//
+// -aov writes images of depth and normals next to 'file' (see Rendering/AOV.hh), and,
+// in a build with statistics, heatmaps of BIH nodes visited, intersection tests and
+// render time per pixel. Needs -o and a fixed number of samples per pixel.
+//
+// Without arguments, renders with a fixed number of samples per pixel. With seconds,
+// samples adaptively until each pixel's relative error is below target-error, or the
+// given number of seconds is used up.
+//
+// With -c, renders progressively, saving the state to 'checkpoint' every
+// checkpoint-interval seconds and on SIGINT/SIGTERM. If 'checkpoint' exists, for the
+// same samples-per-pixel, the render continues from it and ends with the same image as
+// if it had never stopped.
+//
+// With -coordinator, renders nothing itself but hands out tiles to any number of
+// -worker processes connecting to the same Unix domain socket.
+//
+// With -texture, converts an image to the tiled, mip-mapped format of
+// TiledImageTexture, and renders nothing.
+int main (int argc, char *argv[]) {
     try {
         using namespace excyrender;
         using namespace Primitives;
@@ -126,27 +190,131 @@ int main () {
         const auto width = 800,
                    height = 800;
         const auto samples_per_pixel = 1;
-        std::vector<Photometry::RGB> pixels(width*height);
-        std::vector<DebugPixel> debug(width*height);
+        std::vector<Photometry::RGB> pixels;
+
+        if (argc > 3 && argv[1] == std::string("-texture")) {
+            const std::string format = argc > 4 ? argv[4] : "u8";
+            if (format != "u8" && format != "u16" && format != "half")
+                throw std::runtime_error("unknown texel format '" + format + "' (want u8, u16 or half)");
+            const excyrender::detail::Image image(argv[2]);
+            TextureCache::write(argv[3], image.width(), image.height(), image.pixels(),
+                                format == "u8"  ? TextureCache::TexelFormat::U8 :
+                                format == "u16" ? TextureCache::TexelFormat::U16 :
+                                                  TextureCache::TexelFormat::Half);
+            return 0;
+        }
 
+        // "-o file" writes to 'file' instead of ASCII PPM to stdout.
+        std::string output;
+        if (argc > 2 && argv[1] == std::string("-o")) {
+            output = argv[2];
+            argc -= 2;
+            argv += 2;
+        }
+        // "-mesh file" adds the triangles of 'file' to the scene.
+        std::string mesh;
+        if (argc > 2 && argv[1] == std::string("-mesh")) {
+            mesh = argv[2];
+            argc -= 2;
+            argv += 2;
+        }
+        // "-stats file" writes statistics to 'file'.
+        std::string stats;
+        if (argc > 2 && argv[1] == std::string("-stats")) {
+            if (!Statistics::enabled)
+                throw std::runtime_error("-stats needs a build with statistics (scons excygen-stats)");
+            stats = argv[2];
+            argc -= 2;
+            argv += 2;
+        }
+        // "-aov" writes AOVs next to the image.
+        bool aov = false;
+        if (argc > 1 && argv[1] == std::string("-aov")) {
+            if (output.empty())
+                throw std::runtime_error("-aov needs -o, to name its images after");
+            if (!Statistics::enabled)
+                std::clog << "-aov: heatmaps need a build with statistics (scons excygen-stats)" << std::endl;
+            aov = true;
+            --argc;
+            ++argv;
+        }
+        if ((!stats.empty() || aov) && argc > 1)
+            throw std::runtime_error("-stats and -aov need a render with a fixed number of samples per pixel");
+        Statistics::Frame frame;
+        // Without counting compiled in, there is nothing to collect per pixel.
+        Statistics::Frame *const statistics = Statistics::enabled && (!stats.empty() || aov) ? &frame : nullptr;
+        double phaseStart = omp_get_wtime();
+        auto const phase = [&](Statistics::Phase p) {
+            const double now = omp_get_wtime();
+            frame.seconds[int(p)] += now - phaseStart;
+            phaseStart = now;
+        };
+        auto const writeStatistics = [&]() {
+            if (stats.empty())
+                return;
+            std::ofstream os(stats);
+            Statistics::writeJson(os, frame);
+            if (!os)
+                throw std::runtime_error("could not write statistics to '" + stats + "'");
+        };
+        auto const emit = [&]() {
+            if (output.empty())
+                ImageFormat::ppm (std::cout, width, height, pixels);
+            else
+                ImageFormat::write(*ImageFormat::tileWriter(output, width, height, 32), pixels);
+        };
+
+        SurfaceIntegrators::PathPolicy policy;
+        policy.maxDepth = 5;
+        policy.rouletteDepth = 3;
+
+        const auto sequence = Sampling::Sequence::Sobol;
+
+        // Identifies scene, settings and build for checkpoints and workers: a worker with a
+        // different 'real' or mesh would render a different image. The mesh by content, not
+        // name. Not the sample count, which workers get per job, and checkpoints add below.
+        std::ostringstream settings;
+        settings << "main.cc terrain " << width << 'x' << height
+                 << " depth=" << policy.maxDepth << " roulette=" << policy.rouletteDepth
+                 << " real=" << sizeof(real) << " sequence=" << static_cast<int>(sequence);
+        if (!mesh.empty())
+            settings << " mesh=" << Rendering::fingerprintFile(mesh);
+        const std::uint64_t sceneHash = Rendering::fingerprint(settings.str());
+
+        if (argc > 2 && argv[1] == std::string("-coordinator")) {
+            // Needs no scene of its own.
+            Rendering::Distributed::CoordinatorPolicy coordinator;
+            if (argc > 3)
+                coordinator.samplesPerPixel = std::atoi(argv[3]);
+            const auto xyz = Rendering::Distributed::coordinate(argv[2], width, height, sceneHash, coordinator);
+            pixels.resize(width*height);
+            for (int i=0; i!=width*height; ++i) {
+                const auto RGB = Photometry::ColorSpace::XYZ_to_sRGB(make_triple<real>(xyz[i*3], xyz[i*3+1], xyz[i*3+2]));
+                pixels[i] = Photometry::RGB(get<0>(RGB), get<1>(RGB), get<2>(RGB));
+            }
+            emit();
+            return 0;
+        }
+
+        Scene scene;
 
         Primitives::BoundingIntervalHierarchyBuilder builder;
         /*
         builder.add({std::shared_ptr<Primitives::FinitePrimitive>(new
                          PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere ({-1.0,0.0,5}, 1)),
-                         std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF({std::shared_ptr<BxDF>(new Surface::Lambertian (Spectrum::FromRGB(400,800,8, {1,0.3,0.3})))})))
+                         scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({std::shared_ptr<BxDF>(new Surface::Lambertian (Spectrum::FromRGB(400,800,8, {1,0.3,0.3})))})))
                      )),
                      std::shared_ptr<Primitives::FinitePrimitive>(new
                          PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere ({1.0,0.0,5}, 1)),
-                         std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF({std::shared_ptr<BxDF>(new Surface::Lambertian (Spectrum::Gray(400,800,8, 1)))})))
+                         scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({std::shared_ptr<BxDF>(new Surface::Lambertian (Spectrum::Gray(400,800,8, 1)))})))
                      )),
                      std::shared_ptr<Primitives::FinitePrimitive>(new
                          PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(new Shapes::Triangle({0,0,5},{-1,1,5},{1,1,5})),
-                         std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF ({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::FromRGB(400,800,8,{0.6,1.0,0.4})) ) })))
+                         scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::FromRGB(400,800,8,{0.6,1.0,0.4})) ) })))
                      )),
                      std::shared_ptr<Primitives::FinitePrimitive>(new
                          PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(new Shapes::Triangle({0,0,5},{-1,-1,5},{1,-1,5})),
-                         std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF ({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::FromRGB(400,800,8,{0.6,1.0,0.4})) ) })))
+                         scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::FromRGB(400,800,8,{0.6,1.0,0.4})) ) })))
                      ))
                     });
 
@@ -162,7 +330,7 @@ int main () {
 
             builder.add(std::shared_ptr<Primitives::FinitePrimitive>(new
                          PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(new Shapes::Sphere ({x,y,z}, r)),
-                         std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF({
+                         scene.add(std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({
                              std::shared_ptr<BxDF>(new Surface::Lambertian (Spectrum::FromRGB(400,800,8, {r_,g_,b_})))
                          })))
                        )));
@@ -178,44 +346,148 @@ int main () {
                                                                //[](real u,real v) { return -4 + 5*sin(u) * sin(v); }
                                                                Nature::Et1::compile("-1+--2+2+3+sqrt(-1,2,3,foo())")
                                                            )),
-                             std::shared_ptr<Material::Material>(new Material::Lambertian(
+                             scene.add(std::shared_ptr<Material::Material>(new Material::Lambertian(
                                   shared_ptr<SpectrumTexture>(new ColorImageTexture(Photometry::Texture::XZPlanarMapping(0.4,0.4,0,0),
                                                                                     "Rock_07_UV_H_CM_1.jpg"))
-                             ))
+                             )))
                          ))
                 );
 
+        if (!mesh.empty()) {
+            builder.add(std::shared_ptr<Primitives::FinitePrimitive>(new
+                             PrimitiveFromFiniteShape (std::shared_ptr<Shapes::FiniteShape>(
+                                                          new Shapes::TriangleMesh(MeshFormat::readMesh(mesh))),
+                             scene.add(std::shared_ptr<Material::Material>(new Material::Lambertian(
+                                  shared_ptr<SpectrumTexture>(new ConstantTexture<Spectrum>(Spectrum::Gray(400,800,8,real(0.6))))
+                             )))
+                         ))
+                );
+        }
 
-        PrimitiveList const primitive({
+        scene.setPrimitive(std::shared_ptr<Primitive>(new PrimitiveList({
                          builder.finalize(20)
                          /*std::shared_ptr<Primitive>(new
                              PrimitiveFromShape (std::shared_ptr<Shapes::Shape>(new Shapes::Plane(Shapes::Plane::FromPointNormal({0,-1,0},normal(0,1,0)))),
-                             //std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough(BSDF ({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::Gray(400,800,8,real(1))) ) })))
-                             std::shared_ptr<Material::Material>(new Material::Lambertian(
+                             //std::shared_ptr<const Material::Material>(new Material::BSDFPassthrough({ std::shared_ptr<BxDF>( new Surface::Lambertian (Spectrum::Gray(400,800,8,real(1))) ) }))
+                             scene.add(std::shared_ptr<Material::Material>(new Material::Lambertian(
                                   shared_ptr<SpectrumTexture>(new ColorImageTexture(Photometry::Texture::XZPlanarMapping(0.4,0.4,0,0),
                                                                                     "loose_gravel_9261459 (mayang.com).JPG"))
-                             ))
+                             )))
                          ))*/
-                        });
-
-        std::vector<std::shared_ptr<LightSource>> const lightSources({
-            std::shared_ptr<LightSource>(new Directional (direction(1,0.5,-1), Spectrum::FromRGB(400,800,8,{8,7,7})))
-        });
-        auto const integrator = SurfaceIntegrators::Path(5, primitive, lightSources,
-                                                         [](Geometry::Direction const &) {
-                                                            return Spectrum::FromRGB(400,800,8,{1,2,3});
-                                                         }
-                                                        );
-
-        raytrace (width, height, samples_per_pixel, integrator, pixels, debug);
-        if (0) {
-            for (int y=0; y!=height; ++y) {
-                for (int x=y%2; x<width; x+=2) {
-                    pixels[y*width+x] = Photometry::RGB(0.5,0.5,1.0) * (debug[y*width+x].traversal0) * 0.025;
-                }
+                        })));
+
+        scene.add(std::shared_ptr<LightSource>(new Directional (direction(1,0.5,-1), Spectrum::FromRGB(400,800,8,{8,7,7}))));
+        scene.setBackground([](Geometry::Direction const &) {
+                                return Spectrum::FromRGB(400,800,8,{1,2,3});
+                            });
+        auto const integrator = SurfaceIntegrators::IterativePath(policy, scene);
+        phase(Statistics::Phase::Scene);
+
+        // Rays through raster position (x,y), with differentials to the neighbouring
+        // pixels scaled by 'footprint': with n samples per pixel, each sample needs to
+        // cover only about 1/sqrt(n) of the pixel (as in PBRT, no less than 1/8).
+        real footprint = 1;
+        auto const footprintFor = [](int samples) {
+            return std::max(real(0.125), 1 / std::sqrt(real(samples)));
+        };
+        auto const camera = [&](real x, real y) {
+            auto const through = [&](real x, real y) {
+                const auto u = x / real(width), v = 1 - y / real(height);
+                return Geometry::direction(u-0.5, v-0.5, 0.8);
+            };
+            RayDifferential ray{Point{0,0.5,0}, through(x, y)};
+            ray.hasDifferentials = true;
+            ray.rxOrigin = ray.ryOrigin = ray.origin;
+            ray.rxDirection = static_cast<Vector>(through(x+1, y));
+            ray.ryDirection = static_cast<Vector>(through(x, y+1));
+            ray.scaleDifferentials(footprint);
+            return ray;
+        };
+
+        if (argc > 2 && argv[1] == std::string("-worker")) {
+            Rendering::Distributed::work(argv[2], sceneHash,
+                [&](Rendering::Distributed::Job const &job, std::vector<float> &xyz) {
+                    footprint = footprintFor(job.samplesPerPixel);
+                    Rendering::Distributed::render_job(job, sequence, camera, integrator, xyz);
+                });
+            return 0;
+        } else if (argc > 2 && argv[1] == std::string("-c")) {
+            Rendering::ProgressivePolicy progressive;
+            progressive.checkpoint = argv[2];
+            if (argc > 3)
+                progressive.samplesPerPixel = std::atoi(argv[3]);
+            if (argc > 4)
+                progressive.checkpointInterval = std::atof(argv[4]);
+            progressive.interrupt = &interrupted;
+            std::signal(SIGINT, interrupt);
+            std::signal(SIGTERM, interrupt);
+
+            Rendering::Checkpoint state;
+            state.sequence = sequence;
+            // The ray footprint depends on the sample count, so a checkpoint only continues
+            // a render to the same count.
+            const std::string count = " spp=" + std::to_string(progressive.samplesPerPixel);
+            state.key = Rendering::fingerprint(count.data(), count.size(), sceneHash);
+            footprint = footprintFor(progressive.samplesPerPixel);
+
+            const auto report = Rendering::render_progressive(width, height, progressive, camera, integrator, state);
+            std::clog << report.passes << " passes" << (report.resumed ? " after resume" : "") << ", "
+                      << report.seconds << "s" << (report.complete ? "" : " (interrupted, resume to complete)")
+                      << std::endl;
+
+            pixels.resize(width*height);
+            for (int i=0; i!=width*height; ++i) {
+                const auto RGB = Photometry::ColorSpace::XYZ_to_sRGB(state.buffer.mean(i));
+                pixels[i] = Photometry::RGB(get<0>(RGB), get<1>(RGB), get<2>(RGB));
+            }
+        } else if (argc > 1) {
+            Rendering::AdaptivePolicy adaptive;
+            adaptive.timeBudget = std::atof(argv[1]);
+            if (argc > 2)
+                adaptive.targetError = std::atof(argv[2]);
+
+            // Sample counts differ per pixel; most get at least 16.
+            footprint = footprintFor(16);
+            std::vector<Rendering::PixelEstimate> estimates;
+            const auto report = Rendering::render_adaptive(width, height, adaptive, sequence,
+                                                           camera, integrator, estimates);
+            std::clog << report.passes << " passes, "
+                      << report.samples / real(width*height) << " samples per pixel, "
+                      << report.converged << '/' << width*height << " pixels converged, "
+                      << report.seconds << "s" << (report.outOfTime ? " (time budget used up)" : "")
+                      << std::endl;
+
+            pixels.resize(width*height);
+            for (int i=0; i!=width*height; ++i) {
+                const auto RGB = Photometry::ColorSpace::XYZ_to_sRGB(
+                                     make_triple(estimates[i].X, estimates[i].Y, estimates[i].Z));
+                pixels[i] = Photometry::RGB(get<0>(RGB), get<1>(RGB), get<2>(RGB));
+            }
+        } else if (!output.empty()) {
+            auto writer = ImageFormat::tileWriter(output, width, height, 32);
+            footprint = footprintFor(samples_per_pixel);
+            raytrace (width, height, samples_per_pixel, sequence, camera, integrator,
+                      nullptr, writer.get(), statistics);
+            phase(Statistics::Phase::Render);
+            writer->finish();
+            if (aov) {
+                Rendering::writeAovs(output, width, height,
+                                     Rendering::geometryAovs(width, height, camera, scene.primitive()),
+                                     statistics, samples_per_pixel);
             }
+            phase(Statistics::Phase::Output);
+            writeStatistics();
+            return 0;
+        } else {
+            pixels.resize(width*height);
+            footprint = footprintFor(samples_per_pixel);
+            raytrace (width, height, samples_per_pixel, sequence, camera, integrator,
+                      &pixels, nullptr, statistics);
         }
-        ImageFormat::ppm (std::cout, width, height, pixels);
+        phase(Statistics::Phase::Render);
+        emit();
+        phase(Statistics::Phase::Output);
+        writeStatistics();
     } catch (std::exception &e) {
         std::cerr << "error:" << e.what() << "(" << typeid(e).name() << ")\n";
     }
@@ -10,8 +10,16 @@
 #include <limits>
 
 namespace excyrender {
+    // Build with EXCYRENDER_SINGLE_PRECISION defined (scons excygen-single) for float
+    // geometry, spectra and textures: half the memory, twice the SIMD lanes.
+#ifdef EXCYRENDER_SINGLE_PRECISION
+    typedef float real;
+#else
     typedef double real;
+#endif
     static constexpr real epsilon = real(0.00001);
+    // Relative rounding error assumed for computed points; see offsetOrigin().
+    static constexpr real rounding_error = 64 * std::numeric_limits<real>::epsilon();
     static constexpr real pi = real(3.14159265358979323846);
     static constexpr real real_max = std::numeric_limits<real>::max();
 